@@ -0,0 +1,138 @@
+// Benchmark for envuSampler.
+// It compares the sampler with a naive sampler that re-opens /proc files through stdio.
+// With glibc, it also counts malloc calls by replacing malloc with a wrapper.
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "env_utils.h"
+
+#define SAMPLE_COUNT 20000
+
+static unsigned long long alloc_count = 0;
+
+#ifdef __GLIBC__
+// glibc routes its own allocations (fopen, getline, opendir) to these replacements too.
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+// Export the replacements even with -fvisibility=hidden.
+#define EXPORT __attribute__((visibility("default")))
+
+EXPORT void *malloc(size_t size) {
+    alloc_count++;
+    return __libc_malloc(size);
+}
+
+EXPORT void *calloc(size_t count, size_t size) {
+    alloc_count++;
+    return __libc_calloc(count, size);
+}
+
+EXPORT void *realloc(void *ptr, size_t size) {
+    alloc_count++;
+    return __libc_realloc(ptr, size);
+}
+
+EXPORT void free(void *ptr) {
+    __libc_free(ptr);
+}
+#define HAS_ALLOC_COUNT 1
+#else
+#define HAS_ALLOC_COUNT 0
+#endif
+
+static double getNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// Reads the same values as envuSample() with fopen() and getline().
+static int sampleWithStdio(unsigned long long *checksum) {
+    char *line = NULL;
+    size_t size = 0;
+    FILE *fp = fopen("/proc/self/stat", "r");
+    if (fp == NULL)
+        return -1;
+    if (getline(&line, &size, fp) > 0) {
+        const char *p = strrchr(line, ')');
+        unsigned long long utime = 0, stime = 0, rss = 0;
+        long threads = 0;
+        if (p != NULL && sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu "
+                                "%*d %*d %*d %*d %ld %*d %*u %*u %llu",
+                                &utime, &stime, &threads, &rss) == 4)
+            *checksum += utime + stime + rss + threads;
+    }
+    fclose(fp);
+    fp = fopen("/proc/self/status", "r");
+    if (fp == NULL) {
+        free(line);
+        return -1;
+    }
+    while (getline(&line, &size, fp) > 0) {
+        unsigned long long value;
+        if (sscanf(line, "voluntary_ctxt_switches: %llu", &value) == 1 ||
+            sscanf(line, "nonvoluntary_ctxt_switches: %llu", &value) == 1)
+            *checksum += value;
+    }
+    fclose(fp);
+    free(line);
+    DIR *dir = opendir("/proc/self/fd");
+    if (dir == NULL)
+        return -1;
+    while (readdir(dir) != NULL)
+        (*checksum)++;
+    closedir(dir);
+    return 0;
+}
+
+static void report(const char *name, double ns, unsigned long long allocs) {
+    printf("%s: %.0f samples/sec (%.2f us/sample)", name, 1e9 / ns, ns / 1000);
+    if (HAS_ALLOC_COUNT)
+        printf(", %.2f allocations/sample", (double)allocs / SAMPLE_COUNT);
+    printf("\n");
+}
+
+int main(void) {
+    envuSampler *sampler = envuOpenSampler(0);
+    if (sampler == NULL) {
+        printf("envuSampler is not supported on this platform.\n");
+        return 0;
+    }
+    envuProcessSample sample;
+    // Warm up the buffer of the sampler.
+    envuSample(sampler, &sample);
+
+    unsigned long long allocs = alloc_count;
+    double start = getNs();
+    for (int i = 0; i < SAMPLE_COUNT; i++) {
+        if (envuSample(sampler, &sample) != 0) {
+            printf("Failed to take a sample.\n");
+            return 1;
+        }
+    }
+    double ns = (getNs() - start) / SAMPLE_COUNT;
+    report("envuSample()", ns, alloc_count - allocs);
+    printf("  rss: %llu KiB, threads: %d, fds: %d, cpu: %.1f%%\n",
+           (unsigned long long)(sample.rss / 1024), sample.thread_count, sample.fd_count,
+           sample.cpu_usage * 100);
+    envuCloseSampler(sampler);
+
+    unsigned long long checksum = 0;
+    allocs = alloc_count;
+    start = getNs();
+    for (int i = 0; i < SAMPLE_COUNT; i++) {
+        if (sampleWithStdio(&checksum) != 0) {
+            printf("Failed to take a sample with stdio.\n");
+            return 1;
+        }
+    }
+    ns = (getNs() - start) / SAMPLE_COUNT;
+    report("fopen() + getline()", ns, alloc_count - allocs);
+    return checksum == 0;
+}
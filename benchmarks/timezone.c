@@ -0,0 +1,194 @@
+// Benchmark for envuPinTimezone().
+// glibc's localtime() checks /etc/localtime on every call when TZ is unset.
+// On Linux, it also counts stat and readlink calls with a seccomp listener.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "env_utils.h"
+
+#ifdef __linux__
+#include <errno.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+#include <sys/ioctl.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#if defined(SECCOMP_FILTER_FLAG_NEW_LISTENER) && defined(SECCOMP_USER_NOTIF_FLAG_CONTINUE)
+#define COUNT_SYSCALLS
+#endif
+#endif
+
+#define LOOP_COUNT 200000
+#define COUNT_LOOP_COUNT 1000
+
+static double getNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static double measureLocaltime(int loop_count) {
+    time_t t = time(NULL);
+    double start = getNs();
+    for (int i = 0; i < loop_count; i++) {
+        struct tm *tm = localtime(&t);
+        if (tm == NULL)
+            return -1;
+        t++;
+    }
+    return (getNs() - start) / loop_count;
+}
+
+#ifdef COUNT_SYSCALLS
+static const int counted_syscalls[] = {
+#ifdef SYS_stat
+    SYS_stat,
+#endif
+#ifdef SYS_lstat
+    SYS_lstat,
+#endif
+#ifdef SYS_newfstatat
+    SYS_newfstatat,
+#endif
+#ifdef SYS_fstatat64
+    SYS_fstatat64,
+#endif
+#ifdef SYS_statx
+    SYS_statx,
+#endif
+#ifdef SYS_readlink
+    SYS_readlink,
+#endif
+#ifdef SYS_readlinkat
+    SYS_readlinkat,
+#endif
+};
+
+#define COUNTED_SYSCALL_COUNT (int)(sizeof(counted_syscalls) / sizeof(int))
+
+static unsigned long syscall_count = 0;
+
+static unsigned long getSyscallCount(void) {
+    return __atomic_load_n(&syscall_count, __ATOMIC_SEQ_CST);
+}
+
+// Counts notified syscalls and lets the kernel run them as usual.
+static void *superviseSyscalls(void *arg) {
+    int fd = *(int *)arg;
+    struct seccomp_notif req;
+    struct seccomp_notif_resp resp;
+    while (1) {
+        memset(&req, 0, sizeof(req));
+        if (ioctl(fd, SECCOMP_IOCTL_NOTIF_RECV, &req) != 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        __atomic_add_fetch(&syscall_count, 1, __ATOMIC_SEQ_CST);
+        memset(&resp, 0, sizeof(resp));
+        resp.id = req.id;
+        resp.flags = SECCOMP_USER_NOTIF_FLAG_CONTINUE;
+        ioctl(fd, SECCOMP_IOCTL_NOTIF_SEND, &resp);
+    }
+    return NULL;
+}
+
+static int startSyscallCounter(void) {
+    static int fd;
+    struct sock_filter filter[COUNTED_SYSCALL_COUNT + 3];
+    filter[0] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+                                             offsetof(struct seccomp_data, nr));
+    for (int i = 0; i < COUNTED_SYSCALL_COUNT; i++) {
+        // Jump to SECCOMP_RET_USER_NOTIF at the end.
+        filter[i + 1] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+                                                     counted_syscalls[i],
+                                                     COUNTED_SYSCALL_COUNT - i, 0);
+    }
+    filter[COUNTED_SYSCALL_COUNT + 1] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K,
+                                                                     SECCOMP_RET_ALLOW);
+    filter[COUNTED_SYSCALL_COUNT + 2] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K,
+                                                                     SECCOMP_RET_USER_NOTIF);
+    struct sock_fprog prog = { COUNTED_SYSCALL_COUNT + 3, filter };
+    if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) != 0)
+        return -1;
+    fd = (int)syscall(SYS_seccomp, SECCOMP_SET_MODE_FILTER,
+                      SECCOMP_FILTER_FLAG_NEW_LISTENER, &prog);
+    if (fd < 0)
+        return -1;
+    // The supervisor inherits the filter, but it never calls the counted syscalls.
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, superviseSyscalls, &fd) != 0)
+        return -1;
+    pthread_detach(thread);
+    return 0;
+}
+
+static void printLocaltimeCalls(const char *label) {
+    unsigned long start = getSyscallCount();
+    measureLocaltime(COUNT_LOOP_COUNT);
+    double calls = (double)(getSyscallCount() - start) / COUNT_LOOP_COUNT;
+    printf("localtime() %s: %.2f stat/readlink calls/call\n", label, calls);
+}
+
+// Counts calls in a child process because the listener slows down the counted syscalls.
+static void countSyscalls(void) {
+    if (startSyscallCounter() != 0) {
+        printf("Failed to count stat and readlink calls.\n");
+        return;
+    }
+    unsigned long start = getSyscallCount();
+    char *tz = envuGetTimezone();
+    unsigned long count = getSyscallCount() - start;
+    printf("envuGetTimezone() (uncached): %lu stat/readlink calls\n", count);
+    envuFree(tz);
+
+    start = getSyscallCount();
+    tz = envuGetTimezone();
+    count = getSyscallCount() - start;
+    printf("envuGetTimezone() (cached): %lu stat/readlink calls\n", count);
+    envuFree(tz);
+
+    envuSetEnv("TZ", NULL);
+    tzset();
+    printLocaltimeCalls("without TZ");
+    if (envuPinTimezone() != 0)
+        return;
+    printLocaltimeCalls("with TZ");
+}
+#endif
+
+int main(void) {
+#ifdef COUNT_SYSCALLS
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        countSyscalls();
+        fflush(stdout);
+        _exit(0);
+    }
+    if (pid > 0)
+        waitpid(pid, NULL, 0);
+#endif
+
+    char *tz = envuGetTimezone();
+    printf("Timezone: %s\n", tz);
+    envuFree(tz);
+
+    envuSetEnv("TZ", NULL);
+    tzset();
+    printf("localtime() without TZ: %.1f ns/call\n", measureLocaltime(LOOP_COUNT));
+
+    if (envuPinTimezone() != 0) {
+        printf("Failed to pin the timezone.\n");
+        return 1;
+    }
+    char *env = envuGetEnv("TZ");
+    printf("localtime() with TZ=%s: %.1f ns/call\n", env, measureLocaltime(LOOP_COUNT));
+    envuFree(env);
+    return 0;
+}
@@ -165,6 +165,18 @@ _ENVU_EXTERN int envuSetEnv(const char *name, const char *value);
  */
 _ENVU_EXTERN char *envuGetHome(void);
 
+/**
+ * Gets the directory for temporary files.
+ * On Unix-like systems, it returns TMPDIR, or "/tmp" when TMPDIR is not set.
+ * On Windows, it returns the result of GetTempPathW(). (TMP, TEMP, or USERPROFILE)
+ * Trailing path separators are removed.
+ *
+ * @note Strings that are returned from this method should be freed with envuFree().
+ *
+ * @returns A string that represents the temporary directory. Or a null pointer if failed.
+ */
+_ENVU_EXTERN char *envuGetTempDir(void);
+
 /**
  * Gets user name.
  *
@@ -242,6 +254,1744 @@ _ENVU_EXTERN char **envuParseEnvPaths(const char *env_path, int *path_count);
  */
 _ENVU_EXTERN void envuFreeEnvPaths(char **paths);
 
+/**
+ * Publishes a read-only snapshot of environment information for child processes.
+ * It stores the executable path, OS information, and user information in
+ * a sealed memfd (or a POSIX shared memory object on non-Linux platforms),
+ * and exports it to child processes with the ENVU_SNAPSHOT variable.
+ *
+ * @note Call envuUnpublishSnapshot() to release the snapshot.
+ *
+ * @warning This function is not thread-safe. It modifies environment variables.
+ *
+ * @returns 0 if successful. -1 indicates failure or that it's running on Windows.
+ */
+_ENVU_EXTERN int envuPublishSnapshot(void);
+
+/**
+ * Releases the snapshot created by envuPublishSnapshot(),
+ * and removes the ENVU_SNAPSHOT variable.
+ */
+_ENVU_EXTERN void envuUnpublishSnapshot(void);
+
+/**
+ * Attaches to a snapshot published by a parent process.
+ * After this call, envuGetExecutablePath(), envuGetOS*(), envuGetHome(), and envuGetUsername()
+ * return cached values in the snapshot without syscalls.
+ * Snapshots are rejected when they were created by an incompatible version of c-env-utils,
+ * when they are broken, or when they were not sealed.
+ * User information is not served if the snapshot was created by another user,
+ * and the executable path is only served to processes that run the same executable.
+ *
+ * @warning This function is not thread-safe. Call it at startup.
+ *
+ * @returns 0 if successful. -1 indicates failure or that it's running on Windows.
+ */
+_ENVU_EXTERN int envuAttachSnapshot(void);
+
+/**
+ * Detaches from a snapshot attached by envuAttachSnapshot().
+ * Getters will compute values by themselves again.
+ *
+ * @warning This function is not thread-safe.
+ */
+_ENVU_EXTERN void envuDetachSnapshot(void);
+
+/**
+ * Prepares a preformatted crash header for envuWriteCrashInfo().
+ * It stores the executable path, OS version, OS product name, user name,
+ * and current working directory in a static buffer.
+ * The working directory will be refreshed when envuSetCwd() changes it.
+ * Updates are published atomically, so handlers never see a half-written header.
+ *
+ * @note Call this function at startup, before installing signal handlers.
+ *
+ * @returns 0 if successful. -1 indicates failure or that it's running on Windows.
+ */
+_ENVU_EXTERN int envuPrepareCrashInfo(void);
+
+/**
+ * Writes the crash header prepared by envuPrepareCrashInfo() to a file descriptor.
+ * It only uses write(). So, you can call it from signal handlers.
+ *
+ * @param fd A file descriptor to write the header to. e.g. STDERR_FILENO.
+ * @returns 0 if successful.
+ *          -1 indicates failure, that the header is not prepared, or that it's running on Windows.
+ */
+_ENVU_EXTERN int envuWriteCrashInfo(int fd);
+
+/**
+ * Kernel features that envuGetKernelFeatures() can detect.
+ */
+_ENVU_ENUM(envuKernelFeature) {
+    ENVU_KF_IO_URING = 0,
+    ENVU_KF_STATX,
+    ENVU_KF_OPENAT2,
+    ENVU_KF_COPY_FILE_RANGE,
+    ENVU_KF_PIDFD_OPEN,
+    ENVU_KF_MEMFD_CREATE,
+    ENVU_KF_CLONE3,
+    ENVU_KF_CLOSE_RANGE,
+    ENVU_KF_GETRANDOM,
+    ENVU_KF_MADV_POPULATE,
+    ENVU_KF_MAX,
+};
+
+/**
+ * Features and the version of the running kernel.
+ */
+typedef struct envuKernelFeatures {
+    /** Bit flags of available features. (1 << envuKernelFeature) */
+    uint64_t features;
+    /**
+     * Bit flags of supported io_uring opcodes.
+     * (1 << (opcode % 64) in io_uring_ops[opcode / 64])
+     */
+    uint64_t io_uring_ops[4];
+    /** The major version of the kernel. */
+    int version_major;
+    /** The minor version of the kernel. */
+    int version_minor;
+    /** The patch version of the kernel. */
+    int version_patch;
+} envuKernelFeatures;
+
+/**
+ * Gets features of the running kernel.
+ * It probes features with real syscalls only once, and caches the results.
+ *
+ * @note The returned structure is owned by c-env-utils. Don't free it.
+ *
+ * @returns A pointer to the cached features. Or a null pointer on non-Linux platforms.
+ */
+_ENVU_EXTERN const envuKernelFeatures *envuGetKernelFeatures(void);
+
+/**
+ * Returns if the running kernel supports a feature or not.
+ *
+ * @param feature A feature to check.
+ * @returns 1 if the feature is available. 0 otherwise.
+ */
+_ENVU_EXTERN int envuHasKernelFeature(envuKernelFeature feature);
+
+/**
+ * Returns if the running kernel supports an io_uring opcode or not.
+ *
+ * @param opcode An io_uring opcode. (e.g. IORING_OP_READ)
+ * @returns 1 if the opcode is supported. 0 otherwise.
+ */
+_ENVU_EXTERN int envuHasIoUringOp(unsigned int opcode);
+
+/**
+ * Compares the version of the running kernel with the specified version.
+ *
+ * @param major A major version.
+ * @param minor A minor version.
+ * @param patch A patch version.
+ * @returns A negative value if the running kernel is older than the specified version,
+ *          0 if they are the same, or a positive value if the kernel is newer.
+ *          It returns -1 when the kernel version is unknown.
+ */
+_ENVU_EXTERN int envuCompareKernelVersion(int major, int minor, int patch);
+
+/**
+ * Gets the name of the local timezone. e.g. "Asia/Tokyo", "UTC".
+ * It checks the TZ variable, the symlink target of /etc/localtime, and /etc/timezone in order.
+ * Results from the files are cached.
+ * On Windows, it returns a timezone key name (e.g. "Tokyo Standard Time") when TZ is not set.
+ *
+ * @note Strings that are returned from this method should be freed with envuFree().
+ *
+ * @returns A string that represents the local timezone. Or a null pointer if failed.
+ */
+_ENVU_EXTERN char *envuGetTimezone(void);
+
+/**
+ * Sets the TZ variable to avoid the timezone file lookups in every localtime() call.
+ * It sets TZ to ":/etc/localtime", or to the name from envuGetTimezone() if the file is missing.
+ * It does nothing when TZ is already set.
+ *
+ * @warning This function is not thread-safe. It modifies environment variables.
+ *
+ * @returns 0 if successful. -1 indicates failure.
+ */
+_ENVU_EXTERN int envuPinTimezone(void);
+
+/**
+ * Gets the GNU build ID of the executing binary as a hex string.
+ * It reads the build ID note from memory without file I/O.
+ * If the binary has no build ID, it returns a hash of the file content with the "hash:" prefix.
+ * The result is cached.
+ *
+ * @note Strings that are returned from this method should be freed with envuFree().
+ *
+ * @returns A string that represents the build ID of the executing binary.
+ *          Or a null pointer if failed or on non-Linux platforms.
+ */
+_ENVU_EXTERN char *envuGetExecutableBuildId(void);
+
+/**
+ * A loaded module (the executable or a shared object).
+ */
+typedef struct envuModule {
+    /** The path to the module. */
+    const char *path;
+    /** The base address of the module. */
+    uintptr_t base;
+    /** The build ID as a hex string. Or a null pointer if the module has no build ID. */
+    const char *build_id;
+} envuModule;
+
+/**
+ * Gets a list of loaded modules.
+ * The first item is the executing binary.
+ * The list is cached, and refreshed only when modules are loaded or unloaded.
+ *
+ * @note Arrays that are returned from this method should be freed with envuFree().
+ *       It also frees the strings in the array.
+ *
+ * @param module_count The number of modules will be stored here if it's not a null pointer.
+ * @returns An array of modules terminated by an item with a null path.
+ *          Or a null pointer if failed or on non-Linux platforms.
+ */
+_ENVU_EXTERN envuModule *envuGetLoadedModules(int *module_count);
+
+/**
+ * Sets the root directory to read procfs, sysfs, and cgroup files.
+ * It is useful to test system queries with fixture trees.
+ * Cached results of system queries are refreshed after this call.
+ *
+ * @warning This function is not thread-safe. It's designed for tests.
+ *
+ * @param path A path to the root directory. Or a null pointer to restore "/".
+ * @returns 0 if successful. -1 indicates failure or non-Linux platforms.
+ */
+_ENVU_EXTERN int envuSetSysRoot(const char *path);
+
+/**
+ * Components of the effective cpu count.
+ */
+typedef struct envuCpuCountInfo {
+    /** The number of online cpus. */
+    int online;
+    /** The number of cpus in the affinity mask. -1 if unknown. */
+    int affinity;
+    /** The number of cpus in cpuset.cpus.effective. -1 if unknown. */
+    int cpuset;
+    /** The cpu quota of the cgroup as the number of cpus. 0 if unlimited. */
+    double quota;
+    /** The version of cgroup. (1 or 2) 0 if cgroup is not found. */
+    int cgroup_version;
+    /** The effective cpu count. It's the same as the return value of envuGetEffectiveCpuCount(). */
+    int effective;
+} envuCpuCountInfo;
+
+/**
+ * Gets the number of cpus that the process can actually use.
+ * It takes the minimum of online cpus, the affinity mask, the cpuset of the cgroup,
+ * and the cpu quota of the cgroup (cpu.max or cpu.cfs_quota_us/cpu.cfs_period_us).
+ * The quota is rounded up. e.g. 1.5 cpus -> 2.
+ *
+ * @param out Components of the cpu count will be stored here if it's not a null pointer.
+ * @returns The effective cpu count. (1 or more) Or -1 if failed.
+ */
+_ENVU_EXTERN int envuGetEffectiveCpuCount(envuCpuCountInfo *out);
+
+/** The max number of cpus that envuCpuSet can store. */
+#define ENVU_CPU_SETSIZE 4096
+
+/**
+ * A set of cpu numbers.
+ */
+typedef struct envuCpuSet {
+    /** Bit flags of cpus. (1 << (cpu % 64) in bits[cpu / 64]) */
+    uint64_t bits[ENVU_CPU_SETSIZE / 64];
+} envuCpuSet;
+
+/**
+ * Returns if a cpu set has the specified cpu or not.
+ *
+ * @param set A cpu set.
+ * @param cpu A cpu number.
+ * @returns 1 if the set has the cpu. 0 otherwise.
+ */
+_ENVU_EXTERN int envuCpuSetHas(const envuCpuSet *set, int cpu);
+
+/**
+ * Counts cpus in a cpu set.
+ *
+ * @param set A cpu set.
+ * @returns The number of cpus in the set.
+ */
+_ENVU_EXTERN int envuCpuSetCount(const envuCpuSet *set);
+
+/**
+ * Types of cpu caches.
+ */
+_ENVU_ENUM(envuCacheType) {
+    ENVU_CACHE_UNKNOWN = 0,
+    ENVU_CACHE_DATA,
+    ENVU_CACHE_INSTRUCTION,
+    ENVU_CACHE_UNIFIED,
+};
+
+/**
+ * A cpu cache.
+ */
+typedef struct envuCacheInfo {
+    /** The cache level. (1, 2, 3, ...) */
+    int level;
+    /** The cache type. */
+    envuCacheType type;
+    /** The cache size in bytes. */
+    uint64_t size;
+    /** The line size in bytes. */
+    uint32_t line_size;
+    /** The number of ways. 0 if unknown. */
+    uint32_t ways;
+    /** The number of logical cpus that share the cache. */
+    int shared_count;
+    /**
+     * Cpus that share the cache. Caches shared by the same cpus point to the same set.
+     * It's empty when sysfs is not available.
+     */
+    const envuCpuSet *shared_cpus;
+} envuCacheInfo;
+
+/**
+ * Cpu cache topology.
+ */
+typedef struct envuCacheTopology {
+    /** The number of caches. */
+    int count;
+    /** Unique caches of all cpus. Caches of a cpu are sorted by level. */
+    const envuCacheInfo *caches;
+    /** The size of the L1 data cache of the first cpu. 0 if unknown. */
+    uint64_t l1d_size;
+    /** The size of the L1 instruction cache of the first cpu. 0 if unknown. */
+    uint64_t l1i_size;
+    /** The size of the L2 cache of the first cpu. 0 if unknown. */
+    uint64_t l2_size;
+    /** The size of the L3 cache of the first cpu. 0 if unknown. */
+    uint64_t l3_size;
+    /** The line size of the L1 data cache of the first cpu. 0 if unknown. */
+    uint32_t line_size;
+} envuCacheTopology;
+
+/**
+ * Gets the cpu cache topology.
+ * It parses /sys/devices/system/cpu/cpu{@literal *}/cache/index{@literal *} only once,
+ * and uses cpuid (leaf 4 or 0x8000001D) if sysfs is not available.
+ *
+ * @note The returned structure is owned by c-env-utils. Don't free it.
+ *
+ * @returns A pointer to the cached topology.
+ *          Or a null pointer if failed or on non-Linux platforms.
+ */
+_ENVU_EXTERN const envuCacheTopology *envuGetCacheTopology(void);
+
+/**
+ * A NUMA node.
+ */
+typedef struct envuNumaNode {
+    /** The node ID. */
+    int id;
+    /** Cpus that belong to the node. */
+    envuCpuSet cpus;
+    /** The total memory of the node in bytes. 0 if unknown. */
+    uint64_t mem_total;
+    /** The free memory of the node in bytes when the topology was loaded. 0 if unknown. */
+    uint64_t mem_free;
+} envuNumaNode;
+
+/**
+ * NUMA topology.
+ */
+typedef struct envuNumaTopology {
+    /** The number of nodes. */
+    int count;
+    /** Nodes sorted by their IDs. */
+    const envuNumaNode *nodes;
+    /**
+     * The distance matrix. The distance from nodes[i] to nodes[j] is distances[i * count + j].
+     * Local access is 10 in the ACPI SLIT convention.
+     */
+    const int *distances;
+} envuNumaTopology;
+
+/**
+ * Gets the NUMA topology from /sys/devices/system/node.
+ * It is parsed only once, and the cached structure is immutable.
+ * Systems without NUMA support are reported as a single node.
+ *
+ * @note The returned structure is owned by c-env-utils. Don't free it.
+ *
+ * @returns A pointer to the cached topology.
+ *          Or a null pointer if failed or on non-Linux platforms.
+ */
+_ENVU_EXTERN const envuNumaTopology *envuGetNumaTopology(void);
+
+/**
+ * Gets the NUMA node of the cpu that the calling thread is running on.
+ * It uses getcpu(), which is usually served by the vDSO.
+ *
+ * @returns A node ID. Or -1 if failed or on non-Linux platforms.
+ */
+_ENVU_EXTERN int envuGetCurrentNumaNode(void);
+
+/**
+ * Memory information of the system and the cgroup.
+ * All sizes are in bytes. Limits are 0 when they are unlimited or unknown.
+ */
+/** A cgroup memory limit that is not set. */
+#define ENVU_MEMORY_UNLIMITED UINT64_MAX
+
+typedef struct envuMemoryInfo {
+    /** The total physical memory. (MemTotal) */
+    uint64_t total;
+    /** The available physical memory. (MemAvailable) */
+    uint64_t available;
+    /** The page size. */
+    uint64_t page_size;
+    /** The total swap space. */
+    uint64_t swap_total;
+    /** The free swap space. */
+    uint64_t swap_free;
+    /** The version of cgroup. (1 or 2) 0 if cgroup is not found. */
+    int cgroup_version;
+    /**
+     * The hard limit of the cgroup. (memory.max or memory.limit_in_bytes)
+     * ENVU_MEMORY_UNLIMITED if it's not set.
+     */
+    uint64_t cgroup_max;
+    /** The throttling limit of the cgroup. (memory.high) ENVU_MEMORY_UNLIMITED if it's not set. */
+    uint64_t cgroup_high;
+    /** The memory usage of the cgroup. (memory.current or memory.usage_in_bytes) */
+    uint64_t cgroup_usage;
+    /**
+     * The swap limit of the cgroup. (memory.swap.max or memsw.limit_in_bytes - limit_in_bytes)
+     * ENVU_MEMORY_UNLIMITED if it's not set. 0 means that swap is disabled.
+     */
+    uint64_t cgroup_swap_max;
+    /** The memory size that the process can use in total. (min of total, max, and high) */
+    uint64_t effective_limit;
+    /** The memory size that the process can additionally use now. */
+    uint64_t budget;
+} envuMemoryInfo;
+
+/**
+ * Gets memory information that honors cgroup limits.
+ * It parses /proc/meminfo in a single pass, and reads cgroup v2 (or v1) limits.
+ * Limits of ancestor cgroups are taken into account.
+ *
+ * @param out A pointer to store memory information.
+ * @returns 0 if successful. -1 indicates failure.
+ */
+_ENVU_EXTERN int envuGetMemoryInfo(envuMemoryInfo *out);
+
+/**
+ * Cpu features that envuGetCpuFeatures() can detect.
+ */
+_ENVU_ENUM(envuCpuFeature) {
+    // x86
+    ENVU_CPU_SSE2 = 0,
+    ENVU_CPU_SSE3,
+    ENVU_CPU_SSSE3,
+    ENVU_CPU_SSE4_1,
+    ENVU_CPU_SSE4_2,
+    ENVU_CPU_POPCNT,
+    ENVU_CPU_AVX,
+    ENVU_CPU_AVX2,
+    ENVU_CPU_FMA,
+    ENVU_CPU_F16C,
+    ENVU_CPU_BMI1,
+    ENVU_CPU_BMI2,
+    ENVU_CPU_LZCNT,
+    ENVU_CPU_MOVBE,
+    ENVU_CPU_AES,
+    ENVU_CPU_PCLMULQDQ,
+    ENVU_CPU_SHA,
+    ENVU_CPU_RDRAND,
+    ENVU_CPU_RDSEED,
+    ENVU_CPU_ERMS,
+    ENVU_CPU_AVX512F,
+    ENVU_CPU_AVX512DQ,
+    ENVU_CPU_AVX512CD,
+    ENVU_CPU_AVX512BW,
+    ENVU_CPU_AVX512VL,
+    ENVU_CPU_AVX512VNNI,
+    ENVU_CPU_VAES,
+    ENVU_CPU_VPCLMULQDQ,
+    // ARM
+    ENVU_CPU_NEON,
+    ENVU_CPU_ARM_AES,
+    ENVU_CPU_ARM_PMULL,
+    ENVU_CPU_ARM_SHA1,
+    ENVU_CPU_ARM_SHA2,
+    ENVU_CPU_ARM_CRC32,
+    ENVU_CPU_ARM_ATOMICS,
+    ENVU_CPU_SVE,
+    ENVU_CPU_SVE2,
+    ENVU_CPU_FEATURE_MAX,
+};
+
+/**
+ * Features and identifiers of the cpu.
+ */
+typedef struct envuCpuFeatures {
+    /** Bit flags of available features. (1 << envuCpuFeature) */
+    uint64_t features;
+    /** The vendor name. e.g. "GenuineIntel", "AuthenticAMD", "ARM". Empty if unknown. */
+    char vendor[16];
+    /** The cpu family. (The implementer on ARM) */
+    int family;
+    /** The cpu model. (The part number on ARM) */
+    int model;
+    /** The stepping. (The revision on ARM) */
+    int stepping;
+    /** The brand string. e.g. "Intel(R) Core(TM) i7-8700 CPU @ 3.20GHz". Empty if unknown. */
+    char brand[64];
+} envuCpuFeatures;
+
+/**
+ * Gets features of the cpu.
+ * It uses cpuid on x86, and checks XCR0 to see if the OS supports AVX and AVX-512 states.
+ * It reads /proc/cpuinfo on other architectures on Linux.
+ * The result is detected only once.
+ *
+ * @note The returned structure is owned by c-env-utils. Don't free it.
+ *
+ * @returns A pointer to the cached features.
+ */
+_ENVU_EXTERN const envuCpuFeatures *envuGetCpuFeatures(void);
+
+/**
+ * Returns if the cpu supports a feature or not.
+ * It only costs a load of the cached bit flags after the first call.
+ *
+ * @param feature A feature to check.
+ * @returns 1 if the feature is available. 0 otherwise.
+ */
+_ENVU_EXTERN int envuCpuHas(envuCpuFeature feature);
+
+/**
+ * Gets the name of a cpu feature. e.g. "avx2"
+ *
+ * @param feature A cpu feature.
+ * @returns The name of the feature. Or a null pointer if the feature is unknown.
+ */
+_ENVU_EXTERN const char *envuGetCpuFeatureName(envuCpuFeature feature);
+
+/**
+ * A logical cpu and its location in the topology.
+ */
+typedef struct envuLogicalCpu {
+    /** The cpu number. */
+    int id;
+    /** The core ID in the package. (topology/core_id) */
+    int core_id;
+    /** The package ID. (topology/physical_package_id) */
+    int package_id;
+    /** The NUMA node ID. */
+    int node_id;
+    /** The index in SMT siblings. 0 for the first hardware thread of the core. */
+    int smt_index;
+    /** Cpus that share the core. (topology/thread_siblings_list) */
+    envuCpuSet siblings;
+} envuLogicalCpu;
+
+/**
+ * Logical cpus and their locations.
+ */
+typedef struct envuCpuTopology {
+    /** The number of online cpus. */
+    int count;
+    /** Online cpus sorted by their IDs. */
+    const envuLogicalCpu *cpus;
+    /** The number of physical cores. */
+    int core_count;
+    /** The number of packages. (sockets) */
+    int package_count;
+} envuCpuTopology;
+
+/**
+ * Gets locations of online cpus from /sys/devices/system/cpu/cpu{@literal *}/topology.
+ * It is parsed only once, and the cached structure is immutable.
+ *
+ * @note The returned structure is owned by c-env-utils. Don't free it.
+ *
+ * @returns A pointer to the cached topology.
+ *          Or a null pointer if failed or on non-Linux platforms.
+ */
+_ENVU_EXTERN const envuCpuTopology *envuGetCpuTopology(void);
+
+/**
+ * Pins the calling thread to a cpu.
+ *
+ * @param cpu A cpu number.
+ * @returns 0 if succeeded. -1 if failed or on unsupported platforms.
+ */
+_ENVU_EXTERN int envuPinCurrentThread(int cpu);
+
+/**
+ * Gets the affinity mask of the calling thread.
+ *
+ * @param out The affinity mask will be stored here.
+ * @returns The number of cpus in the mask. Or -1 if failed or on unsupported platforms.
+ */
+_ENVU_EXTERN int envuGetThreadAffinity(envuCpuSet *out);
+
+/**
+ * Policies for envuPlanWorkers().
+ */
+_ENVU_ENUM(envuPlacementPolicy) {
+    /** Fills SMT siblings, cores, and packages in order to share caches. */
+    ENVU_PLACE_COMPACT = 0,
+    /** Uses one hardware thread per core before SMT siblings, alternating packages. */
+    ENVU_PLACE_SCATTER,
+    /** Uses one cpu per NUMA node before the second cpu of each node. */
+    ENVU_PLACE_NUMA_NODES,
+};
+
+/**
+ * Assigns cpus to worker threads based on the cpu topology.
+ * Only cpus in the affinity mask of the calling thread are used.
+ * (The mask is ignored while envuSetSysRoot() overrides the root.)
+ * When there are more workers than cpus, the assignment wraps around.
+ *
+ * @note The returned array should be freed with envuFree() after use.
+ *
+ * @param n The number of workers.
+ * @param policy A placement policy.
+ * @returns An array of n cpu numbers. The i-th worker should be pinned to the i-th cpu.
+ *          Or a null pointer if failed or on non-Linux platforms.
+ */
+_ENVU_EXTERN int *envuPlanWorkers(int n, envuPlacementPolicy policy);
+
+/**
+ * Scheduling policies.
+ */
+_ENVU_ENUM(envuSchedPolicy) {
+    ENVU_SCHED_UNKNOWN = 0,
+    ENVU_SCHED_OTHER,
+    ENVU_SCHED_FIFO,
+    ENVU_SCHED_RR,
+    ENVU_SCHED_BATCH,
+    ENVU_SCHED_IDLE,
+    ENVU_SCHED_DEADLINE,
+};
+
+/**
+ * Cpu isolation and scheduler settings.
+ */
+typedef struct envuSchedEnvironment {
+    /** Isolated cpus. (/sys/devices/system/cpu/isolated or isolcpus=) */
+    envuCpuSet isolated;
+    /** Adaptive-tick cpus. (/sys/devices/system/cpu/nohz_full or nohz_full=) */
+    envuCpuSet nohz_full;
+    /** Cpus that offload RCU callbacks. (rcu_nocbs=) */
+    envuCpuSet rcu_nocbs;
+    /** The scheduling policy of the calling thread. */
+    envuSchedPolicy policy;
+    /** The real-time priority of the calling thread. 0 for normal policies. */
+    int priority;
+    /** The nice value of the calling thread. */
+    int nice;
+    /** 1 if autogroup is enabled. 0 if disabled. -1 if unknown. */
+    int autogroup;
+    /**
+     * Kernel parameters that affect performance. e.g. "isolcpus=2-3 mitigations=off"
+     * It's an empty string if there is no such parameter.
+     */
+    const char *perf_cmdline;
+} envuSchedEnvironment;
+
+/**
+ * Gets cpu isolation and scheduler settings.
+ * /proc/cmdline and sysfs files are parsed only once,
+ * and the policy and the nice value are read on every call.
+ *
+ * @note perf_cmdline is owned by c-env-utils. Don't free it.
+ *
+ * @param out The settings will be stored here.
+ * @returns 0 if succeeded. -1 if failed or on Windows.
+ */
+_ENVU_EXTERN int envuGetSchedEnvironment(envuSchedEnvironment *out);
+
+/**
+ * Gets the value of a kernel parameter from /proc/cmdline.
+ * When a parameter appears more than once, the last one is used.
+ *
+ * @note The returned string is owned by c-env-utils. Don't free it.
+ *
+ * @param key A parameter name. e.g. "isolcpus"
+ * @returns The value of the parameter. An empty string if it has no value. (e.g. "quiet")
+ *          Or a null pointer if the parameter is not found or on non-Linux platforms.
+ */
+_ENVU_EXTERN const char *envuGetKernelCmdlineValue(const char *key);
+
+/**
+ * A huge page size and its pool.
+ */
+typedef struct envuHugePageSize {
+    /** The page size in bytes. */
+    uint64_t size;
+    /** The number of pages in the pool. (nr_hugepages) */
+    uint64_t total;
+    /** The number of free pages. (free_hugepages) */
+    uint64_t free;
+    /** The number of reserved pages that are not faulted in yet. (resv_hugepages) */
+    uint64_t reserved;
+    /** The number of surplus pages. (surplus_hugepages) */
+    uint64_t surplus;
+    /** The number of pages in each NUMA node. The order is the same as node_ids. */
+    const uint64_t *node_total;
+    /** The number of free pages in each NUMA node. The order is the same as node_ids. */
+    const uint64_t *node_free;
+    /** 1 if RLIMIT_MEMLOCK allows locking a page of this size. 0 otherwise. */
+    int can_lock;
+} envuHugePageSize;
+
+/**
+ * Huge page and transparent huge page (THP) settings.
+ */
+typedef struct envuHugePageInfo {
+    /** The number of supported huge page sizes. */
+    int size_count;
+    /** Supported huge page sizes sorted in ascending order. */
+    const envuHugePageSize *sizes;
+    /** The default huge page size in bytes. (Hugepagesize in /proc/meminfo) 0 if unknown. */
+    uint64_t default_size;
+    /** The number of NUMA nodes. */
+    int node_count;
+    /** NUMA node IDs. */
+    const int *node_ids;
+    /** The THP mode. ("always", "madvise", or "never") Empty if THP is not supported. */
+    char thp_enabled[16];
+    /** The THP defrag mode. e.g. "madvise" Empty if unknown. */
+    char thp_defrag[16];
+    /** The THP mode for shmem and tmpfs. e.g. "never" Empty if unknown. */
+    char shmem_enabled[16];
+    /** The size of THP that maps a PMD in bytes. (hpage_pmd_size) 0 if unknown. */
+    uint64_t thp_pmd_size;
+    /** The soft limit of RLIMIT_MEMLOCK in bytes. UINT64_MAX if it's unlimited. */
+    uint64_t memlock_limit;
+} envuHugePageInfo;
+
+/**
+ * Gets huge page pools from /sys/kernel/mm/hugepages and
+ * THP settings from /sys/kernel/mm/transparent_hugepage.
+ * The result is cached until envuRefreshHugePageInfo() is called.
+ *
+ * @note The returned structure is owned by c-env-utils. Don't free it.
+ *
+ * @returns A pointer to the cached information.
+ *          Or a null pointer if failed or on non-Linux platforms.
+ */
+_ENVU_EXTERN const envuHugePageInfo *envuGetHugePageInfo(void);
+
+/**
+ * Reloads page counts and the memlock limit in the cached huge page information.
+ * They are updated in place, so the structure returned by envuGetHugePageInfo() sees
+ * the new values. Supported sizes, NUMA nodes, and THP settings are loaded only once.
+ *
+ * @returns A pointer to the cached information.
+ *          Or a null pointer if failed or on non-Linux platforms.
+ */
+_ENVU_EXTERN const envuHugePageInfo *envuRefreshHugePageInfo(void);
+
+/**
+ * How envuAuditTunables() compares a tunable with the recommended value.
+ */
+_ENVU_ENUM(envuTunableCheck) {
+    /** The value should be equal to the recommended one. */
+    ENVU_TUNABLE_EQ = 0,
+    /** The value should not be equal to the recommended one. */
+    ENVU_TUNABLE_NE,
+    /** The value should be the recommended one or more. */
+    ENVU_TUNABLE_MIN,
+    /** The value should be the recommended one or less. */
+    ENVU_TUNABLE_MAX,
+};
+
+/**
+ * A recommendation for a tunable in /proc/sys.
+ */
+typedef struct envuTunableRule {
+    /** The sysctl name. e.g. "vm.swappiness" */
+    const char *name;
+    /** How to compare the value. */
+    envuTunableCheck check;
+    /** The recommended value. */
+    long long value;
+    /** Why the value is recommended. It can be a null pointer. */
+    const char *reason;
+} envuTunableRule;
+
+/**
+ * Results of envuAuditTunables().
+ */
+_ENVU_ENUM(envuTunableStatus) {
+    /** The value follows the recommendation. */
+    ENVU_TUNABLE_OK = 0,
+    /** The value doesn't follow the recommendation. */
+    ENVU_TUNABLE_MISMATCH,
+    /** The tunable doesn't exist or is not readable. */
+    ENVU_TUNABLE_UNAVAILABLE,
+};
+
+/**
+ * A finding for a tunable.
+ */
+typedef struct envuTunableFinding {
+    /** The sysctl name. */
+    const char *name;
+    /** The result of the check. */
+    envuTunableStatus status;
+    /** The current value. (The first number for tunables that have multiple numbers) */
+    long long actual;
+    /** How the value is compared. */
+    envuTunableCheck check;
+    /** The recommended value. */
+    long long recommended;
+    /** Why the value is recommended. It can be a null pointer. */
+    const char *reason;
+} envuTunableFinding;
+
+/**
+ * A report of envuAuditTunables().
+ */
+typedef struct envuTunableReport {
+    /** The number of findings. */
+    int count;
+    /** The number of findings that don't follow recommendations. */
+    int mismatch_count;
+    /** Findings in the order of the rules. */
+    envuTunableFinding *findings;
+} envuTunableReport;
+
+/**
+ * Gets the built-in recommendations for performance-relevant tunables.
+ * e.g. vm.swappiness, vm.overcommit_memory, vm.dirty_ratio, and net.core.somaxconn
+ *
+ * @param rule_count The number of rules will be stored here if it's not a null pointer.
+ * @returns A static array of rules.
+ */
+_ENVU_EXTERN const envuTunableRule *envuGetDefaultTunableRules(int *rule_count);
+
+/**
+ * Audits /proc/sys with the built-in recommendations.
+ *
+ * @note Findings should be freed with envuFree(out->findings) after use.
+ *
+ * @param out The report will be stored here.
+ * @returns The number of mismatches. Or -1 if failed or on non-Linux platforms.
+ */
+_ENVU_EXTERN int envuAuditTunables(envuTunableReport *out);
+
+/**
+ * Audits /proc/sys with caller-supplied recommendations.
+ * All values are read in a single batch relative to a descriptor of /proc/sys.
+ * envuSetSysRoot() also affects the location of /proc/sys.
+ *
+ * @note Findings should be freed with envuFree(out->findings) after use.
+ *       Strings in the findings are copied from the rules.
+ *
+ * @param rules An array of rules.
+ * @param rule_count The number of rules.
+ * @param out The report will be stored here.
+ * @returns The number of mismatches. Or -1 if failed or on non-Linux platforms.
+ */
+_ENVU_EXTERN int envuAuditTunablesWithRules(const envuTunableRule *rules, int rule_count,
+                                            envuTunableReport *out);
+
+/**
+ * Resources that Pressure Stall Information (PSI) tracks.
+ */
+_ENVU_ENUM(envuPressureResource) {
+    ENVU_PRESSURE_CPU = 0,
+    ENVU_PRESSURE_MEMORY,
+    ENVU_PRESSURE_IO,
+};
+
+/**
+ * A line of PSI. e.g. "some avg10=0.00 avg60=0.00 avg300=0.00 total=0"
+ */
+typedef struct envuPressureStat {
+    /** The percentage of stalled time in the last 10 seconds. */
+    double avg10;
+    /** The percentage of stalled time in the last 60 seconds. */
+    double avg60;
+    /** The percentage of stalled time in the last 300 seconds. */
+    double avg300;
+    /** The total stalled time in microseconds. */
+    uint64_t total;
+} envuPressureStat;
+
+/**
+ * Pressure of a resource.
+ */
+typedef struct envuPressure {
+    /** Stalls where at least one task was waiting. */
+    envuPressureStat some;
+    /** Stalls where all non-idle tasks were waiting. Zeros if has_full is 0. */
+    envuPressureStat full;
+    /** 1 if the "full" line exists. (The system-wide cpu pressure had no "full" before 5.13) */
+    int has_full;
+    /** 1 if the values are read from the cgroup of the process. 0 if they are system-wide. */
+    int from_cgroup;
+} envuPressure;
+
+/**
+ * Gets the pressure of a resource.
+ * It reads {cpu,memory,io}.pressure of the cgroup v2 that the process belongs to,
+ * or /proc/pressure/{cpu,memory,io} when the cgroup file is not available.
+ *
+ * @param resource A resource.
+ * @param out The pressure will be stored here.
+ * @returns 0 if succeeded.
+ *          -1 if failed, the kernel doesn't support PSI, or on non-Linux platforms.
+ *          Callers should fall back to other metrics like envuGetMemoryInfo() then.
+ */
+_ENVU_EXTERN int envuGetPressure(envuPressureResource resource, envuPressure *out);
+
+/**
+ * Creates a PSI trigger that notifies when "some" tasks stall for threshold_us
+ * in a window_us time window.
+ * The returned file descriptor reports POLLPRI to poll() or epoll when the trigger fires,
+ * and POLLERR when the cgroup is removed. Close it with close() to unsubscribe.
+ * The file is selected in the same way as envuGetPressure().
+ *
+ * @note The kernel requires the window to be between 500ms and 10s.
+ *       Unprivileged processes also need the window to be a multiple of 2s.
+ *
+ * @param resource A resource.
+ * @param threshold_us The stall time in microseconds. It should be less than the window.
+ * @param window_us The time window in microseconds.
+ * @returns A pollable file descriptor.
+ *          Or -1 if failed, the kernel doesn't support PSI triggers, or on non-Linux platforms.
+ */
+_ENVU_EXTERN int envuSubscribePressure(envuPressureResource resource,
+                                       uint64_t threshold_us, uint64_t window_us);
+
+/**
+ * Sources that envuNowNs() uses.
+ */
+_ENVU_ENUM(envuNowSource) {
+    /** clock_gettime(CLOCK_MONOTONIC) or QueryPerformanceCounter on Windows */
+    ENVU_NOW_MONOTONIC = 0,
+    /** The invariant TSC scaled to nanoseconds */
+    ENVU_NOW_TSC,
+};
+
+/**
+ * Clock sources and their costs.
+ */
+typedef struct envuClockInfo {
+    /** The current clocksource. e.g. "tsc", "kvm-clock", "hpet" Empty if unknown. */
+    char current_clocksource[32];
+    /** Available clocksources separated by spaces. e.g. "tsc hpet acpi_pm" */
+    char available_clocksources[128];
+    /** 1 if clock_gettime() is served by the vDSO with the current clocksource. */
+    int vdso;
+    /** 1 if the TSC ticks at a constant rate regardless of frequency scaling. (constant_tsc) */
+    int constant_tsc;
+    /** 1 if the TSC keeps ticking in deep C-states. (nonstop_tsc) */
+    int nonstop_tsc;
+    /** The TSC frequency in Hz from cpuid. 0 if unknown. */
+    uint64_t tsc_hz;
+    /** The measured cost of clock_gettime(CLOCK_MONOTONIC) in nanoseconds per call. */
+    double monotonic_ns;
+    /** The measured cost of clock_gettime(CLOCK_MONOTONIC_COARSE). 0 if it's not supported. */
+    double coarse_ns;
+    /** The resolution of CLOCK_MONOTONIC_COARSE in nanoseconds. 0 if it's not supported. */
+    uint64_t coarse_resolution_ns;
+    /** The source that envuNowNs() uses. */
+    envuNowSource now_source;
+} envuClockInfo;
+
+/**
+ * Gets clocksources from /sys/devices/system/clocksource,
+ * TSC flags, and measured costs of clocks.
+ * It's measured only once. The first call takes about 2000 clock_gettime() calls.
+ *
+ * @note The returned structure is owned by c-env-utils. Don't free it.
+ * @note On Windows, only monotonic_ns (the cost of QueryPerformanceCounter) and now_source
+ *       are reported. Clocksources and TSC fields are empty.
+ *
+ * @returns A pointer to the cached information.
+ */
+_ENVU_EXTERN const envuClockInfo *envuGetClockInfo(void);
+
+/**
+ * Gets a monotonic timestamp in nanoseconds with the cheapest safe source.
+ * It reads the TSC directly when the TSC is invariant and the kernel uses it as
+ * the current clocksource. Otherwise, it uses CLOCK_MONOTONIC.
+ * The TSC is re-anchored to CLOCK_MONOTONIC every second, and it's used after
+ * 100ms of calibration when cpuid doesn't report its frequency.
+ * The source is selected on the first call. It doesn't measure costs of clocks.
+ *
+ * @returns Nanoseconds from an arbitrary point in the past.
+ */
+_ENVU_EXTERN uint64_t envuNowNs(void);
+
+/**
+ * Hypervisors that envuGetVirtualization() can detect.
+ */
+_ENVU_ENUM(envuHypervisor) {
+    /** Bare metal */
+    ENVU_HV_NONE = 0,
+    /** A hypervisor is detected, but its type is unknown. */
+    ENVU_HV_UNKNOWN,
+    ENVU_HV_KVM,
+    ENVU_HV_QEMU,
+    ENVU_HV_XEN,
+    ENVU_HV_HYPERV,
+    ENVU_HV_VMWARE,
+    ENVU_HV_VIRTUALBOX,
+    ENVU_HV_PARALLELS,
+    ENVU_HV_BHYVE,
+    ENVU_HV_ACRN,
+    ENVU_HV_FIRECRACKER,
+    ENVU_HV_WSL,
+};
+
+/**
+ * Containers and sandboxes that envuGetVirtualization() can detect.
+ */
+_ENVU_ENUM(envuContainer) {
+    ENVU_CONTAINER_NONE = 0,
+    /** A container is detected, but its type is unknown. */
+    ENVU_CONTAINER_UNKNOWN,
+    ENVU_CONTAINER_DOCKER,
+    ENVU_CONTAINER_PODMAN,
+    ENVU_CONTAINER_KUBERNETES,
+    ENVU_CONTAINER_LXC,
+    ENVU_CONTAINER_SYSTEMD_NSPAWN,
+    ENVU_CONTAINER_GVISOR,
+};
+
+/**
+ * Cloud providers that envuGetVirtualization() can detect.
+ */
+_ENVU_ENUM(envuCloud) {
+    ENVU_CLOUD_NONE = 0,
+    ENVU_CLOUD_AWS,
+    ENVU_CLOUD_GCP,
+    ENVU_CLOUD_AZURE,
+    ENVU_CLOUD_ALIBABA,
+    ENVU_CLOUD_ORACLE,
+    ENVU_CLOUD_DIGITALOCEAN,
+    ENVU_CLOUD_OPENSTACK,
+};
+
+/**
+ * How reliable a detection is.
+ */
+_ENVU_ENUM(envuConfidence) {
+    /** Only weak hints are found, or nothing can be checked. */
+    ENVU_CONFIDENCE_LOW = 0,
+    /** A single source reports the result. */
+    ENVU_CONFIDENCE_MEDIUM,
+    /** Multiple sources agree, or a definitive source reports the result. */
+    ENVU_CONFIDENCE_HIGH,
+};
+
+/**
+ * Virtualization environment.
+ */
+typedef struct envuVirtualization {
+    /** The hypervisor. */
+    envuHypervisor hypervisor;
+    /** The confidence of the hypervisor. */
+    envuConfidence hypervisor_confidence;
+    /** The name of the hypervisor. e.g. "kvm", "none" */
+    const char *hypervisor_name;
+    /** The container. */
+    envuContainer container;
+    /** The confidence of the container. */
+    envuConfidence container_confidence;
+    /** The name of the container. e.g. "docker", "none" */
+    const char *container_name;
+    /** The cloud provider. */
+    envuCloud cloud;
+    /** The name of the cloud provider. e.g. "aws", "none" */
+    const char *cloud_name;
+    /** The hypervisor vendor from cpuid leaf 0x40000000. e.g. "KVMKVMKVM" Empty if unknown. */
+    char cpuid_vendor[16];
+    /** The system vendor from DMI. (sys_vendor) Empty if unknown. */
+    char dmi_vendor[64];
+    /** The product name from DMI. (product_name) Empty if unknown. */
+    char dmi_product[64];
+} envuVirtualization;
+
+/**
+ * Detects the hypervisor, the container, and the cloud provider.
+ * It combines the cpuid hypervisor leaf, /sys/hypervisor, DMI strings in /sys/class/dmi/id,
+ * /proc/sys/kernel/osrelease, /proc/1/cgroup, /proc/1/environ, /.dockerenv,
+ * /run/.containerenv, and /run/systemd/container.
+ * The result is cached. cpuid is not used while envuSetSysRoot() overrides the root.
+ *
+ * @note The returned structure is owned by c-env-utils. Don't free it.
+ *
+ * @returns A pointer to the cached result.
+ *          Or a null pointer if failed or on non-Linux platforms.
+ */
+_ENVU_EXTERN const envuVirtualization *envuGetVirtualization(void);
+
+/**
+ * Frequency scaling state of a logical CPU.
+ */
+typedef struct envuCpuFreq {
+    /** The logical CPU number. */
+    int cpu;
+    /** The scaling governor. e.g. "performance", "powersave" Empty if unknown. */
+    char governor[32];
+    /** The scaling driver. e.g. "intel_pstate", "acpi-cpufreq" Empty if unknown. */
+    char driver[32];
+    /** The current frequency in kHz. 0 if unknown. */
+    uint64_t cur_khz;
+    /** The minimum frequency that the governor can select in kHz. 0 if unknown. */
+    uint64_t min_khz;
+    /** The maximum frequency that the governor can select in kHz. 0 if unknown. */
+    uint64_t max_khz;
+} envuCpuFreq;
+
+/**
+ * Bit flags of settings that can make benchmark results unstable.
+ */
+_ENVU_ENUM(envuBenchWarning) {
+    /** Some CPUs don't use the performance governor. */
+    ENVU_BENCH_WARN_GOVERNOR = 1 << 0,
+    /** Turbo boost is enabled. */
+    ENVU_BENCH_WARN_TURBO = 1 << 1,
+    /** SMT siblings are online. */
+    ENVU_BENCH_WARN_SMT = 1 << 2,
+    /** Address space layout randomization is enabled. */
+    ENVU_BENCH_WARN_ASLR = 1 << 3,
+    /** The 1-minute load average is high for the number of CPUs. */
+    ENVU_BENCH_WARN_LOAD = 1 << 4,
+    /** The process runs on a hypervisor. */
+    ENVU_BENCH_WARN_VM = 1 << 5,
+    /** The process runs in a container. */
+    ENVU_BENCH_WARN_CONTAINER = 1 << 6,
+};
+
+/**
+ * Settings that affect the stability of benchmarks.
+ */
+typedef struct envuBenchEnvironment {
+    /** The number of online CPUs. */
+    int cpu_count;
+    /** Frequency scaling state of online CPUs. */
+    envuCpuFreq *cpus;
+    /** 1 if turbo boost is enabled, 0 if disabled, or -1 if unknown. */
+    int turbo;
+    /** The SMT control. e.g. "on", "off", "forceoff", "notsupported" Empty if unknown. */
+    char smt_control[16];
+    /** 1 if SMT siblings are online, 0 if not, or -1 if unknown. */
+    int smt_active;
+    /** The value of kernel.randomize_va_space. Or -1 if unknown. */
+    int aslr;
+    /** Load averages over 1, 5, and 15 minutes. Negative values if unknown. */
+    double loadavg[3];
+    /** The number of runnable threads. Or -1 if unknown. */
+    int runnable;
+    /** The name of the hypervisor. e.g. "kvm", "none", "unknown" */
+    const char *hypervisor;
+    /** The name of the container. e.g. "docker", "none", "unknown" */
+    const char *container;
+    /** Bit flags of envuBenchWarning. */
+    unsigned int warnings;
+    /** The number of warning messages. */
+    int warning_count;
+    /** Human readable warning messages. */
+    const char **warning_messages;
+} envuBenchEnvironment;
+
+/**
+ * Captures settings that can make benchmark results unstable.
+ * It reads cpufreq, intel_pstate/no_turbo, cpufreq/boost, and smt in /sys/devices/system/cpu,
+ * /proc/sys/kernel/randomize_va_space, /proc/loadavg, and envuGetVirtualization().
+ * Unlike other system queries, the result is not cached because it changes at runtime.
+ *
+ * @note Returned value should be freed with envuFree after use.
+ *
+ * @returns The captured environment.
+ *          Or a null pointer if failed or on non-Linux platforms.
+ */
+_ENVU_EXTERN envuBenchEnvironment *envuGetBenchEnvironment(void);
+
+/**
+ * Serializes a benchmark environment into a JSON object
+ * so that benchmark harnesses can attach it to results.
+ *
+ * @note Returned value should be freed with envuFree after use.
+ *
+ * @param env A benchmark environment from envuGetBenchEnvironment().
+ * @returns A JSON string. Or a null pointer if failed.
+ */
+_ENVU_EXTERN char *envuSerializeBenchEnvironment(const envuBenchEnvironment *env);
+
+/**
+ * Per-process resource limits. (RLIMIT_*)
+ */
+_ENVU_ENUM(envuResource) {
+    /** Address space. (RLIMIT_AS) */
+    ENVU_RLIMIT_AS = 0,
+    /** Core dump size. (RLIMIT_CORE) */
+    ENVU_RLIMIT_CORE,
+    /** CPU time in seconds. (RLIMIT_CPU) */
+    ENVU_RLIMIT_CPU,
+    /** Data segment size. (RLIMIT_DATA) */
+    ENVU_RLIMIT_DATA,
+    /** File size. (RLIMIT_FSIZE) */
+    ENVU_RLIMIT_FSIZE,
+    /** Locked memory. (RLIMIT_MEMLOCK) io_uring and mlock() need it. */
+    ENVU_RLIMIT_MEMLOCK,
+    /** Bytes in POSIX message queues. (RLIMIT_MSGQUEUE) */
+    ENVU_RLIMIT_MSGQUEUE,
+    /** Ceiling of the nice value. (RLIMIT_NICE) */
+    ENVU_RLIMIT_NICE,
+    /** Open file descriptors. (RLIMIT_NOFILE) */
+    ENVU_RLIMIT_NOFILE,
+    /** Processes or threads of the user. (RLIMIT_NPROC) */
+    ENVU_RLIMIT_NPROC,
+    /** Resident set size. (RLIMIT_RSS) */
+    ENVU_RLIMIT_RSS,
+    /** Real-time priority. (RLIMIT_RTPRIO) */
+    ENVU_RLIMIT_RTPRIO,
+    /** CPU time of real-time threads in microseconds. (RLIMIT_RTTIME) */
+    ENVU_RLIMIT_RTTIME,
+    /** Queued signals. (RLIMIT_SIGPENDING) */
+    ENVU_RLIMIT_SIGPENDING,
+    /** Stack size of the main thread. (RLIMIT_STACK) */
+    ENVU_RLIMIT_STACK,
+    ENVU_RLIMIT_MAX,
+};
+
+/** A resource limit value that means no limit. */
+#define ENVU_RLIM_INFINITY UINT64_MAX
+
+/**
+ * A resource limit.
+ */
+typedef struct envuResourceLimit {
+    /** The name of the limit. e.g. "nofile" */
+    const char *name;
+    /** 1 if the platform supports the limit. 0 otherwise. */
+    int supported;
+    /** The soft limit. ENVU_RLIM_INFINITY means no limit. */
+    uint64_t soft;
+    /** The hard limit. ENVU_RLIM_INFINITY means no limit. */
+    uint64_t hard;
+} envuResourceLimit;
+
+/**
+ * Per-process resource limits and system-wide caps.
+ */
+typedef struct envuResourceLimits {
+    /** Resource limits indexed by envuResource. */
+    envuResourceLimit limits[ENVU_RLIMIT_MAX];
+    /** The max hard limit of RLIMIT_NOFILE. (fs.nr_open) -1 if unknown. */
+    long long nr_open;
+    /** The max number of open files in the system. (fs.file-max) -1 if unknown. */
+    long long file_max;
+    /** The max number of threads in the system. (kernel.threads-max) -1 if unknown. */
+    long long threads_max;
+    /** The max process id plus one. (kernel.pid_max) -1 if unknown. */
+    long long pid_max;
+} envuResourceLimits;
+
+/**
+ * Gets all resource limits of the process and system-wide caps.
+ * On Linux, system-wide caps are read from /proc/sys.
+ * On macOS and FreeBSD, they come from kern.maxfilesperproc, kern.maxfiles, and kern.maxproc.
+ * On Windows, only ENVU_RLIMIT_NOFILE is supported as the max number of stdio streams.
+ *
+ * @param out Limits will be stored here.
+ * @returns 0 if succeeded. Or -1 if failed.
+ */
+_ENVU_EXTERN int envuGetResourceLimits(envuResourceLimits *out);
+
+/**
+ * Raises the soft limit of a resource as far toward the hard limit as possible.
+ * It never lowers the limit.
+ *
+ * @note On macOS, the soft limit of ENVU_RLIMIT_NOFILE can't exceed OPEN_MAX
+ *       even if the hard limit is unlimited. ENVU_RLIM_INFINITY succeeds at OPEN_MAX there.
+ *
+ * @param resource A resource.
+ * @param desired The desired soft limit. ENVU_RLIM_INFINITY requests the hard limit.
+ * @param achieved The soft limit after the call will be stored here if it's not a null pointer.
+ * @returns 0 if the soft limit reaches the desired value (or the hard limit or
+ *          the platform maximum for ENVU_RLIM_INFINITY).
+ *          Or -1 if it's capped, unsupported, or failed.
+ */
+_ENVU_EXTERN int envuRaiseLimit(envuResource resource, uint64_t desired, uint64_t *achieved);
+
+/**
+ * Cumulative counters of a process.
+ */
+typedef struct envuProcessCounters {
+    /** CPU time in user mode in nanoseconds. */
+    uint64_t user_ns;
+    /** CPU time in kernel mode in nanoseconds. */
+    uint64_t system_ns;
+    /** Page faults that didn't need I/O. */
+    uint64_t minor_faults;
+    /** Page faults that needed I/O. */
+    uint64_t major_faults;
+    /** Context switches because the process waited for a resource. */
+    uint64_t voluntary_switches;
+    /** Context switches because the scheduler preempted the process. */
+    uint64_t involuntary_switches;
+} envuProcessCounters;
+
+/**
+ * A sample of process resource usage.
+ */
+typedef struct envuProcessSample {
+    /** CLOCK_MONOTONIC time of the sample in nanoseconds. */
+    uint64_t timestamp_ns;
+    /** Time since the previous sample in nanoseconds. 0 for the first sample. */
+    uint64_t elapsed_ns;
+    /** Resident set size in bytes. */
+    uint64_t rss;
+    /** Change in the resident set size since the previous sample. */
+    int64_t delta_rss;
+    /** The number of threads. */
+    int thread_count;
+    /** The number of open file descriptors except the ones of the sampler. -1 if unknown. */
+    int fd_count;
+    /** Counters since the process started. */
+    envuProcessCounters total;
+    /** Counters since the previous sample. All zero for the first sample. */
+    envuProcessCounters delta;
+    /** CPU usage since the previous sample. 1.0 means a whole CPU. */
+    double cpu_usage;
+} envuProcessSample;
+
+/**
+ * A sampler that keeps /proc files of a process open.
+ */
+typedef struct envuSampler envuSampler;
+
+/**
+ * Opens a sampler for a process.
+ * It keeps /proc/[pid]/stat, /proc/[pid]/status, and /proc/[pid]/fd open
+ * so that envuSample() only needs pread() and no memory allocations.
+ *
+ * @note Returned value should be closed with envuCloseSampler after use.
+ *
+ * @param pid A process id. Or 0 for the current process.
+ * @returns A sampler. Or a null pointer if failed or on non-Linux platforms.
+ */
+_ENVU_EXTERN envuSampler *envuOpenSampler(int pid);
+
+/**
+ * Takes a sample of resource usage.
+ *
+ * @param sampler A sampler from envuOpenSampler().
+ * @param out The sample will be stored here.
+ * @returns 0 if succeeded. Or -1 if failed. (e.g. The process exited.)
+ */
+_ENVU_EXTERN int envuSample(envuSampler *sampler, envuProcessSample *out);
+
+/**
+ * Closes a sampler.
+ *
+ * @param sampler A sampler from envuOpenSampler(). It can be a null pointer.
+ */
+_ENVU_EXTERN void envuCloseSampler(envuSampler *sampler);
+
+/**
+ * Bit flags of optional fields for envuSnapshotProcesses().
+ */
+_ENVU_ENUM(envuProcessField) {
+    /** The executable path. (/proc/[pid]/exe) */
+    ENVU_PROC_EXE = 1 << 0,
+    /** The command line. (/proc/[pid]/cmdline) */
+    ENVU_PROC_CMDLINE = 1 << 1,
+    /** Environment variables listed in envuProcessFilter. (/proc/[pid]/environ) */
+    ENVU_PROC_ENVIRON = 1 << 2,
+    /** The cgroup path. (/proc/[pid]/cgroup) */
+    ENVU_PROC_CGROUP = 1 << 3,
+    /** Lists threads as well as processes. (/proc/[pid]/task) */
+    ENVU_PROC_THREADS = 1 << 4,
+};
+
+/** The max number of environment variables that envuSnapshotProcesses() can capture. */
+#define ENVU_MAX_PROCESS_ENV 32
+
+/**
+ * Conditions and options for envuSnapshotProcesses().
+ */
+typedef struct envuProcessFilter {
+    /** Only processes with this command name. (comm) Or a null pointer for any. */
+    const char *comm;
+    /** 1 to filter processes with uid. 0 otherwise. */
+    int has_uid;
+    /** Only processes owned by this user if has_uid is 1. */
+    unsigned int uid;
+    /** Names of environment variables to capture with ENVU_PROC_ENVIRON. */
+    const char **env_names;
+    /** The number of env_names. Up to ENVU_MAX_PROCESS_ENV. */
+    int env_name_count;
+    /** The number of threads to scan /proc. 0 means automatic. */
+    int thread_count;
+} envuProcessFilter;
+
+/**
+ * A process or a thread in a snapshot.
+ */
+typedef struct envuProcess {
+    /** The process id. Or the thread id for threads. */
+    int pid;
+    /** The process id of the thread group. The same as pid for processes. */
+    int tgid;
+    /** The parent process id. */
+    int ppid;
+    /** The owner. */
+    unsigned int uid;
+    /** The state. e.g. 'R', 'S', 'D', 'Z' */
+    char state;
+    /** 1 if it's a thread that is not the main thread. 0 otherwise. */
+    int is_thread;
+    /** The start time in clock ticks after boot. */
+    uint64_t start_time;
+    /** The command name. */
+    const char *comm;
+    /** The executable path. Null if not requested or not readable. */
+    const char *exe;
+    /** Arguments separated by spaces. Null if not requested or not readable. */
+    const char *cmdline;
+    /** The cgroup v2 path, or the path in the first hierarchy. Null if not requested. */
+    const char *cgroup;
+    /**
+     * Values of envuProcessSnapshot::env_names. Items are null for unset variables.
+     * Null if not requested or not readable.
+     */
+    const char **env_values;
+} envuProcess;
+
+/**
+ * A snapshot of the process table.
+ */
+typedef struct envuProcessSnapshot {
+    /** The number of processes and threads. */
+    int count;
+    /** Processes sorted by tgid. Threads follow their main thread. */
+    envuProcess *processes;
+    /** Bit flags of envuProcessField that were requested. */
+    unsigned int fields;
+    /** The number of env_names. */
+    int env_name_count;
+    /** Names of captured environment variables. */
+    const char **env_names;
+    /** The number of processes copied from the previous snapshot. */
+    int reused_count;
+    /** A copy of the filter. */
+    envuProcessFilter filter;
+} envuProcessSnapshot;
+
+/**
+ * Takes a snapshot of the process table.
+ * It scans /proc with getdents64, shares per-process work between threads,
+ * reads only the requested fields, and stores everything in a single memory block.
+ * Processes that exit during the scan are skipped.
+ *
+ * @note Returned value should be freed with envuFree after use.
+ *
+ * @param fields Bit flags of envuProcessField.
+ * @param filter Conditions and options. It can be a null pointer.
+ * @returns A snapshot. Or a null pointer if failed or on non-Linux platforms.
+ */
+_ENVU_EXTERN envuProcessSnapshot *envuSnapshotProcesses(unsigned int fields,
+                                                        const envuProcessFilter *filter);
+
+/**
+ * Takes a new snapshot with the fields and filter of a previous snapshot.
+ * Optional fields are only read for processes whose pid and start time are new.
+ * Others are copied from the previous snapshot.
+ *
+ * @note Returned value should be freed with envuFree after use.
+ *       The previous snapshot is not freed.
+ *
+ * @param prev A snapshot from envuSnapshotProcesses() or envuUpdateProcessSnapshot().
+ * @returns A snapshot. Or a null pointer if failed or on non-Linux platforms.
+ */
+_ENVU_EXTERN envuProcessSnapshot *envuUpdateProcessSnapshot(const envuProcessSnapshot *prev);
+
+/**
+ * Characteristics of a block device. (/sys/dev/block/[major]:[minor])
+ */
+typedef struct envuBlockDevice {
+    /** The device name. e.g. "sda", "nvme0n1", "dm-0" */
+    char name[32];
+    /** The major number. */
+    unsigned int major;
+    /** The minor number. */
+    unsigned int minor;
+    /** 1 for rotational disks, 0 for solid state drives, or -1 if unknown. */
+    int rotational;
+    /** 1 if it's an NVMe namespace. 0 otherwise. */
+    int is_nvme;
+    /** The smallest unit that the device can address in bytes. 0 if unknown. */
+    unsigned int logical_block_size;
+    /** The smallest unit that the device can write without read-modify-write. 0 if unknown. */
+    unsigned int physical_block_size;
+    /** The max number of requests in the queue. -1 if unknown. */
+    int nr_requests;
+    /** The active I/O scheduler. e.g. "mq-deadline", "none" Empty if unknown. */
+    char scheduler[32];
+    /** The max size of a request in KiB. 0 if unknown. */
+    unsigned int max_sectors_kb;
+    /** The read-ahead size in KiB. -1 if unknown. */
+    int read_ahead_kb;
+} envuBlockDevice;
+
+/**
+ * Block devices under a path.
+ */
+typedef struct envuStorageInfo {
+    /**
+     * The device that the filesystem is on. e.g. a partition or a device-mapper device.
+     * Queue attributes of partitions come from their disks.
+     */
+    envuBlockDevice top;
+    /** The type of the top device. "disk", "partition", "dm", or "md" */
+    char type[16];
+    /** The number of physical devices. */
+    int device_count;
+    /** Physical devices under partitions, device-mapper, and md stacks. */
+    const envuBlockDevice *devices;
+    /** 1 if any physical device is rotational. 0 if none is. -1 if unknown. */
+    int rotational;
+    /** 1 if all physical devices are NVMe. 0 otherwise. */
+    int is_nvme;
+} envuStorageInfo;
+
+/**
+ * Gets block devices under a path.
+ * It maps st_dev of the path to /sys/dev/block/[major]:[minor],
+ * and follows partitions, device-mapper, and md stacks to physical devices.
+ * Results are cached per device, and the sysfs root follows envuSetSysRoot().
+ *
+ * @note The returned structure is owned by c-env-utils. Don't free it.
+ *
+ * @param path A path to a file or a directory.
+ * @returns Block devices under the path.
+ *          Or a null pointer if failed, if the filesystem has no block device (e.g. tmpfs),
+ *          or on non-Linux platforms.
+ */
+_ENVU_EXTERN const envuStorageInfo *envuGetStorageInfo(const char *path);
+
+/**
+ * Gets block devices under a device number. This is envuGetStorageInfo() without stat().
+ *
+ * @note The returned structure is owned by c-env-utils. Don't free it.
+ *
+ * @param major The major number of a block device.
+ * @param minor The minor number of a block device.
+ * @returns Block devices under the device.
+ *          Or a null pointer if failed or on non-Linux platforms.
+ */
+_ENVU_EXTERN const envuStorageInfo *envuGetStorageInfoForDevice(unsigned int major,
+                                                                unsigned int minor);
+
+/**
+ * Filesystem types that envuGetFsCapabilities() can detect.
+ */
+_ENVU_ENUM(envuFsType) {
+    /** The filesystem is not in this list. See fs_magic. */
+    ENVU_FS_UNKNOWN = 0,
+    /** ext2, ext3, or ext4. They share the same magic number. */
+    ENVU_FS_EXT4,
+    ENVU_FS_XFS,
+    ENVU_FS_BTRFS,
+    ENVU_FS_TMPFS,
+    ENVU_FS_OVERLAYFS,
+    ENVU_FS_NFS,
+    ENVU_FS_FUSE,
+};
+
+/**
+ * Bit flags of mount options. (f_flag of statvfs)
+ */
+_ENVU_ENUM(envuMountFlag) {
+    ENVU_MOUNT_RDONLY = 1 << 0,
+    ENVU_MOUNT_NOSUID = 1 << 1,
+    ENVU_MOUNT_NODEV = 1 << 2,
+    ENVU_MOUNT_NOEXEC = 1 << 3,
+    ENVU_MOUNT_SYNCHRONOUS = 1 << 4,
+    ENVU_MOUNT_NOATIME = 1 << 5,
+    ENVU_MOUNT_NODIRATIME = 1 << 6,
+    ENVU_MOUNT_RELATIME = 1 << 7,
+};
+
+/**
+ * Bit flags of fallocate() modes.
+ */
+_ENVU_ENUM(envuFallocateMode) {
+    /** Allocates blocks and extends the file. (mode 0) */
+    ENVU_FALLOC_DEFAULT = 1 << 0,
+    /** FALLOC_FL_KEEP_SIZE */
+    ENVU_FALLOC_KEEP_SIZE = 1 << 1,
+    /** FALLOC_FL_PUNCH_HOLE */
+    ENVU_FALLOC_PUNCH_HOLE = 1 << 2,
+    /** FALLOC_FL_ZERO_RANGE */
+    ENVU_FALLOC_ZERO_RANGE = 1 << 3,
+    /** FALLOC_FL_COLLAPSE_RANGE */
+    ENVU_FALLOC_COLLAPSE_RANGE = 1 << 4,
+    /** FALLOC_FL_INSERT_RANGE */
+    ENVU_FALLOC_INSERT_RANGE = 1 << 5,
+};
+
+/**
+ * Capabilities of a filesystem.
+ */
+typedef struct envuFsCapabilities {
+    /** The filesystem type. */
+    envuFsType type;
+    /** The name of the type. e.g. "ext4", "tmpfs" "unknown" for ENVU_FS_UNKNOWN. */
+    const char *type_name;
+    /** The magic number of the filesystem. (f_type of statfs) */
+    uint64_t fs_magic;
+    /** The filesystem ID. (f_fsid of statfs) */
+    uint64_t fs_id;
+    /** The preferred block size for I/O in bytes. */
+    uint64_t block_size;
+    /** The size of the filesystem in bytes. */
+    uint64_t total_bytes;
+    /** Free bytes including blocks reserved for root. */
+    uint64_t free_bytes;
+    /** Free bytes for unprivileged users. */
+    uint64_t available_bytes;
+    /** Mount options. (envuMountFlag) */
+    unsigned int mount_flags;
+    /** 1 if probes ran in a temporary file. 0 if the directory is not writable. */
+    int probed;
+    /** 1 if O_DIRECT I/O works, 0 if not, -1 if not probed. */
+    int o_direct;
+    /** 1 if FICLONE (reflink) works, 0 if not, -1 if not probed. */
+    int reflink;
+    /** 1 if copy_file_range() works, 0 if not, -1 if not probed. */
+    int copy_file_range;
+    /** 1 if files can have holes, 0 if not, -1 if not probed. */
+    int sparse_files;
+    /** Supported fallocate() modes. (envuFallocateMode) 0 if none or not probed. */
+    unsigned int fallocate_modes;
+} envuFsCapabilities;
+
+/**
+ * Gets the type, the size, mount options, and I/O capabilities of the filesystem under a path.
+ * It uses statfs() and statvfs(), then probes O_DIRECT, FICLONE, fallocate() modes,
+ * copy_file_range(), and sparse files in a private temporary file in the directory.
+ * (O_TMPFILE, or a file that is unlinked right after creation)
+ * Probe results are cached per filesystem ID. Sizes are read on every call.
+ *
+ * @param path A path to a file or a directory.
+ * @param out A pointer to a structure that receives the capabilities.
+ * @returns 0 if succeeded. -1 if failed or on non-Linux platforms.
+ */
+_ENVU_EXTERN int envuGetFsCapabilities(const char *path, envuFsCapabilities *out);
+
+/**
+ * Bit flags of mount propagation types. 0 means private.
+ */
+_ENVU_ENUM(envuMountPropagation) {
+    /** Mount events propagate to the peer group. (shared:N) */
+    ENVU_PROPAGATION_SHARED = 1 << 0,
+    /** Mount events propagate from the master peer group. (master:N) */
+    ENVU_PROPAGATION_SLAVE = 1 << 1,
+    /** The mount can't be bind mounted. (unbindable) */
+    ENVU_PROPAGATION_UNBINDABLE = 1 << 2,
+};
+
+/**
+ * A mount in /proc/self/mountinfo.
+ */
+typedef struct envuMount {
+    /** The unique ID of the mount. */
+    int mount_id;
+    /** The ID of the parent mount. */
+    int parent_id;
+    /** The major number of st_dev for files in the filesystem. */
+    unsigned int major;
+    /** The minor number of st_dev for files in the filesystem. */
+    unsigned int minor;
+    /** The directory in the filesystem that forms the root of the mount. */
+    const char *root;
+    /** The mount point. */
+    const char *mount_point;
+    /** The filesystem type. e.g. "ext4", "overlay", "nfs4" */
+    const char *fstype;
+    /** The mount source. e.g. "/dev/sda1" */
+    const char *source;
+    /** Per-mount options. e.g. "rw,relatime" */
+    const char *options;
+    /** Per-superblock options. */
+    const char *super_options;
+    /** Propagation types. (envuMountPropagation) */
+    unsigned int propagation;
+    /** The peer group ID for shared mounts. 0 if not shared. */
+    int peer_group;
+    /** The master peer group ID for slave mounts. 0 if not a slave. */
+    int master;
+} envuMount;
+
+/**
+ * Gets the mount that a path lives on.
+ * The path is normalized with envuGetFullPath(), so symlinks are not resolved.
+ * The mount table is built from a single parse of /proc/self/mountinfo,
+ * and is cached as a trie over mount points until the kernel reports a change.
+ * (POLLPRI on the mountinfo fd)
+ * Over-mounted and hidden mounts are resolved with the parent IDs.
+ *
+ * @note The returned structure should be freed with envuFree().
+ *
+ * @param path A path to a file or a directory. It doesn't have to exist.
+ * @returns The mount. Or a null pointer if failed or on non-Linux platforms.
+ */
+_ENVU_EXTERN envuMount *envuGetMountForPath(const char *path);
+
+/**
+ * Bit flags for envuGetFastScratchDir().
+ */
+_ENVU_ENUM(envuScratchFlag) {
+    /** Prefers memory-backed filesystems (tmpfs) over disks. */
+    ENVU_SCRATCH_MEMORY = 1 << 0,
+    /** Prefers local disks over memory-backed filesystems. */
+    ENVU_SCRATCH_LOCAL_DISK = 1 << 1,
+    /** Ignores the cached decision and checks the candidates again. */
+    ENVU_SCRATCH_REFRESH = 1 << 2,
+};
+
+/**
+ * Selects a directory for large temporary files.
+ * It checks TMPDIR, XDG_RUNTIME_DIR, /dev/shm, /tmp, and /var/tmp in this order,
+ * skips directories that are missing, read-only, not writable,
+ * or have less than min_free_bytes of free space,
+ * and ranks the rest by the filesystem type and the storage device.
+ * By default, it prefers local solid state drives, then memory-backed filesystems,
+ * then rotational or unknown disks, and network filesystems (NFS, FUSE, SMB, and Ceph) last.
+ * Memory is not preferred by default because it competes with the process for RAM.
+ * If both ENVU_SCRATCH_MEMORY and ENVU_SCRATCH_LOCAL_DISK are set, ENVU_SCRATCH_MEMORY wins.
+ * Candidates in the same rank are ordered by free space, and ties keep the order above.
+ * The best directory is cached per process for each combination of flags,
+ * and its free space is checked again against min_free_bytes on every call.
+ * If it does not have enough space, the candidates are checked again without caching the result.
+ *
+ * @note Strings that are returned from this method should be freed with envuFree().
+ * @note On Windows, it returns envuGetTempDir() if it has enough free space.
+ *
+ * @param min_free_bytes The minimum free space for unprivileged users in bytes.
+ * @param flags Bit flags of envuScratchFlag.
+ * @returns A path to the directory. Or a null pointer if no candidate is suitable.
+ */
+_ENVU_EXTERN char *envuGetFastScratchDir(uint64_t min_free_bytes, unsigned int flags);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,3 +1,4 @@
+#include <stdio.h>  // for snprintf
 #include <string.h>  // for strlen
 #ifdef _WIN32
 #include <malloc.h>  // for malloc
@@ -106,3 +107,262 @@ void envuFreeEnvPaths(char **paths) {
     }
     envuFree(paths);
 }
+
+int envuHasWord(const char *list, const char *item) {
+    size_t len = strlen(item);
+    const char *p = list;
+    while (*p != '\0') {
+        while (*p == ' ' || *p == '\t')
+            p++;
+        if (strncmp(p, item, len) == 0 &&
+            (p[len] == ' ' || p[len] == '\t' || p[len] == '\n' || p[len] == '\0'))
+            return 1;
+        while (*p != '\0' && *p != ' ' && *p != '\t')
+            p++;
+    }
+    return 0;
+}
+
+double envuParseDecimal(const char *str, const char **end) {
+    double value = 0;
+    const char *p = str;
+    while (*p >= '0' && *p <= '9')
+        value = value * 10 + (*p++ - '0');
+    if (*p == '.') {
+        double scale = 0.1;
+        for (p++; *p >= '0' && *p <= '9'; p++) {
+            value += (*p - '0') * scale;
+            scale *= 0.1;
+        }
+    }
+    if (end != NULL)
+        *end = p;
+    return value;
+}
+
+static const char *resource_names[] = {
+    "as", "core", "cpu", "data", "fsize", "memlock", "msgqueue", "nice", "nofile", "nproc",
+    "rss", "rtprio", "rttime", "sigpending", "stack",
+};
+
+void envuInitResourceLimits(envuResourceLimits *out) {
+    memset(out, 0, sizeof(*out));
+    for (int i = 0; i < ENVU_RLIMIT_MAX; i++)
+        out->limits[i].name = resource_names[i];
+    out->nr_open = -1;
+    out->file_max = -1;
+    out->threads_max = -1;
+    out->pid_max = -1;
+}
+
+int envuHasKernelFeature(envuKernelFeature feature) {
+    const envuKernelFeatures *kf = envuGetKernelFeatures();
+    if (kf == NULL || feature >= ENVU_KF_MAX)
+        return 0;
+    return (kf->features >> feature) & 1;
+}
+
+int envuHasIoUringOp(unsigned int opcode) {
+    const envuKernelFeatures *kf = envuGetKernelFeatures();
+    if (kf == NULL || opcode >= 256)
+        return 0;
+    return (kf->io_uring_ops[opcode / 64] >> (opcode % 64)) & 1;
+}
+
+int envuCompareKernelVersion(int major, int minor, int patch) {
+    const envuKernelFeatures *kf = envuGetKernelFeatures();
+    if (kf == NULL)
+        return -1;
+    if (kf->version_major != major)
+        return kf->version_major < major ? -1 : 1;
+    if (kf->version_minor != minor)
+        return kf->version_minor < minor ? -1 : 1;
+    if (kf->version_patch != patch)
+        return kf->version_patch < patch ? -1 : 1;
+    return 0;
+}
+
+int envuCpuSetHas(const envuCpuSet *set, int cpu) {
+    if (set == NULL || cpu < 0 || cpu >= ENVU_CPU_SETSIZE)
+        return 0;
+    return (set->bits[cpu / 64] >> (cpu % 64)) & 1;
+}
+
+int envuCpuSetCount(const envuCpuSet *set) {
+    if (set == NULL)
+        return 0;
+    int count = 0;
+    for (int i = 0; i < ENVU_CPU_SETSIZE / 64; i++) {
+        for (uint64_t bits = set->bits[i]; bits; bits &= bits - 1)
+            count++;
+    }
+    return count;
+}
+
+static const envuTunableRule default_tunable_rules[] = {
+    { "vm.swappiness", ENVU_TUNABLE_MAX, 10,
+      "Swapping out anonymous memory adds latency to page faults." },
+    { "vm.overcommit_memory", ENVU_TUNABLE_NE, 2,
+      "Strict overcommit makes large virtual reservations fail." },
+    { "vm.dirty_ratio", ENVU_TUNABLE_MAX, 20,
+      "A large dirty ratio causes long writeback stalls." },
+    { "vm.dirty_background_ratio", ENVU_TUNABLE_MAX, 10,
+      "Background writeback should start before writers are throttled." },
+    { "vm.zone_reclaim_mode", ENVU_TUNABLE_EQ, 0,
+      "Zone reclaim prefers reclaiming local pages to allocating remote ones." },
+    { "vm.max_map_count", ENVU_TUNABLE_MIN, 262144,
+      "Allocators and mmap-heavy databases need many mappings." },
+    { "net.core.somaxconn", ENVU_TUNABLE_MIN, 4096,
+      "A short accept queue drops connections under bursts." },
+    { "net.core.netdev_max_backlog", ENVU_TUNABLE_MIN, 4096,
+      "A short backlog drops packets on busy interfaces." },
+    { "net.ipv4.tcp_max_syn_backlog", ENVU_TUNABLE_MIN, 4096,
+      "A short SYN queue drops connections under bursts." },
+    { "net.ipv4.tcp_slow_start_after_idle", ENVU_TUNABLE_EQ, 0,
+      "Slow start after idle throttles keep-alive connections." },
+    { "fs.file-max", ENVU_TUNABLE_MIN, 1048576,
+      "Servers with many connections run out of file handles." },
+};
+
+const envuTunableRule *envuGetDefaultTunableRules(int *rule_count) {
+    if (rule_count != NULL)
+        *rule_count = (int)(sizeof(default_tunable_rules) / sizeof(default_tunable_rules[0]));
+    return default_tunable_rules;
+}
+
+int envuAuditTunables(envuTunableReport *out) {
+    int count;
+    const envuTunableRule *rules = envuGetDefaultTunableRules(&count);
+    return envuAuditTunablesWithRules(rules, count, out);
+}
+
+typedef struct JsonBuf {
+    char *str;
+    size_t len;
+    size_t capacity;
+} JsonBuf;
+
+static int jsonReserve(JsonBuf *buf, size_t size) {
+    if (buf->str == NULL)
+        return -1;
+    if (buf->len + size < buf->capacity)
+        return 0;
+    size_t capacity = buf->capacity * 2;
+    while (buf->len + size >= capacity)
+        capacity *= 2;
+    char *str = realloc(buf->str, capacity);
+    if (str == NULL) {
+        free(buf->str);
+        buf->str = NULL;
+        return -1;
+    }
+    buf->str = str;
+    buf->capacity = capacity;
+    return 0;
+}
+
+static void jsonAppend(JsonBuf *buf, const char *str) {
+    size_t len = strlen(str);
+    if (jsonReserve(buf, len) != 0)
+        return;
+    memcpy(buf->str + buf->len, str, len + 1);
+    buf->len += len;
+}
+
+// Appends a quoted string, or null for an empty or unknown string.
+static void jsonAppendString(JsonBuf *buf, const char *str) {
+    if (str == NULL || *str == '\0') {
+        jsonAppend(buf, "null");
+        return;
+    }
+    jsonAppend(buf, "\"");
+    for (const char *p = str; *p != '\0'; p++) {
+        char esc[8] = { *p, '\0' };
+        if (*p == '"' || *p == '\\')
+            snprintf(esc, sizeof(esc), "\\%c", *p);
+        else if ((unsigned char)*p < 0x20)
+            snprintf(esc, sizeof(esc), "\\u%04x", (unsigned char)*p);
+        jsonAppend(buf, esc);
+    }
+    jsonAppend(buf, "\"");
+}
+
+// Appends an integer, or null for a negative (unknown) value.
+static void jsonAppendInt(JsonBuf *buf, long long value) {
+    char str[32];
+    if (value < 0)
+        snprintf(str, sizeof(str), "null");
+    else
+        snprintf(str, sizeof(str), "%lld", value);
+    jsonAppend(buf, str);
+}
+
+// Appends a decimal with 2 digits without printf("%f"), which depends on the locale.
+static void jsonAppendDecimal(JsonBuf *buf, double value) {
+    char str[32];
+    if (value < 0) {
+        snprintf(str, sizeof(str), "null");
+    } else {
+        long long hundredths = (long long)(value * 100 + 0.5);
+        snprintf(str, sizeof(str), "%lld.%02lld", hundredths / 100, hundredths % 100);
+    }
+    jsonAppend(buf, str);
+}
+
+char *envuSerializeBenchEnvironment(const envuBenchEnvironment *env) {
+    if (env == NULL)
+        return NULL;
+    JsonBuf buf = { malloc(1024), 0, 1024 };
+    if (buf.str == NULL)
+        return NULL;
+    buf.str[0] = '\0';
+
+    jsonAppend(&buf, "{\"cpus\":[");
+    for (int i = 0; i < env->cpu_count; i++) {
+        const envuCpuFreq *cpu = &env->cpus[i];
+        jsonAppend(&buf, i == 0 ? "{\"cpu\":" : ",{\"cpu\":");
+        jsonAppendInt(&buf, cpu->cpu);
+        jsonAppend(&buf, ",\"governor\":");
+        jsonAppendString(&buf, cpu->governor);
+        jsonAppend(&buf, ",\"driver\":");
+        jsonAppendString(&buf, cpu->driver);
+        // 0 kHz means unknown.
+        jsonAppend(&buf, ",\"cur_khz\":");
+        jsonAppendInt(&buf, cpu->cur_khz > 0 ? (long long)cpu->cur_khz : -1);
+        jsonAppend(&buf, ",\"min_khz\":");
+        jsonAppendInt(&buf, cpu->min_khz > 0 ? (long long)cpu->min_khz : -1);
+        jsonAppend(&buf, ",\"max_khz\":");
+        jsonAppendInt(&buf, cpu->max_khz > 0 ? (long long)cpu->max_khz : -1);
+        jsonAppend(&buf, "}");
+    }
+    jsonAppend(&buf, "],\"turbo\":");
+    jsonAppend(&buf, env->turbo < 0 ? "null" : env->turbo ? "true" : "false");
+    jsonAppend(&buf, ",\"smt_control\":");
+    jsonAppendString(&buf, env->smt_control);
+    jsonAppend(&buf, ",\"smt_active\":");
+    jsonAppend(&buf, env->smt_active < 0 ? "null" : env->smt_active ? "true" : "false");
+    jsonAppend(&buf, ",\"aslr\":");
+    jsonAppendInt(&buf, env->aslr);
+    jsonAppend(&buf, ",\"loadavg\":[");
+    for (int i = 0; i < 3; i++) {
+        if (i > 0)
+            jsonAppend(&buf, ",");
+        jsonAppendDecimal(&buf, env->loadavg[i]);
+    }
+    jsonAppend(&buf, "],\"runnable\":");
+    jsonAppendInt(&buf, env->runnable);
+    jsonAppend(&buf, ",\"hypervisor\":");
+    jsonAppendString(&buf, env->hypervisor);
+    jsonAppend(&buf, ",\"container\":");
+    jsonAppendString(&buf, env->container);
+    jsonAppend(&buf, ",\"warning_flags\":");
+    jsonAppendInt(&buf, env->warnings);
+    jsonAppend(&buf, ",\"warnings\":[");
+    for (int i = 0; i < env->warning_count; i++) {
+        if (i > 0)
+            jsonAppend(&buf, ",");
+        jsonAppendString(&buf, env->warning_messages[i]);
+    }
+    jsonAppend(&buf, "]}");
+    return buf.str;
+}
@@ -0,0 +1,307 @@
+#include <string.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <intrin.h>
+#else
+#include <pthread.h>
+#endif
+
+#if defined(__APPLE__)
+#include <sys/sysctl.h>
+#endif
+
+#include "env_utils.h"
+#include "env_utils_priv.h"
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#define ENVU_CPU_X86
+#if !defined(_MSC_VER)
+#include <cpuid.h>
+#endif
+#endif
+
+// Set when cpu_feature_bits is initialized.
+#define CPU_FEATURES_READY (1ULL << 63)
+
+static envuCpuFeatures cpu_features;
+static uint64_t cpu_feature_bits = 0;
+
+#ifdef _MSC_VER
+#define LOAD_FEATURE_BITS() (*(volatile uint64_t *)&cpu_feature_bits)
+#define STORE_FEATURE_BITS(v) (*(volatile uint64_t *)&cpu_feature_bits = (v))
+#else
+#define LOAD_FEATURE_BITS() __atomic_load_n(&cpu_feature_bits, __ATOMIC_ACQUIRE)
+#define STORE_FEATURE_BITS(v) __atomic_store_n(&cpu_feature_bits, (v), __ATOMIC_RELEASE)
+#endif
+
+static const char *cpu_feature_names[] = {
+    "sse2", "sse3", "ssse3", "sse4_1", "sse4_2", "popcnt", "avx", "avx2", "fma", "f16c",
+    "bmi1", "bmi2", "lzcnt", "movbe", "aes", "pclmulqdq", "sha", "rdrand", "rdseed", "erms",
+    "avx512f", "avx512dq", "avx512cd", "avx512bw", "avx512vl", "avx512vnni", "vaes",
+    "vpclmulqdq",
+    "neon", "aes", "pmull", "sha1", "sha2", "crc32", "atomics", "sve", "sve2",
+};
+
+#define SET_FEATURE(info, f) ((info)->features |= 1ULL << (f))
+#define SET_FEATURE_IF(info, f, cond) do { if (cond) SET_FEATURE(info, f); } while (0)
+
+#ifdef ENVU_CPU_X86
+static void cpuidex(unsigned leaf, unsigned sub, unsigned regs[4]) {
+#ifdef _MSC_VER
+    int r[4];
+    __cpuidex(r, (int)leaf, (int)sub);
+    for (int i = 0; i < 4; i++)
+        regs[i] = (unsigned)r[i];
+#else
+    __cpuid_count(leaf, sub, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static unsigned long long xgetbv0(void) {
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    unsigned eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+
+#define BIT(reg, n) (((reg) >> (n)) & 1)
+
+static void detectX86(envuCpuFeatures *info) {
+    unsigned r[4];
+    cpuidex(0, 0, r);
+    unsigned max_leaf = r[0];
+    memcpy(info->vendor, &r[1], 4);
+    memcpy(info->vendor + 4, &r[3], 4);
+    memcpy(info->vendor + 8, &r[2], 4);
+    info->vendor[12] = '\0';
+    if (max_leaf < 1)
+        return;
+
+    cpuidex(1, 0, r);
+    unsigned eax = r[0], ecx = r[2], edx = r[3];
+    int family = (eax >> 8) & 0xf;
+    int model = (eax >> 4) & 0xf;
+    if (family == 0xf)
+        family += (eax >> 20) & 0xff;
+    if (family == 0x6 || family >= 0xf)
+        model |= ((eax >> 16) & 0xf) << 4;
+    info->family = family;
+    info->model = model;
+    info->stepping = eax & 0xf;
+
+    // AVX needs the OS to save YMM states. AVX-512 also needs opmask and ZMM states.
+    int avx_os = 0, avx512_os = 0;
+    if (BIT(ecx, 27)) {
+        unsigned long long xcr0 = xgetbv0();
+        avx_os = (xcr0 & 0x6) == 0x6;
+        avx512_os = avx_os && (xcr0 & 0xe0) == 0xe0;
+    }
+
+    SET_FEATURE_IF(info, ENVU_CPU_SSE2, BIT(edx, 26));
+    SET_FEATURE_IF(info, ENVU_CPU_SSE3, BIT(ecx, 0));
+    SET_FEATURE_IF(info, ENVU_CPU_PCLMULQDQ, BIT(ecx, 1));
+    SET_FEATURE_IF(info, ENVU_CPU_SSSE3, BIT(ecx, 9));
+    SET_FEATURE_IF(info, ENVU_CPU_FMA, BIT(ecx, 12) && avx_os);
+    SET_FEATURE_IF(info, ENVU_CPU_SSE4_1, BIT(ecx, 19));
+    SET_FEATURE_IF(info, ENVU_CPU_SSE4_2, BIT(ecx, 20));
+    SET_FEATURE_IF(info, ENVU_CPU_MOVBE, BIT(ecx, 22));
+    SET_FEATURE_IF(info, ENVU_CPU_POPCNT, BIT(ecx, 23));
+    SET_FEATURE_IF(info, ENVU_CPU_AES, BIT(ecx, 25));
+    SET_FEATURE_IF(info, ENVU_CPU_AVX, BIT(ecx, 28) && avx_os);
+    SET_FEATURE_IF(info, ENVU_CPU_F16C, BIT(ecx, 29) && avx_os);
+    SET_FEATURE_IF(info, ENVU_CPU_RDRAND, BIT(ecx, 30));
+
+    if (max_leaf >= 7) {
+        cpuidex(7, 0, r);
+        unsigned ebx = r[1];
+        ecx = r[2];
+        SET_FEATURE_IF(info, ENVU_CPU_BMI1, BIT(ebx, 3));
+        SET_FEATURE_IF(info, ENVU_CPU_AVX2, BIT(ebx, 5) && avx_os);
+        SET_FEATURE_IF(info, ENVU_CPU_BMI2, BIT(ebx, 8));
+        SET_FEATURE_IF(info, ENVU_CPU_ERMS, BIT(ebx, 9));
+        SET_FEATURE_IF(info, ENVU_CPU_AVX512F, BIT(ebx, 16) && avx512_os);
+        SET_FEATURE_IF(info, ENVU_CPU_AVX512DQ, BIT(ebx, 17) && avx512_os);
+        SET_FEATURE_IF(info, ENVU_CPU_RDSEED, BIT(ebx, 18));
+        SET_FEATURE_IF(info, ENVU_CPU_AVX512CD, BIT(ebx, 28) && avx512_os);
+        SET_FEATURE_IF(info, ENVU_CPU_SHA, BIT(ebx, 29));
+        SET_FEATURE_IF(info, ENVU_CPU_AVX512BW, BIT(ebx, 30) && avx512_os);
+        SET_FEATURE_IF(info, ENVU_CPU_AVX512VL, BIT(ebx, 31) && avx512_os);
+        SET_FEATURE_IF(info, ENVU_CPU_VAES, BIT(ecx, 9) && avx_os);
+        SET_FEATURE_IF(info, ENVU_CPU_VPCLMULQDQ, BIT(ecx, 10) && avx_os);
+        SET_FEATURE_IF(info, ENVU_CPU_AVX512VNNI, BIT(ecx, 11) && avx512_os);
+    }
+
+    cpuidex(0x80000000, 0, r);
+    unsigned max_ext = r[0];
+    if (max_ext >= 0x80000001) {
+        cpuidex(0x80000001, 0, r);
+        SET_FEATURE_IF(info, ENVU_CPU_LZCNT, BIT(r[2], 5));
+    }
+    if (max_ext >= 0x80000004) {
+        char brand[49];
+        for (unsigned i = 0; i < 3; i++) {
+            cpuidex(0x80000002 + i, 0, r);
+            memcpy(brand + i * 16, r, 16);
+        }
+        brand[48] = '\0';
+        const char *p = brand;
+        while (*p == ' ')
+            p++;
+        strncpy(info->brand, p, sizeof(info->brand) - 1);
+    }
+}
+#endif  // ENVU_CPU_X86
+
+#if defined(__linux__) && !defined(ENVU_CPU_X86)
+static const char *getArmImplementer(int id) {
+    switch (id) {
+    case 0x41: return "ARM";
+    case 0x42: return "Broadcom";
+    case 0x46: return "Fujitsu";
+    case 0x48: return "HiSilicon";
+    case 0x4e: return "NVIDIA";
+    case 0x51: return "Qualcomm";
+    case 0x61: return "Apple";
+    case 0xc0: return "Ampere";
+    default: return NULL;
+    }
+}
+
+// Returns the value of a "key : value" line in /proc/cpuinfo.
+static char *getCpuinfoValue(char *line, const char *key) {
+    size_t len = strlen(key);
+    if (strncmp(line, key, len) != 0 || (line[len] != ' ' && line[len] != '\t'))
+        return NULL;
+    char *p = strchr(line + len, ':');
+    if (p == NULL)
+        return NULL;
+    p++;
+    while (*p == ' ' || *p == '\t')
+        p++;
+    return p;
+}
+
+// Parses the first processor in /proc/cpuinfo.
+static void detectCpuinfo(envuCpuFeatures *info) {
+    char *buf = envuReadSysFileAlloc("/proc/cpuinfo", NULL);
+    if (buf == NULL)
+        return;
+    int has_features = 0, has_brand = 0;
+    char *save = NULL;
+    for (char *line = strtok_r(buf, "\n", &save); line != NULL;
+         line = strtok_r(NULL, "\n", &save)) {
+        char *val;
+        if (!has_features && (val = getCpuinfoValue(line, "Features")) != NULL) {
+            has_features = 1;
+            SET_FEATURE_IF(info, ENVU_CPU_NEON,
+                           envuHasWord(val, "asimd") || envuHasWord(val, "neon"));
+            SET_FEATURE_IF(info, ENVU_CPU_ARM_AES, envuHasWord(val, "aes"));
+            SET_FEATURE_IF(info, ENVU_CPU_ARM_PMULL, envuHasWord(val, "pmull"));
+            SET_FEATURE_IF(info, ENVU_CPU_ARM_SHA1, envuHasWord(val, "sha1"));
+            SET_FEATURE_IF(info, ENVU_CPU_ARM_SHA2, envuHasWord(val, "sha2"));
+            SET_FEATURE_IF(info, ENVU_CPU_ARM_CRC32, envuHasWord(val, "crc32"));
+            SET_FEATURE_IF(info, ENVU_CPU_ARM_ATOMICS, envuHasWord(val, "atomics"));
+            SET_FEATURE_IF(info, ENVU_CPU_SVE, envuHasWord(val, "sve"));
+            SET_FEATURE_IF(info, ENVU_CPU_SVE2, envuHasWord(val, "sve2"));
+        } else if ((val = getCpuinfoValue(line, "CPU implementer")) != NULL) {
+            info->family = (int)strtol(val, NULL, 0);
+            const char *vendor = getArmImplementer(info->family);
+            if (vendor != NULL && info->vendor[0] == '\0')
+                strncpy(info->vendor, vendor, sizeof(info->vendor) - 1);
+        } else if ((val = getCpuinfoValue(line, "CPU part")) != NULL) {
+            info->model = (int)strtol(val, NULL, 0);
+        } else if ((val = getCpuinfoValue(line, "CPU revision")) != NULL) {
+            info->stepping = (int)strtol(val, NULL, 0);
+        } else if (!has_brand && ((val = getCpuinfoValue(line, "model name")) != NULL ||
+                                  (val = getCpuinfoValue(line, "Hardware")) != NULL)) {
+            has_brand = 1;
+            strncpy(info->brand, val, sizeof(info->brand) - 1);
+        } else if (has_features && strncmp(line, "processor", 9) == 0) {
+            // Reached the second processor.
+            break;
+        }
+    }
+    free(buf);
+}
+#endif  // defined(__linux__) && !defined(ENVU_CPU_X86)
+
+#if defined(__APPLE__) && defined(__aarch64__)
+static int getSysctlFlag(const char *name) {
+    int val = 0;
+    size_t size = sizeof(val);
+    if (sysctlbyname(name, &val, &size, NULL, 0) != 0)
+        return 0;
+    return val != 0;
+}
+
+static void detectApple(envuCpuFeatures *info) {
+    strncpy(info->vendor, "Apple", sizeof(info->vendor) - 1);
+    size_t size = sizeof(info->brand) - 1;
+    sysctlbyname("machdep.cpu.brand_string", info->brand, &size, NULL, 0);
+    SET_FEATURE(info, ENVU_CPU_NEON);
+    SET_FEATURE_IF(info, ENVU_CPU_ARM_AES, getSysctlFlag("hw.optional.arm.FEAT_AES"));
+    SET_FEATURE_IF(info, ENVU_CPU_ARM_PMULL, getSysctlFlag("hw.optional.arm.FEAT_PMULL"));
+    SET_FEATURE_IF(info, ENVU_CPU_ARM_SHA1, getSysctlFlag("hw.optional.arm.FEAT_SHA1"));
+    SET_FEATURE_IF(info, ENVU_CPU_ARM_SHA2, getSysctlFlag("hw.optional.arm.FEAT_SHA256"));
+    SET_FEATURE_IF(info, ENVU_CPU_ARM_CRC32, getSysctlFlag("hw.optional.armv8_crc32"));
+    SET_FEATURE_IF(info, ENVU_CPU_ARM_ATOMICS, getSysctlFlag("hw.optional.arm.FEAT_LSE"));
+}
+#endif  // defined(__APPLE__) && defined(__aarch64__)
+
+static void detectCpuFeatures(void) {
+    envuCpuFeatures *info = &cpu_features;
+    memset(info, 0, sizeof(*info));
+#if defined(ENVU_CPU_X86)
+    detectX86(info);
+#elif defined(__linux__)
+    detectCpuinfo(info);
+#elif defined(__APPLE__) && defined(__aarch64__)
+    detectApple(info);
+#elif defined(_M_ARM64) || defined(__aarch64__) || defined(__ARM_NEON)
+    SET_FEATURE(info, ENVU_CPU_NEON);
+#endif
+    STORE_FEATURE_BITS(info->features | CPU_FEATURES_READY);
+}
+
+#ifdef _WIN32
+static INIT_ONCE cpu_features_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK detectCpuFeaturesWin(PINIT_ONCE once, PVOID param, PVOID *context) {
+    (void)once;
+    (void)param;
+    (void)context;
+    detectCpuFeatures();
+    return TRUE;
+}
+#else
+static pthread_once_t cpu_features_once = PTHREAD_ONCE_INIT;
+#endif
+
+const envuCpuFeatures *envuGetCpuFeatures(void) {
+#ifdef _WIN32
+    InitOnceExecuteOnce(&cpu_features_once, detectCpuFeaturesWin, NULL, NULL);
+#else
+    pthread_once(&cpu_features_once, detectCpuFeatures);
+#endif
+    return &cpu_features;
+}
+
+int envuCpuHas(envuCpuFeature feature) {
+    if ((unsigned)feature >= ENVU_CPU_FEATURE_MAX)
+        return 0;
+    uint64_t bits = LOAD_FEATURE_BITS();
+    if (!(bits & CPU_FEATURES_READY))
+        bits = envuGetCpuFeatures()->features;
+    return (int)((bits >> feature) & 1);
+}
+
+const char *envuGetCpuFeatureName(envuCpuFeature feature) {
+    if ((unsigned)feature >= ENVU_CPU_FEATURE_MAX)
+        return NULL;
+    return cpu_feature_names[feature];
+}
@@ -1,5 +1,6 @@
 #include "env_utils.h"
 #include <stdio.h>
+#include <string.h>
 
 #ifdef _WIN32
 #include "env_utils_windows.h"
@@ -34,12 +35,29 @@ void PrintUTF8(const char* fmt, ...) {
 #include <locale.h>
 #endif
 
-int main(void) {
+// Prints settings that affect benchmarks as JSON.
+static int printBenchEnvironment(void) {
+    envuBenchEnvironment *env = envuGetBenchEnvironment();
+    char *json = envuSerializeBenchEnvironment(env);
+    envuFree(env);
+    if (json == NULL) {
+        fprintf(stderr, "Failed to get the benchmark environment.\n");
+        return 1;
+    }
+    PRINTF("%s\n", json);
+    envuFree(json);
+    return 0;
+}
+
+int main(int argc, char **argv) {
 #ifdef _WIN32
     // Need this line to show unicode characters on Windows
     setlocale(LC_CTYPE, "");
 #endif
 
+    if (argc > 1 && strcmp(argv[1], "--bench-env") == 0)
+        return printBenchEnvironment();
+
     PRINTF("c-env-utils v%s\n", envuGetVersion());
     PRINTF("%s", "\n");
 
@@ -75,6 +93,20 @@ int main(void) {
     PRINTF("OS porduct name: %s\n", os_pn);
     envuFree(os_pn);
 
+    const envuCpuFeatures *cpu = envuGetCpuFeatures();
+    PRINTF("CPU: %s (%s, family %d, model %d, stepping %d)\n",
+           cpu->brand, cpu->vendor, cpu->family, cpu->model, cpu->stepping);
+    PRINTF("%s", "CPU features:");
+    for (int i = 0; i < ENVU_CPU_FEATURE_MAX; i++) {
+        if (envuCpuHas((envuCpuFeature)i))
+            PRINTF(" %s", envuGetCpuFeatureName((envuCpuFeature)i));
+    }
+    PRINTF("%s", "\n");
+
+    const envuClockInfo *clock = envuGetClockInfo();
+    PRINTF("Clocksource: %s%s (CLOCK_MONOTONIC: %.1f ns/call)\n",
+           clock->current_clocksource, clock->vdso ? " (vDSO)" : "", clock->monotonic_ns);
+
     int count;
     char **paths = envuGetEnvPaths(&count);
     PRINTF("%s", "PATH:\n");
@@ -82,4 +114,19 @@ int main(void) {
         PRINTF("  %s\n", *p);
     }
     envuFreeEnvPaths(paths);
+
+    envuTunableReport report;
+    if (envuAuditTunables(&report) >= 0) {
+        static const char *ops[] = { "==", "!=", ">=", "<=" };
+        PRINTF("Tunables: %d of %d need attention\n", report.mismatch_count, report.count);
+        for (int i = 0; i < report.count; i++) {
+            const envuTunableFinding *f = &report.findings[i];
+            if (f->status != ENVU_TUNABLE_MISMATCH)
+                continue;
+            PRINTF("  %s = %lld (recommended %s %lld): %s\n",
+                   f->name, f->actual, ops[f->check], f->recommended,
+                   f->reason != NULL ? f->reason : "");
+        }
+        envuFree(report.findings);
+    }
 }
@@ -36,6 +36,31 @@ extern char *envuAllocStrWithConst(const char *c);
  */
 extern char *envuAppendStr(char *str1, const char *str2);
 
+/**
+ * Checks if a list separated by spaces or tabs has an item. e.g. "fpu vme tsc"
+ *
+ * @param list A list of words.
+ * @param item A word to find.
+ * @return 1 if the list has the item. 0 otherwise.
+ */
+extern int envuHasWord(const char *list, const char *item);
+
+/**
+ * Parses a decimal number like "1.25" without strtod, which depends on the locale.
+ *
+ * @param str A string that starts with a decimal number.
+ * @param end A pointer to the character after the number will be stored here if it's not null.
+ * @return The parsed value.
+ */
+extern double envuParseDecimal(const char *str, const char **end);
+
+/**
+ * Clears resource limits, sets their names, and marks system-wide caps as unknown.
+ *
+ * @param out Limits to initialize.
+ */
+extern void envuInitResourceLimits(envuResourceLimits *out);
+
 #ifdef _WIN32
 extern wchar_t *envuAllocWstr(size_t size);
 #define envuAllocEmptyWstr() envuAllocWstr(0)
@@ -47,6 +72,98 @@ extern wchar_t *getOSInfoFromWMI(const wchar_t *key);
 extern char *getOSVersionHaiku(void);
 #endif
 
+#ifdef __linux__
+#include <limits.h>
+#include <sys/types.h>
+
+// The max number of cpus that sysfs parsers support. It's the same as envuCpuSet.
+#define ENVU_MAX_CPUS ENVU_CPU_SETSIZE
+
+// PATH_MAX of Linux. limits.h only defines PATH_MAX with _GNU_SOURCE or _POSIX_C_SOURCE,
+// but this header is also included from strict C99 sources.
+#define ENVU_PATH_MAX 4096
+
+// Where files on a filesystem are stored.
+typedef enum envuFsClass {
+    ENVU_FS_CLASS_DISK = 0,
+    ENVU_FS_CLASS_MEMORY,
+    ENVU_FS_CLASS_NETWORK,
+} envuFsClass;
+
+// Fields of a line in /proc/self/mountinfo
+typedef struct envuMountinfoFields {
+    char *mount_id;
+    char *parent_id;
+    char *dev;
+    char *root;
+    char *mount_point;
+    char *options;
+    char *optional;
+    char *fstype;
+    char *source;
+    char *super_options;
+} envuMountinfoFields;
+
+// A cgroup directory for a controller.
+typedef struct envuCgroupDir {
+    int version;  // 1 or 2. 0 means not found.
+    char mount_point[ENVU_PATH_MAX];  // a path in the sysroot
+    char path[ENVU_PATH_MAX];  // a path relative to mount_point. ("" or "/*")
+} envuCgroupDir;
+
+// Helpers to read procfs, sysfs, and cgroup files under the sysroot.
+extern int setSysRootLinux(const char *path);
+extern unsigned int envuGetSysRootGen(void);
+extern int envuHasSysRoot(void);
+extern int envuGetSysPath(const char *path, char *buf, size_t size);
+extern ssize_t envuReadSysFile(const char *path, char *buf, size_t size);
+extern char *envuReadSysFileAlloc(const char *path, size_t *size);
+extern int envuReadSysLong(const char *path, long long *value);
+extern int envuParseCpuList(const char *str, uint64_t *mask, int mask_words);
+extern int envuParseMountinfoLine(char *line, envuMountinfoFields *fields);
+extern int envuHasListItem(const char *list, const char *item);
+extern int envuFindCgroupDir(const char *controller, envuCgroupDir *dir);
+extern ssize_t envuReadCgroupFile(const envuCgroupDir *dir, const char *name,
+                                  char *buf, size_t size);
+extern int envuGetCgroupParent(envuCgroupDir *dir);
+
+extern const envuKernelFeatures *getKernelFeaturesLinux(void);
+extern char *getExecutableBuildIdLinux(void);
+extern envuModule *getLoadedModulesLinux(int *module_count);
+extern int getEffectiveCpuCountLinux(envuCpuCountInfo *out);
+extern int getMemoryInfoLinux(envuMemoryInfo *out);
+extern const envuCacheTopology *getCacheTopologyLinux(void);
+extern const envuNumaTopology *getNumaTopologyLinux(void);
+extern int getCurrentNumaNodeLinux(void);
+extern const envuCpuTopology *getCpuTopologyLinux(void);
+extern int pinCurrentThreadLinux(int cpu);
+extern int getThreadAffinityLinux(envuCpuSet *out);
+extern int *planWorkersLinux(int n, envuPlacementPolicy policy);
+extern int getSchedEnvironmentLinux(envuSchedEnvironment *out);
+extern const envuHugePageInfo *getHugePageInfoLinux(int refresh);
+extern int envuReadSysctls(const char **names, int count, long long *values, int *found);
+extern int getPressureLinux(envuPressureResource resource, envuPressure *out);
+extern int subscribePressureLinux(envuPressureResource resource,
+                                  uint64_t threshold_us, uint64_t window_us);
+extern const envuVirtualization *getVirtualizationLinux(void);
+extern int auditTunablesLinux(const envuTunableRule *rules, int rule_count,
+                              envuTunableReport *out);
+extern const char *getKernelCmdlineValueLinux(const char *key);
+extern envuBenchEnvironment *getBenchEnvironmentLinux(void);
+extern envuSampler *openSamplerLinux(int pid);
+extern int sampleLinux(envuSampler *sampler, envuProcessSample *out);
+extern void closeSamplerLinux(envuSampler *sampler);
+extern envuProcessSnapshot *snapshotProcessesLinux(unsigned int fields,
+                                                   const envuProcessFilter *filter);
+extern envuProcessSnapshot *updateProcessSnapshotLinux(const envuProcessSnapshot *prev);
+extern const envuStorageInfo *getStorageInfoLinux(const char *path);
+extern const envuStorageInfo *getStorageInfoForDeviceLinux(unsigned int major,
+                                                           unsigned int minor);
+extern int getFsCapabilitiesLinux(const char *path, envuFsCapabilities *out);
+extern envuFsClass getFsClassLinux(uint64_t magic);
+extern envuMount *getMountForPathLinux(const char *path);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,1209 @@
+#define _GNU_SOURCE
+
+#include <sys/mman.h>
+#include <sched.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <sys/resource.h>
+#include <dirent.h>
+#include <elf.h>
+#include <link.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <errno.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "env_utils.h"
+#include "env_utils_priv.h"
+
+#ifndef MADV_POPULATE_READ
+#define MADV_POPULATE_READ 22
+#endif
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+#define IORING_REGISTER_PROBE 8
+#define IO_URING_OP_SUPPORTED (1U << 0)
+
+// Note: We use our own definitions of io_uring structures
+//       because old systems don't have linux/io_uring.h.
+typedef struct ProbeOp {
+    uint8_t op;
+    uint8_t resv;
+    uint16_t flags;
+    uint32_t resv2;
+} ProbeOp;
+
+typedef struct Probe {
+    uint8_t last_op;
+    uint8_t ops_len;
+    uint16_t resv;
+    uint32_t resv2[3];
+    ProbeOp ops[256];
+} Probe;
+
+// The root directory for procfs, sysfs, and cgroup files. Tests can replace it with fixtures.
+static char sys_root[PATH_MAX] = { 0 };
+static unsigned int sys_root_gen = 0;
+
+int setSysRootLinux(const char *path) {
+    if (path == NULL || *path == '\0' || strcmp(path, "/") == 0) {
+        sys_root[0] = '\0';
+    } else {
+        size_t len = strlen(path);
+        if (len >= sizeof(sys_root))
+            return -1;
+        memcpy(sys_root, path, len + 1);
+        // remove the last slash
+        if (sys_root[len - 1] == '/')
+            sys_root[len - 1] = '\0';
+    }
+    __atomic_add_fetch(&sys_root_gen, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+int envuHasSysRoot(void) {
+    return sys_root[0] != '\0';
+}
+
+unsigned int envuGetSysRootGen(void) {
+    return __atomic_load_n(&sys_root_gen, __ATOMIC_ACQUIRE);
+}
+
+int envuGetSysPath(const char *path, char *buf, size_t size) {
+    int len = snprintf(buf, size, "%s%s", sys_root, path);
+    if (len < 0 || (size_t)len >= size)
+        return -1;
+    return 0;
+}
+
+ssize_t envuReadSysFile(const char *path, char *buf, size_t size) {
+    char full_path[PATH_MAX];
+    if (size == 0 || envuGetSysPath(path, full_path, sizeof(full_path)) != 0)
+        return -1;
+    int fd = open(full_path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return -1;
+    size_t total = 0;
+    while (total < size - 1) {
+        ssize_t ret = read(fd, buf + total, size - 1 - total);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            break;
+        total += (size_t)ret;
+    }
+    close(fd);
+    buf[total] = '\0';
+    return (ssize_t)total;
+}
+
+char *envuReadSysFileAlloc(const char *path, size_t *size) {
+    char full_path[PATH_MAX];
+    if (envuGetSysPath(path, full_path, sizeof(full_path)) != 0)
+        return NULL;
+    int fd = open(full_path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return NULL;
+    size_t capacity = 4096;
+    size_t total = 0;
+    char *buf = malloc(capacity);
+    while (buf != NULL) {
+        if (total + 1 >= capacity) {
+            char *new_buf = realloc(buf, capacity * 2);
+            if (new_buf == NULL) {
+                free(buf);
+                buf = NULL;
+                break;
+            }
+            buf = new_buf;
+            capacity *= 2;
+        }
+        ssize_t ret = read(fd, buf + total, capacity - 1 - total);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            break;
+        total += (size_t)ret;
+    }
+    close(fd);
+    if (buf == NULL)
+        return NULL;
+    buf[total] = '\0';
+    if (size != NULL)
+        *size = total;
+    return buf;
+}
+
+int envuReadSysLong(const char *path, long long *value) {
+    char buf[64];
+    if (envuReadSysFile(path, buf, sizeof(buf)) <= 0)
+        return -1;
+    char *end;
+    errno = 0;
+    long long num = strtoll(buf, &end, 10);
+    if (end == buf || errno != 0)
+        return -1;
+    *value = num;
+    return 0;
+}
+
+int envuParseCpuList(const char *str, uint64_t *mask, int mask_words) {
+    // Parses a list like "0-3,8,10-11"
+    if (mask != NULL)
+        memset(mask, 0, mask_words * sizeof(uint64_t));
+    int count = 0;
+    const char *p = str;
+    while (*p != '\0' && *p != '\n') {
+        if (*p == ',' || *p == ' ') {
+            p++;
+            continue;
+        }
+        if (*p < '0' || *p > '9')
+            return -1;
+        char *end;
+        long first = strtol(p, &end, 10);
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            last = strtol(p + 1, &end, 10);
+            if (end == p + 1 || last < first)
+                return -1;
+            p = end;
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            if (cpu >= (long)mask_words * 64)
+                break;
+            if (mask != NULL)
+                mask[cpu / 64] |= 1ULL << (cpu % 64);
+            count++;
+        }
+    }
+    return count;
+}
+
+// Returns 1 when a syscall exists. ENOSYS means the kernel (or seccomp) doesn't support it.
+#define SYSCALL_EXISTS(ret) ((ret) != -1 || errno != ENOSYS)
+
+static void parseKernelVersion(envuKernelFeatures *kf) {
+    struct utsname buf = { 0 };
+    if (uname(&buf) == -1)
+        return;
+    // buf.release could be of the form x.y.z-*
+    int *nums[3] = { &kf->version_major, &kf->version_minor, &kf->version_patch };
+    const char *p = buf.release;
+    for (int i = 0; i < 3; i++) {
+        int num = 0;
+        while (*p >= '0' && *p <= '9') {
+            num = num * 10 + (*p - '0');
+            p++;
+        }
+        *nums[i] = num;
+        if (*p != '.')
+            break;
+        p++;
+    }
+}
+
+static void probeIoUring(envuKernelFeatures *kf) {
+#if defined(SYS_io_uring_setup) && defined(SYS_io_uring_register)
+    // struct io_uring_params is 120 bytes, and its reserved fields should be zero.
+    uint32_t params[30] = { 0 };
+    int fd = (int)syscall(SYS_io_uring_setup, 1, params);
+    if (fd < 0)
+        return;  // Not supported, or disabled with kernel.io_uring_disabled.
+    kf->features |= 1ULL << ENVU_KF_IO_URING;
+
+    Probe probe;
+    memset(&probe, 0, sizeof(probe));
+    if (syscall(SYS_io_uring_register, fd, IORING_REGISTER_PROBE, &probe, 256) == 0) {
+        for (int i = 0; i < probe.ops_len; i++) {
+            const ProbeOp *op = &probe.ops[i];
+            if (op->flags & IO_URING_OP_SUPPORTED)
+                kf->io_uring_ops[op->op / 64] |= 1ULL << (op->op % 64);
+        }
+    }
+    close(fd);
+#else
+    (void)kf;
+#endif
+}
+
+static uint64_t probeSyscalls(void) {
+    uint64_t features = 0;
+    long ret;
+    (void)ret;
+
+#ifdef SYS_statx
+    {
+        // struct statx is 256 bytes.
+        uint64_t statxbuf[32];
+        ret = syscall(SYS_statx, AT_FDCWD, "/", 0, 0x7ffU, statxbuf);
+        if (ret == 0)
+            features |= 1ULL << ENVU_KF_STATX;
+    }
+#endif
+
+#ifdef SYS_openat2
+    {
+        // struct open_how { u64 flags; u64 mode; u64 resolve; }
+        uint64_t how[3] = { O_RDONLY | O_DIRECTORY | O_CLOEXEC, 0, 0 };
+        ret = syscall(SYS_openat2, AT_FDCWD, "/", how, sizeof(how));
+        if (ret >= 0) {
+            close((int)ret);
+            features |= 1ULL << ENVU_KF_OPENAT2;
+        }
+    }
+#endif
+
+#ifdef SYS_copy_file_range
+    // Invalid fds should return EBADF when the syscall exists.
+    ret = syscall(SYS_copy_file_range, -1, NULL, -1, NULL, 0, 0);
+    if (SYSCALL_EXISTS(ret))
+        features |= 1ULL << ENVU_KF_COPY_FILE_RANGE;
+#endif
+
+#ifdef SYS_pidfd_open
+    ret = syscall(SYS_pidfd_open, getpid(), 0);
+    if (ret >= 0) {
+        close((int)ret);
+        features |= 1ULL << ENVU_KF_PIDFD_OPEN;
+    }
+#endif
+
+#ifdef SYS_memfd_create
+    ret = syscall(SYS_memfd_create, "envu-probe", MFD_CLOEXEC);
+    if (ret >= 0) {
+        close((int)ret);
+        features |= 1ULL << ENVU_KF_MEMFD_CREATE;
+    }
+#endif
+
+#ifdef SYS_clone3
+    // A null pointer with size 0 should return EINVAL when the syscall exists.
+    ret = syscall(SYS_clone3, NULL, 0);
+    if (SYSCALL_EXISTS(ret))
+        features |= 1ULL << ENVU_KF_CLONE3;
+#endif
+
+#ifdef SYS_close_range
+    // An empty range that closes nothing.
+    ret = syscall(SYS_close_range, ~0U, ~0U, 0);
+    if (ret == 0)
+        features |= 1ULL << ENVU_KF_CLOSE_RANGE;
+#endif
+
+#ifdef SYS_getrandom
+    {
+        char c;
+        ret = syscall(SYS_getrandom, &c, 1, 1);  // GRND_NONBLOCK
+        if (SYSCALL_EXISTS(ret))
+            features |= 1ULL << ENVU_KF_GETRANDOM;
+    }
+#endif
+
+    {
+        // Old kernels return EINVAL for unknown advice.
+        long page_size = sysconf(_SC_PAGESIZE);
+        if (page_size <= 0)
+            page_size = 4096;
+        void *p = mmap(NULL, (size_t)page_size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p != MAP_FAILED) {
+            if (madvise(p, (size_t)page_size, MADV_POPULATE_READ) == 0)
+                features |= 1ULL << ENVU_KF_MADV_POPULATE;
+            munmap(p, (size_t)page_size);
+        }
+    }
+    return features;
+}
+
+static envuKernelFeatures kernel_features;
+static pthread_once_t kernel_features_once = PTHREAD_ONCE_INIT;
+
+static void initKernelFeatures(void) {
+    int saved_errno = errno;
+    memset(&kernel_features, 0, sizeof(kernel_features));
+    parseKernelVersion(&kernel_features);
+    kernel_features.features = probeSyscalls();
+    probeIoUring(&kernel_features);
+    errno = saved_errno;
+}
+
+const envuKernelFeatures *getKernelFeaturesLinux(void) {
+    pthread_once(&kernel_features_once, initKernelFeatures);
+    return &kernel_features;
+}
+
+// Build IDs are usually 20 bytes (sha1). We accept up to 64 bytes.
+#define BUILD_ID_MAX 64
+#define BUILD_ID_HEX_MAX (BUILD_ID_MAX * 2 + 1)
+// The size of windows to map files when hashing them.
+#define HASH_WINDOW (16 * 1024 * 1024)
+
+#ifndef NT_GNU_BUILD_ID
+#define NT_GNU_BUILD_ID 3
+#endif
+
+// Finds the GNU build ID note in PT_NOTE segments of a loaded module.
+// Returns 1 if found.
+static int getBuildIdHex(const struct dl_phdr_info *info, char *hex) {
+    static const char digits[] = "0123456789abcdef";
+    for (int i = 0; i < info->dlpi_phnum; i++) {
+        const ElfW(Phdr) *phdr = &info->dlpi_phdr[i];
+        if (phdr->p_type != PT_NOTE)
+            continue;
+        size_t align = phdr->p_align == 8 ? 8 : 4;
+        const unsigned char *p = (const unsigned char *)(info->dlpi_addr + phdr->p_vaddr);
+        const unsigned char *end = p + phdr->p_memsz;
+        while (p + sizeof(ElfW(Nhdr)) <= end) {
+            const ElfW(Nhdr) *nhdr = (const ElfW(Nhdr) *)p;
+            size_t name_size = (nhdr->n_namesz + align - 1) & ~(align - 1);
+            size_t desc_size = (nhdr->n_descsz + align - 1) & ~(align - 1);
+            const unsigned char *name = p + sizeof(ElfW(Nhdr));
+            const unsigned char *desc = name + name_size;
+            if (desc + desc_size > end)
+                break;
+            if (nhdr->n_type == NT_GNU_BUILD_ID && nhdr->n_namesz == 4 &&
+                memcmp(name, "GNU", 4) == 0 &&
+                nhdr->n_descsz > 0 && nhdr->n_descsz <= BUILD_ID_MAX) {
+                for (size_t j = 0; j < nhdr->n_descsz; j++) {
+                    hex[j * 2] = digits[desc[j] >> 4];
+                    hex[j * 2 + 1] = digits[desc[j] & 0xf];
+                }
+                hex[nhdr->n_descsz * 2] = '\0';
+                return 1;
+            }
+            p = desc + desc_size;
+        }
+    }
+    return 0;
+}
+
+static uint64_t hashBytes(uint64_t hash, const unsigned char *p, size_t size) {
+    const unsigned char *end = p + size;
+    for (; p + 8 <= end; p += 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        hash ^= word;
+        hash *= 0x100000001b3ULL;
+        hash ^= hash >> 32;
+    }
+    for (; p < end; p++) {
+        hash ^= *p;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// Hashes a file with read-only mappings instead of read() calls.
+static char *hashFile(const char *path) {
+    if (path == NULL)
+        return NULL;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    uint64_t hash = 14695981039346656037ULL;
+    off_t file_size = st.st_size;
+    for (off_t offset = 0; offset < file_size; offset += HASH_WINDOW) {
+        size_t size = (size_t)(file_size - offset);
+        if (size > HASH_WINDOW)
+            size = HASH_WINDOW;
+        void *p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, offset);
+        if (p == MAP_FAILED) {
+            close(fd);
+            return NULL;
+        }
+        madvise(p, size, MADV_SEQUENTIAL);
+        hash = hashBytes(hash, (const unsigned char *)p, size);
+        munmap(p, size);
+    }
+    close(fd);
+    hash ^= (uint64_t)file_size;
+
+    char str[32];
+    snprintf(str, sizeof(str), "hash:%016llx", (unsigned long long)hash);
+    return envuAllocStrWithConst(str);
+}
+
+static int getExeBuildIdCallback(struct dl_phdr_info *info, size_t size, void *data) {
+    (void)size;
+    // The first module is the executable.
+    if (!getBuildIdHex(info, (char *)data))
+        *(char *)data = '\0';
+    return 1;
+}
+
+static char *exe_build_id = NULL;
+static pthread_once_t exe_build_id_once = PTHREAD_ONCE_INIT;
+
+static void initExeBuildId(void) {
+    char hex[BUILD_ID_HEX_MAX] = { 0 };
+    dl_iterate_phdr(getExeBuildIdCallback, hex);
+    if (*hex != '\0') {
+        exe_build_id = envuAllocStrWithConst(hex);
+        return;
+    }
+    // No build ID. Use a hash of the file content instead.
+    char *exe_path = envuGetExecutablePath();
+    exe_build_id = hashFile(exe_path);
+    envuFree(exe_path);
+}
+
+char *getExecutableBuildIdLinux(void) {
+    pthread_once(&exe_build_id_once, initExeBuildId);
+    return envuAllocStrWithConst(exe_build_id);
+}
+
+// A cached module list. Modules and strings are stored in a single memory block.
+typedef struct ModuleCache {
+    envuModule *modules;
+    size_t size;
+    int count;
+    unsigned long long adds;
+    unsigned long long subs;
+} ModuleCache;
+
+typedef struct ModuleItem {
+    char *path;
+    uintptr_t base;
+    char build_id[BUILD_ID_HEX_MAX];
+} ModuleItem;
+
+typedef struct ModuleItems {
+    ModuleItem *items;
+    int count;
+    int capacity;
+    int failed;
+} ModuleItems;
+
+static ModuleCache module_cache = { NULL, 0, 0, 0, 0 };
+static pthread_mutex_t module_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+#define HAS_DLPI_COUNTERS(size) \
+    ((size) >= offsetof(struct dl_phdr_info, dlpi_subs) + sizeof(unsigned long long))
+
+static int getModuleCountersCallback(struct dl_phdr_info *info, size_t size, void *data) {
+    unsigned long long *counters = (unsigned long long *)data;
+    if (HAS_DLPI_COUNTERS(size)) {
+        counters[0] = info->dlpi_adds;
+        counters[1] = info->dlpi_subs;
+    }
+    return 1;
+}
+
+static int getModulesCallback(struct dl_phdr_info *info, size_t size, void *data) {
+    (void)size;
+    ModuleItems *list = (ModuleItems *)data;
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 64;
+        ModuleItem *items = realloc(list->items, capacity * sizeof(ModuleItem));
+        if (items == NULL) {
+            list->failed = 1;
+            return 1;
+        }
+        list->items = items;
+        list->capacity = capacity;
+    }
+    ModuleItem *item = &list->items[list->count];
+    // Note: The name of the executable is an empty string.
+    item->path = envuAllocStrWithConst(info->dlpi_name ? info->dlpi_name : "");
+    if (item->path == NULL) {
+        list->failed = 1;
+        return 1;
+    }
+    item->base = (uintptr_t)info->dlpi_addr;
+    if (!getBuildIdHex(info, item->build_id))
+        item->build_id[0] = '\0';
+    list->count++;
+    return 0;
+}
+
+static void freeModuleItems(ModuleItems *list) {
+    for (int i = 0; i < list->count; i++)
+        envuFree(list->items[i].path);
+    free(list->items);
+}
+
+// Packs module items into a single memory block.
+static envuModule *packModules(ModuleItems *list, size_t *block_size) {
+    size_t size = (list->count + 1) * sizeof(envuModule);
+    for (int i = 0; i < list->count; i++) {
+        size += strlen(list->items[i].path) + 1;
+        size += strlen(list->items[i].build_id) + 1;
+    }
+    envuModule *modules = calloc(size, 1);
+    if (modules == NULL)
+        return NULL;
+
+    char *str = (char *)(modules + list->count + 1);
+    for (int i = 0; i < list->count; i++) {
+        ModuleItem *item = &list->items[i];
+        size_t len = strlen(item->path) + 1;
+        memcpy(str, item->path, len);
+        modules[i].path = str;
+        str += len;
+        modules[i].base = item->base;
+        if (item->build_id[0] != '\0') {
+            len = strlen(item->build_id) + 1;
+            memcpy(str, item->build_id, len);
+            modules[i].build_id = str;
+            str += len;
+        }
+    }
+    *block_size = size;
+    return modules;
+}
+
+static int refreshModuleCache(void) {
+    ModuleItems list = { NULL, 0, 0, 0 };
+    dl_iterate_phdr(getModulesCallback, &list);
+    if (list.failed || list.count == 0) {
+        freeModuleItems(&list);
+        return -1;
+    }
+
+    // Use the true path for the executable.
+    if (list.items[0].path[0] == '\0') {
+        char *exe_path = envuGetExecutablePath();
+        if (exe_path != NULL) {
+            envuFree(list.items[0].path);
+            list.items[0].path = exe_path;
+        }
+    }
+
+    size_t size;
+    envuModule *modules = packModules(&list, &size);
+    int count = list.count;
+    freeModuleItems(&list);
+    if (modules == NULL)
+        return -1;
+
+    free(module_cache.modules);
+    module_cache.modules = modules;
+    module_cache.size = size;
+    module_cache.count = count;
+    return 0;
+}
+
+envuModule *getLoadedModulesLinux(int *module_count) {
+    if (module_count != NULL)
+        *module_count = 0;
+
+    // Note: dlpi_adds and dlpi_subs are increased by dlopen() and dlclose().
+    unsigned long long counters[2] = { ~0ULL, ~0ULL };
+    dl_iterate_phdr(getModuleCountersCallback, counters);
+    int unknown = counters[0] == ~0ULL;
+
+    pthread_mutex_lock(&module_cache_mutex);
+    if (module_cache.modules == NULL || unknown ||
+        module_cache.adds != counters[0] || module_cache.subs != counters[1]) {
+        if (refreshModuleCache() != 0) {
+            pthread_mutex_unlock(&module_cache_mutex);
+            return NULL;
+        }
+        module_cache.adds = counters[0];
+        module_cache.subs = counters[1];
+    }
+
+    // Copy the cache and relocate its pointers.
+    envuModule *modules = malloc(module_cache.size);
+    if (modules != NULL) {
+        memcpy(modules, module_cache.modules, module_cache.size);
+        ptrdiff_t diff = (const char *)modules - (const char *)module_cache.modules;
+        for (int i = 0; i < module_cache.count; i++) {
+            modules[i].path += diff;
+            if (modules[i].build_id != NULL)
+                modules[i].build_id += diff;
+        }
+        if (module_count != NULL)
+            *module_count = module_cache.count;
+    }
+    pthread_mutex_unlock(&module_cache_mutex);
+    return modules;
+}
+
+// Splits a line of /proc/self/mountinfo into fields.
+// e.g. "36 35 98:0 /mnt1 /mnt2 rw,noatime master:1 - ext3 /dev/root rw,errors=continue"
+// Returns 0 if successful.
+int envuParseMountinfoLine(char *line, envuMountinfoFields *fields) {
+    char *tokens[6];
+    char *p = line;
+    for (int i = 0; i < 6; i++) {
+        while (*p == ' ')
+            p++;
+        if (*p == '\0')
+            return -1;
+        tokens[i] = p;
+        while (*p != ' ' && *p != '\0')
+            p++;
+        if (*p != '\0')
+            *p++ = '\0';
+    }
+    fields->mount_id = tokens[0];
+    fields->parent_id = tokens[1];
+    fields->dev = tokens[2];
+    fields->root = tokens[3];
+    fields->mount_point = tokens[4];
+    fields->options = tokens[5];
+    fields->optional = p;
+    // Find the separator
+    char *sep = strstr(p, " - ");
+    if (sep == NULL) {
+        if (strncmp(p, "- ", 2) != 0)
+            return -1;
+        sep = p - 1;
+        fields->optional = "";
+    } else {
+        *sep = '\0';
+    }
+    p = sep + 3;
+    char *rest[3] = { NULL, NULL, NULL };
+    for (int i = 0; i < 3; i++) {
+        while (*p == ' ')
+            p++;
+        rest[i] = p;
+        while (*p != ' ' && *p != '\0')
+            p++;
+        if (*p != '\0')
+            *p++ = '\0';
+    }
+    fields->fstype = rest[0];
+    fields->source = rest[1];
+    fields->super_options = rest[2];
+    return 0;
+}
+
+// Returns 1 if a comma separated list has the specified item.
+int envuHasListItem(const char *list, const char *item) {
+    size_t len = strlen(item);
+    const char *p = list;
+    while (p != NULL && *p != '\0') {
+        if (strncmp(p, item, len) == 0 && (p[len] == ',' || p[len] == '\0' || p[len] == '\n'))
+            return 1;
+        p = strchr(p, ',');
+        if (p != NULL)
+            p++;
+    }
+    return 0;
+}
+
+static void setCgroupPath(envuCgroupDir *dir, const char *mount_root, const char *cgroup_path) {
+    // Strip the mount root. (e.g. "/docker/abc" in containers)
+    size_t root_len = strlen(mount_root);
+    if (strcmp(mount_root, "/") != 0 && strncmp(cgroup_path, mount_root, root_len) == 0 &&
+        (cgroup_path[root_len] == '/' || cgroup_path[root_len] == '\0'))
+        cgroup_path += root_len;
+    if (strcmp(cgroup_path, "/") == 0)
+        cgroup_path = "";
+    snprintf(dir->path, sizeof(dir->path), "%s", cgroup_path);
+}
+
+int envuFindCgroupDir(const char *controller, envuCgroupDir *dir) {
+    memset(dir, 0, sizeof(*dir));
+    char *cgroup = envuReadSysFileAlloc("/proc/self/cgroup", NULL);
+    if (cgroup == NULL)
+        return -1;
+
+    // Find the cgroup paths. e.g. "4:cpu,cpuacct:/docker/abc" or "0::/user.slice"
+    const char *v1_path = NULL;
+    const char *v2_path = NULL;
+    char *saveptr;
+    for (char *line = strtok_r(cgroup, "\n", &saveptr); line != NULL;
+         line = strtok_r(NULL, "\n", &saveptr)) {
+        char *controllers = strchr(line, ':');
+        if (controllers == NULL)
+            continue;
+        controllers++;
+        char *path = strchr(controllers, ':');
+        if (path == NULL)
+            continue;
+        *path++ = '\0';
+        if (*controllers == '\0')
+            v2_path = path;
+        else if (envuHasListItem(controllers, controller))
+            v1_path = path;
+    }
+
+    char *mountinfo = envuReadSysFileAlloc("/proc/self/mountinfo", NULL);
+    if (mountinfo != NULL) {
+        for (char *line = strtok_r(mountinfo, "\n", &saveptr); line != NULL;
+             line = strtok_r(NULL, "\n", &saveptr)) {
+            envuMountinfoFields fields;
+            if (envuParseMountinfoLine(line, &fields) != 0)
+                continue;
+            if (v1_path != NULL && strcmp(fields.fstype, "cgroup") == 0 &&
+                envuHasListItem(fields.super_options, controller)) {
+                dir->version = 1;
+                snprintf(dir->mount_point, sizeof(dir->mount_point), "%s", fields.mount_point);
+                setCgroupPath(dir, fields.root, v1_path);
+                break;
+            }
+            if (v1_path == NULL && v2_path != NULL && strcmp(fields.fstype, "cgroup2") == 0) {
+                dir->version = 2;
+                snprintf(dir->mount_point, sizeof(dir->mount_point), "%s", fields.mount_point);
+                setCgroupPath(dir, fields.root, v2_path);
+                break;
+            }
+        }
+        free(mountinfo);
+    }
+
+    if (dir->version == 0 && v1_path == NULL && v2_path != NULL) {
+        // mountinfo is not available. Assume the default mount point.
+        dir->version = 2;
+        snprintf(dir->mount_point, sizeof(dir->mount_point), "/sys/fs/cgroup");
+        setCgroupPath(dir, "/", v2_path);
+    }
+    free(cgroup);
+    if (dir->version == 0)
+        return -1;
+
+    // The cgroup path might be invisible from a container. Use the mount point then.
+    char path[PATH_MAX];
+    char full_path[PATH_MAX];
+    int len = snprintf(path, sizeof(path), "%s%s", dir->mount_point, dir->path);
+    if (len < 0 || (size_t)len >= sizeof(path) ||
+        envuGetSysPath(path, full_path, sizeof(full_path)) != 0 || !envuPathExists(full_path))
+        dir->path[0] = '\0';
+    return 0;
+}
+
+// Reads a file in a cgroup directory. Returns the length of the content or -1.
+ssize_t envuReadCgroupFile(const envuCgroupDir *dir, const char *name, char *buf, size_t size) {
+    char path[PATH_MAX];
+    int len = snprintf(path, sizeof(path), "%s%s/%s", dir->mount_point, dir->path, name);
+    if (len < 0 || (size_t)len >= sizeof(path))
+        return -1;
+    return envuReadSysFile(path, buf, size);
+}
+
+// Moves a cgroup directory to its parent. Returns 0 if successful, or -1 at the root.
+int envuGetCgroupParent(envuCgroupDir *dir) {
+    char *slash = strrchr(dir->path, '/');
+    if (slash == NULL)
+        return -1;
+    *slash = '\0';
+    return 0;
+}
+
+// Gets the cpu quota as the number of cpus. Returns 0 if unlimited.
+static double getCgroupCpuQuota(envuCgroupDir *dir) {
+    double quota = 0;
+    char buf[128];
+    do {
+        double level_quota = 0;
+        if (dir->version == 2) {
+            // "max 100000" or "150000 100000"
+            if (envuReadCgroupFile(dir, "cpu.max", buf, sizeof(buf)) > 0 &&
+                strncmp(buf, "max", 3) != 0) {
+                char *end;
+                double q = strtod(buf, &end);
+                double period = strtod(end, NULL);
+                if (q > 0 && period > 0)
+                    level_quota = q / period;
+            }
+        } else {
+            // cfs_quota_us is -1 when unlimited.
+            char buf2[128];
+            if (envuReadCgroupFile(dir, "cpu.cfs_quota_us", buf, sizeof(buf)) > 0 &&
+                envuReadCgroupFile(dir, "cpu.cfs_period_us", buf2, sizeof(buf2)) > 0) {
+                double q = strtod(buf, NULL);
+                double period = strtod(buf2, NULL);
+                if (q > 0 && period > 0)
+                    level_quota = q / period;
+            }
+        }
+        if (level_quota > 0 && (quota == 0 || level_quota < quota))
+            quota = level_quota;
+    } while (envuGetCgroupParent(dir) == 0);
+    return quota;
+}
+
+static int getCgroupCpusetCount(envuCgroupDir *dir) {
+    char buf[4096];
+    const char *names[] = { "cpuset.cpus.effective", "cpuset.effective_cpus", "cpuset.cpus" };
+    for (int i = 0; i < 3; i++) {
+        if (envuReadCgroupFile(dir, names[i], buf, sizeof(buf)) <= 0)
+            continue;
+        int count = envuParseCpuList(buf, NULL, ENVU_MAX_CPUS / 64);
+        if (count > 0)
+            return count;
+    }
+    return -1;
+}
+
+static int getAffinityCount(void) {
+    for (int cpus = 1024; cpus <= 65536; cpus *= 2) {
+        cpu_set_t *set = CPU_ALLOC(cpus);
+        if (set == NULL)
+            return -1;
+        size_t size = CPU_ALLOC_SIZE(cpus);
+        CPU_ZERO_S(size, set);
+        if (sched_getaffinity(0, size, set) == 0) {
+            int count = CPU_COUNT_S(size, set);
+            CPU_FREE(set);
+            return count;
+        }
+        CPU_FREE(set);
+        if (errno != EINVAL)
+            return -1;
+    }
+    return -1;
+}
+
+int getEffectiveCpuCountLinux(envuCpuCountInfo *out) {
+    envuCpuCountInfo info;
+    memset(&info, 0, sizeof(info));
+    info.cpuset = -1;
+
+    char buf[4096];
+    if (envuReadSysFile("/sys/devices/system/cpu/online", buf, sizeof(buf)) > 0)
+        info.online = envuParseCpuList(buf, NULL, ENVU_MAX_CPUS / 64);
+    if (info.online <= 0)
+        info.online = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    info.affinity = getAffinityCount();
+
+    envuCgroupDir dir;
+    if (envuFindCgroupDir("cpu", &dir) == 0) {
+        info.cgroup_version = dir.version;
+        info.quota = getCgroupCpuQuota(&dir);
+    }
+    if (envuFindCgroupDir("cpuset", &dir) == 0) {
+        if (info.cgroup_version == 0)
+            info.cgroup_version = dir.version;
+        info.cpuset = getCgroupCpusetCount(&dir);
+    }
+
+    // Use the minimum value of the components.
+    int count = info.online > 0 ? info.online : 1;
+    if (info.affinity > 0 && info.affinity < count)
+        count = info.affinity;
+    if (info.cpuset > 0 && info.cpuset < count)
+        count = info.cpuset;
+    if (info.quota > 0) {
+        // Round up the quota. e.g. 1.5 cpus -> 2 threads
+        int quota_count = (int)info.quota;
+        if (quota_count < info.quota)
+            quota_count++;
+        if (quota_count < count)
+            count = quota_count;
+    }
+    info.effective = count > 0 ? count : 1;
+    if (out != NULL)
+        *out = info;
+    return info.effective;
+}
+
+// Parses /proc/meminfo in a single pass. Values are in kB.
+static int parseMeminfo(envuMemoryInfo *info) {
+    char buf[8192];
+    if (envuReadSysFile("/proc/meminfo", buf, sizeof(buf)) <= 0)
+        return -1;
+
+    uint64_t mem_free = 0;
+    uint64_t cached = 0;
+    uint64_t buffers = 0;
+    int has_available = 0;
+    const char *p = buf;
+    while (*p != '\0') {
+        const char *key = p;
+        const char *colon = strchr(p, ':');
+        if (colon == NULL)
+            break;
+        size_t key_len = (size_t)(colon - key);
+        p = colon + 1;
+        while (*p == ' ')
+            p++;
+        uint64_t value = 0;
+        while (*p >= '0' && *p <= '9') {
+            value = value * 10 + (uint64_t)(*p - '0');
+            p++;
+        }
+        value *= 1024;
+        while (*p != '\n' && *p != '\0')
+            p++;
+        if (*p == '\n')
+            p++;
+
+#define IS_KEY(k) (key_len == sizeof(k) - 1 && memcmp(key, k, key_len) == 0)
+        if (IS_KEY("MemTotal")) {
+            info->total = value;
+        } else if (IS_KEY("MemFree")) {
+            mem_free = value;
+        } else if (IS_KEY("MemAvailable")) {
+            info->available = value;
+            has_available = 1;
+        } else if (IS_KEY("Buffers")) {
+            buffers = value;
+        } else if (IS_KEY("Cached")) {
+            cached = value;
+        } else if (IS_KEY("SwapTotal")) {
+            info->swap_total = value;
+        } else if (IS_KEY("SwapFree")) {
+            info->swap_free = value;
+        }
+#undef IS_KEY
+    }
+    // MemAvailable is not available before Linux 3.14.
+    if (!has_available)
+        info->available = mem_free + buffers + cached;
+    return info->total > 0 ? 0 : -1;
+}
+
+// Reads a memory limit of cgroup. Returns ENVU_MEMORY_UNLIMITED if it's "max" or missing.
+static uint64_t readCgroupMemValue(const envuCgroupDir *dir, const char *name) {
+    char buf[64];
+    if (envuReadCgroupFile(dir, name, buf, sizeof(buf)) <= 0 || strncmp(buf, "max", 3) == 0 ||
+        buf[0] < '0' || buf[0] > '9')
+        return ENVU_MEMORY_UNLIMITED;
+    uint64_t value = strtoull(buf, NULL, 10);
+    // cgroup v1 uses a huge value (e.g. 9223372036854771712) as unlimited.
+    if (value >= (1ULL << 62))
+        return ENVU_MEMORY_UNLIMITED;
+    return value;
+}
+
+static uint64_t readCgroupMemUsage(const envuCgroupDir *dir, const char *name) {
+    uint64_t usage = readCgroupMemValue(dir, name);
+    return usage == ENVU_MEMORY_UNLIMITED ? 0 : usage;
+}
+
+static uint64_t minLimit(uint64_t a, uint64_t b) {
+    return a < b ? a : b;
+}
+
+static void getCgroupMemoryInfo(envuMemoryInfo *info) {
+    info->cgroup_max = ENVU_MEMORY_UNLIMITED;
+    info->cgroup_high = ENVU_MEMORY_UNLIMITED;
+    info->cgroup_swap_max = ENVU_MEMORY_UNLIMITED;
+    envuCgroupDir dir;
+    if (envuFindCgroupDir("memory", &dir) != 0)
+        return;
+    info->cgroup_version = dir.version;
+    if (dir.version == 2) {
+        info->cgroup_usage = readCgroupMemUsage(&dir, "memory.current");
+        do {
+            info->cgroup_max = minLimit(info->cgroup_max, readCgroupMemValue(&dir, "memory.max"));
+            info->cgroup_high = minLimit(info->cgroup_high,
+                                         readCgroupMemValue(&dir, "memory.high"));
+            info->cgroup_swap_max = minLimit(info->cgroup_swap_max,
+                                             readCgroupMemValue(&dir, "memory.swap.max"));
+        } while (envuGetCgroupParent(&dir) == 0);
+    } else {
+        info->cgroup_usage = readCgroupMemUsage(&dir, "memory.usage_in_bytes");
+        do {
+            uint64_t limit = readCgroupMemValue(&dir, "memory.limit_in_bytes");
+            uint64_t memsw = readCgroupMemValue(&dir, "memory.memsw.limit_in_bytes");
+            info->cgroup_max = minLimit(info->cgroup_max, limit);
+            // memsw.limit_in_bytes is the limit of memory + swap.
+            if (limit != ENVU_MEMORY_UNLIMITED && memsw != ENVU_MEMORY_UNLIMITED && memsw >= limit)
+                info->cgroup_swap_max = minLimit(info->cgroup_swap_max, memsw - limit);
+        } while (envuGetCgroupParent(&dir) == 0);
+    }
+}
+
+int getMemoryInfoLinux(envuMemoryInfo *out) {
+    if (out == NULL)
+        return -1;
+    envuMemoryInfo info;
+    memset(&info, 0, sizeof(info));
+    long page_size = sysconf(_SC_PAGESIZE);
+    info.page_size = page_size > 0 ? (uint64_t)page_size : 4096;
+    if (parseMeminfo(&info) != 0)
+        return -1;
+    getCgroupMemoryInfo(&info);
+
+    info.effective_limit = minLimit(info.total, minLimit(info.cgroup_max, info.cgroup_high));
+    info.budget = info.available;
+    if (info.effective_limit < info.total) {
+        uint64_t rest = 0;
+        if (info.cgroup_usage < info.effective_limit)
+            rest = info.effective_limit - info.cgroup_usage;
+        if (rest < info.budget)
+            info.budget = rest;
+    }
+    *out = info;
+    return 0;
+}
+
+// Reads the selected mode like "always [madvise] never".
+static void readThpMode(const char *path, char *mode, size_t size) {
+    char buf[256];
+    mode[0] = '\0';
+    if (envuReadSysFile(path, buf, sizeof(buf)) <= 0)
+        return;
+    char *start = strchr(buf, '[');
+    char *end = start != NULL ? strchr(start, ']') : NULL;
+    if (end == NULL || (size_t)(end - start - 1) >= size)
+        return;
+    memcpy(mode, start + 1, end - start - 1);
+    mode[end - start - 1] = '\0';
+}
+
+static uint64_t readHugePageCount(const char *dir, const char *name) {
+    char path[PATH_MAX];
+    long long val;
+    int len = snprintf(path, sizeof(path), "%s/%s", dir, name);
+    if (len < 0 || (size_t)len >= sizeof(path))
+        return 0;
+    if (envuReadSysLong(path, &val) != 0 || val < 0)
+        return 0;
+    return (uint64_t)val;
+}
+
+static int compareU64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Lists "hugepages-2048kB" entries as sizes in kB.
+static int listHugePageSizes(uint64_t *sizes, int max_count) {
+    char path[PATH_MAX];
+    if (envuGetSysPath("/sys/kernel/mm/hugepages", path, sizeof(path)) != 0)
+        return 0;
+    DIR *dir = opendir(path);
+    if (dir == NULL)
+        return 0;
+    int count = 0;
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL && count < max_count) {
+        unsigned long long kb;
+        char unit[3];
+        if (sscanf(ent->d_name, "hugepages-%llu%2s", &kb, unit) == 2 &&
+            strcmp(unit, "kB") == 0)
+            sizes[count++] = kb;
+    }
+    closedir(dir);
+    qsort(sizes, count, sizeof(uint64_t), compareU64);
+    return count;
+}
+
+static void storeU64(const uint64_t *dst, uint64_t value) {
+    __atomic_store_n((uint64_t *)dst, value, __ATOMIC_RELAXED);
+}
+
+// Reads page counts into an existing structure.
+// Counts are stored atomically because callers might read them while refreshing.
+static void loadHugePageCounts(envuHugePageInfo *info) {
+    struct rlimit rlim;
+    uint64_t memlock_limit = 0;
+    if (getrlimit(RLIMIT_MEMLOCK, &rlim) == 0)
+        memlock_limit = rlim.rlim_cur == RLIM_INFINITY ? UINT64_MAX : rlim.rlim_cur;
+    storeU64(&info->memlock_limit, memlock_limit);
+
+    int node_count = info->node_count;
+    for (int i = 0; i < info->size_count; i++) {
+        envuHugePageSize *hp = (envuHugePageSize *)&info->sizes[i];
+        unsigned long long kb = (unsigned long long)(hp->size / 1024);
+        char dir[PATH_MAX];
+        snprintf(dir, sizeof(dir), "/sys/kernel/mm/hugepages/hugepages-%llukB", kb);
+        uint64_t total = readHugePageCount(dir, "nr_hugepages");
+        uint64_t free_pages = readHugePageCount(dir, "free_hugepages");
+        storeU64(&hp->total, total);
+        storeU64(&hp->free, free_pages);
+        storeU64(&hp->reserved, readHugePageCount(dir, "resv_hugepages"));
+        storeU64(&hp->surplus, readHugePageCount(dir, "surplus_hugepages"));
+        __atomic_store_n(&hp->can_lock, memlock_limit >= hp->size, __ATOMIC_RELAXED);
+
+        for (int j = 0; j < node_count; j++) {
+            snprintf(dir, sizeof(dir),
+                     "/sys/devices/system/node/node%d/hugepages/hugepages-%llukB",
+                     info->node_ids[j], kb);
+            char path[PATH_MAX];
+            struct stat st;
+            if (node_count == 1 && (envuGetSysPath(dir, path, sizeof(path)) != 0 ||
+                                    stat(path, &st) != 0)) {
+                // Kernels without NUMA have the whole pool in a single node.
+                storeU64(&hp->node_total[j], total);
+                storeU64(&hp->node_free[j], free_pages);
+                continue;
+            }
+            storeU64(&hp->node_total[j], readHugePageCount(dir, "nr_hugepages"));
+            storeU64(&hp->node_free[j], readHugePageCount(dir, "free_hugepages"));
+        }
+    }
+}
+
+static envuHugePageInfo *createHugePageInfo(void) {
+    uint64_t size_kb[64];
+    int size_count = listHugePageSizes(size_kb, 64);
+    const envuNumaTopology *numa = getNumaTopologyLinux();
+    int node_count = numa != NULL ? numa->count : 0;
+
+    // Allocate the info, sizes, node IDs, and node counts in a single block.
+    size_t size = sizeof(envuHugePageInfo) + size_count * sizeof(envuHugePageSize) +
+                  size_count * node_count * 2 * sizeof(uint64_t) + node_count * sizeof(int);
+    envuHugePageInfo *info = calloc(1, size);
+    if (info == NULL)
+        return NULL;
+    envuHugePageSize *sizes = (envuHugePageSize *)(info + 1);
+    uint64_t *node_counts = (uint64_t *)(sizes + size_count);
+    int *node_ids = (int *)(node_counts + size_count * node_count * 2);
+    info->size_count = size_count;
+    info->sizes = sizes;
+    info->node_count = node_count;
+    info->node_ids = node_ids;
+    for (int j = 0; j < node_count; j++)
+        node_ids[j] = numa->nodes[j].id;
+
+    for (int i = 0; i < size_count; i++) {
+        envuHugePageSize *hp = &sizes[i];
+        hp->size = size_kb[i] * 1024;
+        hp->node_total = node_counts + i * node_count * 2;
+        hp->node_free = hp->node_total + node_count;
+    }
+    loadHugePageCounts(info);
+
+    char buf[8192];
+    if (envuReadSysFile("/proc/meminfo", buf, sizeof(buf)) > 0) {
+        const char *p = strstr(buf, "Hugepagesize:");
+        if (p != NULL)
+            info->default_size = strtoull(p + sizeof("Hugepagesize:") - 1, NULL, 10) * 1024;
+    }
+
+    readThpMode("/sys/kernel/mm/transparent_hugepage/enabled",
+                info->thp_enabled, sizeof(info->thp_enabled));
+    readThpMode("/sys/kernel/mm/transparent_hugepage/defrag",
+                info->thp_defrag, sizeof(info->thp_defrag));
+    readThpMode("/sys/kernel/mm/transparent_hugepage/shmem_enabled",
+                info->shmem_enabled, sizeof(info->shmem_enabled));
+    long long pmd_size;
+    if (envuReadSysLong("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", &pmd_size) == 0)
+        info->thp_pmd_size = (uint64_t)pmd_size;
+    return info;
+}
+
+static envuHugePageInfo *huge_page_info = NULL;
+static unsigned int huge_page_info_gen = 0;
+static pthread_mutex_t huge_page_info_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+const envuHugePageInfo *getHugePageInfoLinux(int refresh) {
+    unsigned int gen = envuGetSysRootGen();
+    pthread_mutex_lock(&huge_page_info_mutex);
+    if (huge_page_info == NULL || huge_page_info_gen != gen) {
+        // Note: Old structures are not freed because callers might still use them.
+        huge_page_info = createHugePageInfo();
+        huge_page_info_gen = gen;
+    } else if (refresh) {
+        // Sizes and NUMA nodes don't change in a generation. Update counts in place.
+        loadHugePageCounts(huge_page_info);
+    }
+    const envuHugePageInfo *info = huge_page_info;
+    pthread_mutex_unlock(&huge_page_info_mutex);
+    return info;
+}
@@ -0,0 +1,213 @@
+#define _GNU_SOURCE
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "env_utils.h"
+#include "env_utils_priv.h"
+
+#define CPU_MASK_WORDS (ENVU_MAX_CPUS / 64)
+#define MAX_WARNINGS 8
+
+typedef struct BenchWarnings {
+    int count;
+    char messages[MAX_WARNINGS][192];
+} BenchWarnings;
+
+// Reads a single-line sysfs file without the last line feed.
+static int readSysLine(const char *path, char *buf, size_t size) {
+    ssize_t len = envuReadSysFile(path, buf, size);
+    if (len <= 0) {
+        buf[0] = '\0';
+        return -1;
+    }
+    if (buf[len - 1] == '\n')
+        buf[len - 1] = '\0';
+    return 0;
+}
+
+static uint64_t readCpuFreqValue(int cpu, const char *name) {
+    char path[128];
+    long long value;
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/%s", cpu, name);
+    if (envuReadSysLong(path, &value) != 0 || value < 0)
+        return 0;
+    return (uint64_t)value;
+}
+
+static void readCpuFreq(int cpu, envuCpuFreq *freq) {
+    char path[128];
+    freq->cpu = cpu;
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_governor", cpu);
+    readSysLine(path, freq->governor, sizeof(freq->governor));
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_driver", cpu);
+    readSysLine(path, freq->driver, sizeof(freq->driver));
+    freq->cur_khz = readCpuFreqValue(cpu, "scaling_cur_freq");
+    freq->min_khz = readCpuFreqValue(cpu, "scaling_min_freq");
+    freq->max_khz = readCpuFreqValue(cpu, "scaling_max_freq");
+}
+
+static int readTurbo(const envuCpuFreq *cpus, int cpu_count) {
+    long long value;
+    // intel_pstate reports the inverted state.
+    if (envuReadSysLong("/sys/devices/system/cpu/intel_pstate/no_turbo", &value) == 0)
+        return value == 0;
+    // acpi-cpufreq has a global switch.
+    if (envuReadSysLong("/sys/devices/system/cpu/cpufreq/boost", &value) == 0)
+        return value != 0;
+    // amd-pstate has a switch for each policy.
+    int turbo = -1;
+    for (int i = 0; i < cpu_count; i++) {
+        char path[128];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/boost",
+                 cpus[i].cpu);
+        if (envuReadSysLong(path, &value) != 0)
+            continue;
+        if (value != 0)
+            return 1;
+        turbo = 0;
+    }
+    return turbo;
+}
+
+// Parses "0.20 0.18 0.12 1/80 11206"
+static void readLoadAvg(envuBenchEnvironment *env) {
+    char buf[128];
+    env->loadavg[0] = env->loadavg[1] = env->loadavg[2] = -1;
+    env->runnable = -1;
+    if (envuReadSysFile("/proc/loadavg", buf, sizeof(buf)) <= 0)
+        return;
+    const char *p = buf;
+    for (int i = 0; i < 3; i++) {
+        while (*p == ' ')
+            p++;
+        if (*p < '0' || *p > '9')
+            return;
+        env->loadavg[i] = envuParseDecimal(p, &p);
+    }
+    while (*p == ' ')
+        p++;
+    if (*p >= '0' && *p <= '9')
+        env->runnable = atoi(p);
+}
+
+static void addWarning(envuBenchEnvironment *env, BenchWarnings *warnings,
+                       envuBenchWarning flag, const char *fmt, ...) {
+    env->warnings |= flag;
+    if (warnings->count >= MAX_WARNINGS)
+        return;
+    va_list va;
+    va_start(va, fmt);
+    vsnprintf(warnings->messages[warnings->count], sizeof(warnings->messages[0]), fmt, va);
+    va_end(va);
+    warnings->count++;
+}
+
+static void checkBenchEnvironment(envuBenchEnvironment *env, BenchWarnings *warnings) {
+    int slow_count = 0;
+    const char *slow_governor = NULL;
+    for (int i = 0; i < env->cpu_count; i++) {
+        const char *governor = env->cpus[i].governor;
+        if (*governor == '\0' || strcmp(governor, "performance") == 0)
+            continue;
+        if (slow_governor == NULL)
+            slow_governor = governor;
+        slow_count++;
+    }
+    if (slow_count > 0)
+        addWarning(env, warnings, ENVU_BENCH_WARN_GOVERNOR,
+                   "%d of %d CPUs use the \"%s\" governor instead of \"performance\".",
+                   slow_count, env->cpu_count, slow_governor);
+    if (env->turbo == 1)
+        addWarning(env, warnings, ENVU_BENCH_WARN_TURBO,
+                   "Turbo boost is enabled. Clock speeds depend on temperature and load.");
+    if (env->smt_active == 1)
+        addWarning(env, warnings, ENVU_BENCH_WARN_SMT,
+                   "SMT is active. Sibling threads share execution units.");
+    if (env->aslr > 0)
+        addWarning(env, warnings, ENVU_BENCH_WARN_ASLR,
+                   "ASLR is enabled (kernel.randomize_va_space = %d). "
+                   "Memory layouts differ between runs.", env->aslr);
+    // A benchmark itself keeps one CPU busy.
+    double max_load = env->cpu_count > 2 ? env->cpu_count * 0.5 : 1.0;
+    if (env->loadavg[0] > max_load)
+        addWarning(env, warnings, ENVU_BENCH_WARN_LOAD,
+                   "The load average is %.2f on %d CPUs. Other processes compete for CPUs.",
+                   env->loadavg[0], env->cpu_count);
+    if (strcmp(env->hypervisor, "none") != 0)
+        addWarning(env, warnings, ENVU_BENCH_WARN_VM,
+                   "Running on a hypervisor (%s). Steal time adds noise.", env->hypervisor);
+    if (strcmp(env->container, "none") != 0)
+        addWarning(env, warnings, ENVU_BENCH_WARN_CONTAINER,
+                   "Running in a container (%s). Cgroup limits can throttle the process.",
+                   env->container);
+}
+
+envuBenchEnvironment *getBenchEnvironmentLinux(void) {
+    uint64_t *mask = calloc(CPU_MASK_WORDS, sizeof(uint64_t));
+    if (mask == NULL)
+        return NULL;
+    char buf[4096];
+    int cpu_count = 0;
+    if (envuReadSysFile("/sys/devices/system/cpu/online", buf, sizeof(buf)) > 0)
+        cpu_count = envuParseCpuList(buf, mask, CPU_MASK_WORDS);
+    if (cpu_count < 0)
+        cpu_count = 0;
+
+    // Read values into a temporary structure, then copy them with warnings in a single block.
+    envuBenchEnvironment env = { 0 };
+    env.cpus = calloc(cpu_count > 0 ? cpu_count : 1, sizeof(envuCpuFreq));
+    if (env.cpus == NULL) {
+        free(mask);
+        return NULL;
+    }
+    for (int cpu = 0; cpu < ENVU_MAX_CPUS && env.cpu_count < cpu_count; cpu++) {
+        if (mask[cpu / 64] & (1ULL << (cpu % 64)))
+            readCpuFreq(cpu, &env.cpus[env.cpu_count++]);
+    }
+    free(mask);
+
+    env.turbo = readTurbo(env.cpus, env.cpu_count);
+    readSysLine("/sys/devices/system/cpu/smt/control", env.smt_control, sizeof(env.smt_control));
+    long long value;
+    env.smt_active = -1;
+    if (envuReadSysLong("/sys/devices/system/cpu/smt/active", &value) == 0)
+        env.smt_active = value != 0;
+    env.aslr = -1;
+    if (envuReadSysLong("/proc/sys/kernel/randomize_va_space", &value) == 0)
+        env.aslr = (int)value;
+    readLoadAvg(&env);
+    const envuVirtualization *virt = getVirtualizationLinux();
+    env.hypervisor = virt != NULL ? virt->hypervisor_name : "unknown";
+    env.container = virt != NULL ? virt->container_name : "unknown";
+
+    BenchWarnings warnings = { 0 };
+    checkBenchEnvironment(&env, &warnings);
+
+    size_t size = sizeof(envuBenchEnvironment) + env.cpu_count * sizeof(envuCpuFreq) +
+                  warnings.count * sizeof(char *);
+    for (int i = 0; i < warnings.count; i++)
+        size += strlen(warnings.messages[i]) + 1;
+    envuBenchEnvironment *out = malloc(size);
+    if (out == NULL) {
+        free(env.cpus);
+        return NULL;
+    }
+    *out = env;
+    out->cpus = (envuCpuFreq *)(out + 1);
+    memcpy(out->cpus, env.cpus, env.cpu_count * sizeof(envuCpuFreq));
+    free(env.cpus);
+    out->warning_messages = (const char **)(out->cpus + env.cpu_count);
+    out->warning_count = warnings.count;
+    char *str = (char *)(out->warning_messages + warnings.count);
+    for (int i = 0; i < warnings.count; i++) {
+        size_t len = strlen(warnings.messages[i]) + 1;
+        memcpy(str, warnings.messages[i], len);
+        out->warning_messages[i] = str;
+        str += len;
+    }
+    return out;
+}
@@ -0,0 +1,926 @@
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/fs.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/statfs.h>
+#include <sys/statvfs.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+#include "env_utils.h"
+#include "env_utils_priv.h"
+
+#define MAX_STORAGE_DEVICES 64
+#define MAX_STACK_DEPTH 16
+
+// Offset of the byte that the sparse file probe writes.
+#define SPARSE_PROBE_OFFSET (1024 * 1024)
+
+// Reads a sysfs attribute of a device directory.
+// dir is a resolved path that already includes the sysroot.
+static ssize_t readDevFile(const char *dir, const char *name, char *buf, size_t size) {
+    char path[PATH_MAX];
+    buf[0] = '\0';
+    int len = snprintf(path, sizeof(path), "%s/%s", dir, name);
+    if (len < 0 || (size_t)len >= sizeof(path))
+        return -1;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return -1;
+    ssize_t ret;
+    do {
+        ret = read(fd, buf, size - 1);
+    } while (ret < 0 && errno == EINTR);
+    close(fd);
+    if (ret < 0)
+        return -1;
+    buf[ret] = '\0';
+    return ret;
+}
+
+// Reads a single-line attribute without the last line feed.
+static int readDevLine(const char *dir, const char *name, char *buf, size_t size) {
+    if (readDevFile(dir, name, buf, size) <= 0)
+        return -1;
+    char *lf = strchr(buf, '\n');
+    if (lf != NULL)
+        *lf = '\0';
+    return 0;
+}
+
+static long long readDevLong(const char *dir, const char *name) {
+    char buf[64];
+    if (readDevLine(dir, name, buf, sizeof(buf)) != 0 || buf[0] < '0' || buf[0] > '9')
+        return -1;
+    return strtoll(buf, NULL, 10);
+}
+
+// Resolves symlinks in a device directory. e.g. /sys/dev/block/8:1 -> .../block/sda/sda1
+static int resolveDevDir(const char *dir, const char *name, char *out) {
+    char path[PATH_MAX];
+    int len = snprintf(path, sizeof(path), "%s/%s", dir, name);
+    if (len < 0 || (size_t)len >= sizeof(path) || realpath(path, out) == NULL)
+        return -1;
+    return 0;
+}
+
+// Reads "8:1" from the dev attribute.
+static int readDevNumber(const char *dir, unsigned int *major, unsigned int *minor) {
+    char buf[32];
+    if (readDevLine(dir, "dev", buf, sizeof(buf)) != 0 ||
+        sscanf(buf, "%u:%u", major, minor) != 2)
+        return -1;
+    return 0;
+}
+
+// Gets DEVTYPE from uevent. e.g. "disk", "partition"
+static void readDevType(const char *dir, char *devtype, size_t size) {
+    char buf[1024];
+    devtype[0] = '\0';
+    if (readDevFile(dir, "uevent", buf, sizeof(buf)) <= 0)
+        return;
+    const char *p = buf;
+    while (*p != '\0') {
+        size_t len = strcspn(p, "\n");
+        if (strncmp(p, "DEVTYPE=", 8) == 0 && len > 8) {
+            snprintf(devtype, size, "%.*s", (int)(len - 8), p + 8);
+            return;
+        }
+        p += len;
+        if (*p == '\n')
+            p++;
+    }
+}
+
+static int isPartition(const char *dir) {
+    char devtype[32];
+    readDevType(dir, devtype, sizeof(devtype));
+    if (devtype[0] != '\0')
+        return strcmp(devtype, "partition") == 0;
+    // Old kernels have no DEVTYPE, but partitions always have the partition attribute.
+    return readDevLong(dir, "partition") >= 0;
+}
+
+// Gets the active scheduler from "mq-deadline kyber [bfq] none"
+static void parseScheduler(const char *str, char *out, size_t size) {
+    const char *start = strchr(str, '[');
+    const char *end = start != NULL ? strchr(start, ']') : NULL;
+    if (start == NULL || end == NULL) {
+        int len = snprintf(out, size, "%s", str);
+        if (len < 0 || (size_t)len >= size)
+            out[0] = '\0';
+        return;
+    }
+    start++;
+    size_t len = (size_t)(end - start);
+    if (len >= size)
+        len = size - 1;
+    memcpy(out, start, len);
+    out[len] = '\0';
+}
+
+// Reads a device. Queue attributes are read from queue_dir. (the disk for partitions)
+static void readBlockDevice(const char *dir, const char *queue_dir, envuBlockDevice *dev) {
+    memset(dev, 0, sizeof(*dev));
+    const char *name = strrchr(dir, '/');
+    snprintf(dev->name, sizeof(dev->name), "%s", name != NULL ? name + 1 : dir);
+    readDevNumber(dir, &dev->major, &dev->minor);
+    dev->is_nvme = strncmp(dev->name, "nvme", 4) == 0;
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/queue", queue_dir);
+    long long value = readDevLong(path, "rotational");
+    dev->rotational = value < 0 ? -1 : value != 0;
+    value = readDevLong(path, "logical_block_size");
+    dev->logical_block_size = value < 0 ? 0 : (unsigned int)value;
+    value = readDevLong(path, "physical_block_size");
+    dev->physical_block_size = value < 0 ? 0 : (unsigned int)value;
+    value = readDevLong(path, "nr_requests");
+    dev->nr_requests = (int)value;
+    value = readDevLong(path, "max_sectors_kb");
+    dev->max_sectors_kb = value < 0 ? 0 : (unsigned int)value;
+    value = readDevLong(path, "read_ahead_kb");
+    dev->read_ahead_kb = (int)value;
+    char buf[256];
+    if (readDevLine(path, "scheduler", buf, sizeof(buf)) == 0)
+        parseScheduler(buf, dev->scheduler, sizeof(dev->scheduler));
+}
+
+typedef struct StorageDevices {
+    int count;
+    envuBlockDevice devices[MAX_STORAGE_DEVICES];
+} StorageDevices;
+
+static void addPhysicalDevice(StorageDevices *list, const char *dir) {
+    unsigned int major, minor;
+    if (readDevNumber(dir, &major, &minor) != 0)
+        return;
+    for (int i = 0; i < list->count; i++) {
+        if (list->devices[i].major == major && list->devices[i].minor == minor)
+            return;
+    }
+    if (list->count < MAX_STORAGE_DEVICES)
+        readBlockDevice(dir, dir, &list->devices[list->count++]);
+}
+
+// Follows partitions and slaves of device-mapper and md devices to physical devices.
+static void findPhysicalDevices(const char *dir, int depth, StorageDevices *list) {
+    if (depth > MAX_STACK_DEPTH)
+        return;
+    char next[PATH_MAX];
+    if (isPartition(dir)) {
+        if (resolveDevDir(dir, "..", next) == 0)
+            findPhysicalDevices(next, depth + 1, list);
+        return;
+    }
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/slaves", dir);
+    DIR *slaves = opendir(path);
+    int has_slaves = 0;
+    if (slaves != NULL) {
+        struct dirent *ent;
+        while ((ent = readdir(slaves)) != NULL) {
+            if (ent->d_name[0] == '.')
+                continue;
+            has_slaves = 1;
+            if (resolveDevDir(path, ent->d_name, next) == 0)
+                findPhysicalDevices(next, depth + 1, list);
+        }
+        closedir(slaves);
+    }
+    if (!has_slaves)
+        addPhysicalDevice(list, dir);
+}
+
+static const char *getTopType(const char *dir) {
+    char path[PATH_MAX];
+    if (isPartition(dir))
+        return "partition";
+    int len = snprintf(path, sizeof(path), "%s/dm", dir);
+    if (len < 0 || (size_t)len >= sizeof(path))
+        return "disk";
+    if (envuPathExists(path))
+        return "dm";
+    len = snprintf(path, sizeof(path), "%s/md", dir);
+    if (len < 0 || (size_t)len >= sizeof(path))
+        return "disk";
+    if (envuPathExists(path))
+        return "md";
+    return "disk";
+}
+
+// Scans /sys/class/block for a device number.
+// It's a fallback for kernels and sysroots without /sys/dev/block.
+static int findClassBlockDir(unsigned int major, unsigned int minor, char *out) {
+    char path[PATH_MAX];
+    if (envuGetSysPath("/sys/class/block", path, sizeof(path)) != 0)
+        return -1;
+    DIR *dir = opendir(path);
+    if (dir == NULL)
+        return -1;
+    int found = -1;
+    struct dirent *ent;
+    while (found != 0 && (ent = readdir(dir)) != NULL) {
+        unsigned int dev_major, dev_minor;
+        if (ent->d_name[0] == '.' || resolveDevDir(path, ent->d_name, out) != 0)
+            continue;
+        if (readDevNumber(out, &dev_major, &dev_minor) == 0 &&
+            dev_major == major && dev_minor == minor)
+            found = 0;
+    }
+    closedir(dir);
+    return found;
+}
+
+static envuStorageInfo *createStorageInfo(unsigned int major, unsigned int minor) {
+    char sys_path[64];
+    char link[PATH_MAX];
+    char dir[PATH_MAX];
+    snprintf(sys_path, sizeof(sys_path), "/sys/dev/block/%u:%u", major, minor);
+    if (envuGetSysPath(sys_path, link, sizeof(link)) != 0 || realpath(link, dir) == NULL) {
+        if (findClassBlockDir(major, minor, dir) != 0)
+            return NULL;
+    }
+
+    StorageDevices *list = calloc(1, sizeof(StorageDevices));
+    if (list == NULL)
+        return NULL;
+    findPhysicalDevices(dir, 0, list);
+
+    envuStorageInfo *info = calloc(1, sizeof(envuStorageInfo) +
+                                      list->count * sizeof(envuBlockDevice));
+    if (info == NULL) {
+        free(list);
+        return NULL;
+    }
+    const char *type = getTopType(dir);
+    snprintf(info->type, sizeof(info->type), "%s", type);
+    char disk_dir[PATH_MAX];
+    if (strcmp(type, "partition") != 0 || resolveDevDir(dir, "..", disk_dir) != 0)
+        snprintf(disk_dir, sizeof(disk_dir), "%s", dir);
+    readBlockDevice(dir, disk_dir, &info->top);
+
+    envuBlockDevice *devices = (envuBlockDevice *)(info + 1);
+    memcpy(devices, list->devices, list->count * sizeof(envuBlockDevice));
+    info->devices = devices;
+    info->device_count = list->count;
+    free(list);
+
+    info->rotational = info->device_count > 0 ? 0 : -1;
+    info->is_nvme = info->device_count > 0;
+    for (int i = 0; i < info->device_count; i++) {
+        if (devices[i].rotational == 1)
+            info->rotational = 1;
+        else if (devices[i].rotational < 0 && info->rotational == 0)
+            info->rotational = -1;
+        if (!devices[i].is_nvme)
+            info->is_nvme = 0;
+    }
+    return info;
+}
+
+typedef struct StorageCache {
+    unsigned int major;
+    unsigned int minor;
+    envuStorageInfo *info;  // NULL if the lookup failed.
+    struct StorageCache *next;
+} StorageCache;
+
+static StorageCache *storage_cache = NULL;
+static unsigned int storage_cache_gen = 0;
+static pthread_mutex_t storage_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+const envuStorageInfo *getStorageInfoForDeviceLinux(unsigned int major, unsigned int minor) {
+    unsigned int gen = envuGetSysRootGen();
+    pthread_mutex_lock(&storage_mutex);
+    if (storage_cache_gen != gen) {
+        // Note: Old entries are not freed because callers might still use them.
+        storage_cache = NULL;
+        storage_cache_gen = gen;
+    }
+    StorageCache *entry = storage_cache;
+    while (entry != NULL && (entry->major != major || entry->minor != minor))
+        entry = entry->next;
+    if (entry == NULL) {
+        // Failed lookups are cached as well. (e.g. files on tmpfs or overlayfs)
+        envuStorageInfo *info = createStorageInfo(major, minor);
+        entry = malloc(sizeof(StorageCache));
+        if (entry != NULL) {
+            entry->major = major;
+            entry->minor = minor;
+            entry->info = info;
+            entry->next = storage_cache;
+            storage_cache = entry;
+        } else {
+            free(info);
+        }
+    }
+    const envuStorageInfo *info = entry != NULL ? entry->info : NULL;
+    pthread_mutex_unlock(&storage_mutex);
+    return info;
+}
+
+const envuStorageInfo *getStorageInfoLinux(const char *path) {
+    struct stat st;
+    if (path == NULL || stat(path, &st) != 0)
+        return NULL;
+    return getStorageInfoForDeviceLinux(major(st.st_dev), minor(st.st_dev));
+}
+
+typedef struct FsTypeEntry {
+    uint64_t magic;
+    envuFsType type;
+    envuFsClass fs_class;
+} FsTypeEntry;
+
+// Magic numbers from linux/magic.h
+static const FsTypeEntry fs_types[] = {
+    { 0xEF53, ENVU_FS_EXT4, ENVU_FS_CLASS_DISK },
+    { 0x58465342, ENVU_FS_XFS, ENVU_FS_CLASS_DISK },
+    { 0x9123683E, ENVU_FS_BTRFS, ENVU_FS_CLASS_DISK },
+    { 0x01021994, ENVU_FS_TMPFS, ENVU_FS_CLASS_MEMORY },
+    { 0x794C7630, ENVU_FS_OVERLAYFS, ENVU_FS_CLASS_DISK },
+    { 0x6969, ENVU_FS_NFS, ENVU_FS_CLASS_NETWORK },
+    { 0x65735546, ENVU_FS_FUSE, ENVU_FS_CLASS_NETWORK },
+    // Types that envuFsType doesn't have. (ramfs, cifs, smb2, and ceph)
+    { 0x858458F6, ENVU_FS_UNKNOWN, ENVU_FS_CLASS_MEMORY },
+    { 0xFF534D42, ENVU_FS_UNKNOWN, ENVU_FS_CLASS_NETWORK },
+    { 0xFE534D42, ENVU_FS_UNKNOWN, ENVU_FS_CLASS_NETWORK },
+    { 0x00C36400, ENVU_FS_UNKNOWN, ENVU_FS_CLASS_NETWORK },
+};
+
+static const char *fs_type_names[] = {
+    "unknown", "ext4", "xfs", "btrfs", "tmpfs", "overlayfs", "nfs", "fuse",
+};
+
+static envuFsType getFsType(uint64_t magic) {
+    for (size_t i = 0; i < sizeof(fs_types) / sizeof(fs_types[0]); i++) {
+        if (fs_types[i].magic == magic)
+            return fs_types[i].type;
+    }
+    return ENVU_FS_UNKNOWN;
+}
+
+envuFsClass getFsClassLinux(uint64_t magic) {
+    for (size_t i = 0; i < sizeof(fs_types) / sizeof(fs_types[0]); i++) {
+        if (fs_types[i].magic == magic)
+            return fs_types[i].fs_class;
+    }
+    return ENVU_FS_CLASS_DISK;
+}
+
+static unsigned int getMountFlags(unsigned long f_flag) {
+    unsigned int flags = 0;
+    if (f_flag & ST_RDONLY)
+        flags |= ENVU_MOUNT_RDONLY;
+    if (f_flag & ST_NOSUID)
+        flags |= ENVU_MOUNT_NOSUID;
+#ifdef ST_NODEV
+    if (f_flag & ST_NODEV)
+        flags |= ENVU_MOUNT_NODEV;
+    if (f_flag & ST_NOEXEC)
+        flags |= ENVU_MOUNT_NOEXEC;
+    if (f_flag & ST_SYNCHRONOUS)
+        flags |= ENVU_MOUNT_SYNCHRONOUS;
+    if (f_flag & ST_NOATIME)
+        flags |= ENVU_MOUNT_NOATIME;
+    if (f_flag & ST_NODIRATIME)
+        flags |= ENVU_MOUNT_NODIRATIME;
+    if (f_flag & ST_RELATIME)
+        flags |= ENVU_MOUNT_RELATIME;
+#endif
+    return flags;
+}
+
+// Results of probes in a temporary file.
+typedef struct FsProbe {
+    int o_direct;
+    int reflink;
+    int copy_file_range;
+    int sparse_files;
+    unsigned int fallocate_modes;
+} FsProbe;
+
+// Creates an unnamed file in a directory.
+static int openProbeFile(const char *dir) {
+#ifdef O_TMPFILE
+    int fd = open(dir, O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+    if (fd != -1)
+        return fd;
+#endif
+    // Some filesystems (e.g. NFS and old FUSE) don't support O_TMPFILE.
+    char path[PATH_MAX];
+    int len = snprintf(path, sizeof(path), "%s/.envu_probe_XXXXXX", dir);
+    if (len < 0 || (size_t)len >= sizeof(path))
+        return -1;
+    int tmp_fd = mkostemp(path, O_CLOEXEC);
+    if (tmp_fd != -1)
+        unlink(path);
+    return tmp_fd;
+}
+
+static int probeODirect(int fd, size_t block_size) {
+    int flags = fcntl(fd, F_GETFL);
+    if (flags == -1 || fcntl(fd, F_SETFL, flags | O_DIRECT) != 0)
+        return 0;
+    void *buf = NULL;
+    ssize_t ret = -1;
+    if (posix_memalign(&buf, block_size, block_size) == 0) {
+        memset(buf, 0, block_size);
+        ret = pwrite(fd, buf, block_size, 0);
+        free(buf);
+    }
+    fcntl(fd, F_SETFL, flags);
+    return ret == (ssize_t)block_size;
+}
+
+static int probeSparseFiles(int fd) {
+    struct stat st;
+    if (ftruncate(fd, 0) != 0 || pwrite(fd, "", 1, SPARSE_PROBE_OFFSET) != 1 ||
+        fstat(fd, &st) != 0)
+        return 0;
+    return (uint64_t)st.st_blocks * 512 < SPARSE_PROBE_OFFSET;
+}
+
+// Tries each mode on a file with 4 blocks.
+static unsigned int probeFallocate(int fd, off_t block_size) {
+    unsigned int modes = 0;
+    if (ftruncate(fd, 0) != 0)
+        return 0;
+    if (fallocate(fd, 0, 0, block_size * 4) == 0)
+        modes |= ENVU_FALLOC_DEFAULT;
+    if (ftruncate(fd, block_size * 4) != 0)
+        return modes;
+    if (fallocate(fd, FALLOC_FL_KEEP_SIZE, block_size * 4, block_size) == 0)
+        modes |= ENVU_FALLOC_KEEP_SIZE;
+    if (fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, block_size, block_size) == 0)
+        modes |= ENVU_FALLOC_PUNCH_HOLE;
+    if (fallocate(fd, FALLOC_FL_ZERO_RANGE, block_size, block_size) == 0)
+        modes |= ENVU_FALLOC_ZERO_RANGE;
+    // The offset and the length should be multiples of the block size.
+    if (fallocate(fd, FALLOC_FL_COLLAPSE_RANGE, block_size, block_size) == 0)
+        modes |= ENVU_FALLOC_COLLAPSE_RANGE;
+    if (fallocate(fd, FALLOC_FL_INSERT_RANGE, block_size, block_size) == 0)
+        modes |= ENVU_FALLOC_INSERT_RANGE;
+    return modes;
+}
+
+// Copies a block from src to a new file with FICLONE and copy_file_range().
+static void probeCopy(int src, const char *dir, off_t block_size, FsProbe *probe) {
+    probe->reflink = 0;
+    probe->copy_file_range = 0;
+    int dst = openProbeFile(dir);
+    if (dst == -1)
+        return;
+    if (ftruncate(src, block_size) == 0) {
+#ifdef FICLONE
+        probe->reflink = ioctl(dst, FICLONE, src) == 0;
+#endif
+#ifdef SYS_copy_file_range
+        loff_t off_in = 0;
+        loff_t off_out = 0;
+        if (ftruncate(dst, 0) == 0)
+            probe->copy_file_range = syscall(SYS_copy_file_range, src, &off_in, dst, &off_out,
+                                             (size_t)block_size, 0) > 0;
+#endif
+    }
+    close(dst);
+}
+
+static int probeFs(const char *dir, size_t block_size, FsProbe *probe) {
+    int fd = openProbeFile(dir);
+    if (fd == -1)
+        return -1;
+    // O_DIRECT needs buffers aligned to the logical block size of the device.
+    if (block_size < 4096)
+        block_size = 4096;
+    probe->o_direct = probeODirect(fd, block_size);
+    probe->sparse_files = probeSparseFiles(fd);
+    probe->fallocate_modes = probeFallocate(fd, (off_t)block_size);
+    probeCopy(fd, dir, (off_t)block_size, probe);
+    close(fd);
+    return 0;
+}
+
+typedef struct FsProbeCache {
+    dev_t dev;
+    uint64_t fs_id;
+    FsProbe probe;
+    struct FsProbeCache *next;
+} FsProbeCache;
+
+static FsProbeCache *fs_probe_cache = NULL;
+static pthread_mutex_t fs_probe_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Gets cached probe results, or probes the filesystem in dir.
+static int getFsProbe(dev_t dev, uint64_t fs_id, const char *dir, size_t block_size,
+                      FsProbe *out) {
+    pthread_mutex_lock(&fs_probe_mutex);
+    FsProbeCache *entry = fs_probe_cache;
+    while (entry != NULL && (entry->dev != dev || entry->fs_id != fs_id))
+        entry = entry->next;
+    int ret = 0;
+    if (entry != NULL) {
+        *out = entry->probe;
+    } else {
+        // Failures are not cached because other directories in the filesystem can be writable.
+        ret = probeFs(dir, block_size, out);
+        entry = ret == 0 ? malloc(sizeof(FsProbeCache)) : NULL;
+        if (entry != NULL) {
+            entry->dev = dev;
+            entry->fs_id = fs_id;
+            entry->probe = *out;
+            entry->next = fs_probe_cache;
+            fs_probe_cache = entry;
+        }
+    }
+    pthread_mutex_unlock(&fs_probe_mutex);
+    return ret;
+}
+
+int getFsCapabilitiesLinux(const char *path, envuFsCapabilities *out) {
+    struct stat st;
+    struct statfs sfs;
+    struct statvfs svfs;
+    if (path == NULL || out == NULL || stat(path, &st) != 0 || statfs(path, &sfs) != 0 ||
+        statvfs(path, &svfs) != 0)
+        return -1;
+    memset(out, 0, sizeof(*out));
+    out->fs_magic = (uint64_t)(unsigned long)sfs.f_type;
+    out->type = getFsType(out->fs_magic);
+    out->type_name = fs_type_names[out->type];
+    int fsid[2];
+    memcpy(fsid, &sfs.f_fsid, sizeof(fsid));
+    out->fs_id = (uint64_t)(uint32_t)fsid[0] | (uint64_t)(uint32_t)fsid[1] << 32;
+    out->block_size = (uint64_t)sfs.f_bsize;
+    out->total_bytes = (uint64_t)svfs.f_blocks * svfs.f_frsize;
+    out->free_bytes = (uint64_t)svfs.f_bfree * svfs.f_frsize;
+    out->available_bytes = (uint64_t)svfs.f_bavail * svfs.f_frsize;
+    out->mount_flags = getMountFlags(svfs.f_flag);
+
+    out->o_direct = out->reflink = out->copy_file_range = out->sparse_files = -1;
+    if (out->mount_flags & ENVU_MOUNT_RDONLY)
+        return 0;
+    // Probe files are created in the directory of the path.
+    char dir[PATH_MAX];
+    if (S_ISDIR(st.st_mode)) {
+        snprintf(dir, sizeof(dir), "%s", path);
+    } else {
+        const char *slash = strrchr(path, '/');
+        if (slash == NULL)
+            snprintf(dir, sizeof(dir), ".");
+        else if (slash == path)
+            snprintf(dir, sizeof(dir), "/");
+        else
+            snprintf(dir, sizeof(dir), "%.*s", (int)(slash - path), path);
+    }
+    FsProbe probe;
+    if (getFsProbe(st.st_dev, out->fs_id, dir, out->block_size, &probe) != 0)
+        return 0;
+    out->probed = 1;
+    out->o_direct = probe.o_direct;
+    out->reflink = probe.reflink;
+    out->copy_file_range = probe.copy_file_range;
+    out->sparse_files = probe.sparse_files;
+    out->fallocate_modes = probe.fallocate_modes;
+    return 0;
+}
+
+// A node of the trie over mount points. Children are linked with sibling indices.
+typedef struct MountNode {
+    const char *name;
+    size_t name_len;
+    int child;
+    int sibling;
+    int first_mount;  // -1 if nothing is mounted on the node.
+} MountNode;
+
+typedef struct MountTable {
+    char *buf;  // The content of mountinfo. Strings in mounts point to it.
+    int mount_count;
+    envuMount *mounts;
+    int *next_mounts;  // The next mount on the same node. -1 for the last one.
+    int node_count;
+    int node_capacity;
+    MountNode *nodes;
+} MountTable;
+
+// Reads the whole file from the beginning.
+static char *readMountinfo(int fd) {
+    if (lseek(fd, 0, SEEK_SET) != 0)
+        return NULL;
+    size_t capacity = 16384;
+    size_t total = 0;
+    char *buf = malloc(capacity);
+    while (buf != NULL) {
+        if (total + 1 >= capacity) {
+            char *new_buf = realloc(buf, capacity * 2);
+            if (new_buf == NULL) {
+                free(buf);
+                return NULL;
+            }
+            buf = new_buf;
+            capacity *= 2;
+        }
+        ssize_t ret = read(fd, buf + total, capacity - 1 - total);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            break;
+        total += (size_t)ret;
+    }
+    if (buf != NULL)
+        buf[total] = '\0';
+    return buf;
+}
+
+// Decodes octal escapes in mountinfo. e.g. "\040" for spaces
+static void unescapeMountinfo(char *str) {
+    char *out = str;
+    for (char *p = str; *p != '\0'; p++) {
+        if (p[0] == '\\' && p[1] >= '0' && p[1] <= '3' && p[2] >= '0' && p[2] <= '7' &&
+            p[3] >= '0' && p[3] <= '7') {
+            *out++ = (char)((p[1] - '0') * 64 + (p[2] - '0') * 8 + (p[3] - '0'));
+            p += 3;
+        } else {
+            *out++ = *p;
+        }
+    }
+    *out = '\0';
+}
+
+// Parses optional fields. e.g. "shared:1 master:2"
+static void parsePropagation(char *optional, envuMount *mount) {
+    char *saveptr;
+    for (char *tag = strtok_r(optional, " ", &saveptr); tag != NULL;
+         tag = strtok_r(NULL, " ", &saveptr)) {
+        if (strncmp(tag, "shared:", 7) == 0) {
+            mount->propagation |= ENVU_PROPAGATION_SHARED;
+            mount->peer_group = atoi(tag + 7);
+        } else if (strncmp(tag, "master:", 7) == 0) {
+            mount->propagation |= ENVU_PROPAGATION_SLAVE;
+            mount->master = atoi(tag + 7);
+        } else if (strcmp(tag, "unbindable") == 0) {
+            mount->propagation |= ENVU_PROPAGATION_UNBINDABLE;
+        }
+    }
+}
+
+static int parseMount(char *line, envuMount *mount) {
+    envuMountinfoFields fields;
+    if (envuParseMountinfoLine(line, &fields) != 0)
+        return -1;
+    memset(mount, 0, sizeof(*mount));
+    mount->mount_id = atoi(fields.mount_id);
+    mount->parent_id = atoi(fields.parent_id);
+    if (sscanf(fields.dev, "%u:%u", &mount->major, &mount->minor) != 2)
+        return -1;
+    unescapeMountinfo(fields.root);
+    unescapeMountinfo(fields.mount_point);
+    unescapeMountinfo(fields.source);
+    mount->root = fields.root;
+    mount->mount_point = fields.mount_point;
+    mount->fstype = fields.fstype;
+    mount->source = fields.source;
+    mount->options = fields.options;
+    mount->super_options = fields.super_options;
+    parsePropagation(fields.optional, mount);
+    return 0;
+}
+
+static int findChildNode(const MountTable *table, int node, const char *name, size_t len) {
+    for (int i = table->nodes[node].child; i != -1; i = table->nodes[i].sibling) {
+        if (table->nodes[i].name_len == len && memcmp(table->nodes[i].name, name, len) == 0)
+            return i;
+    }
+    return -1;
+}
+
+static void insertMount(MountTable *table, int index) {
+    int node = 0;
+    const char *p = table->mounts[index].mount_point;
+    while (*p != '\0') {
+        while (*p == '/')
+            p++;
+        if (*p == '\0')
+            break;
+        const char *end = strchrnul(p, '/');
+        size_t len = (size_t)(end - p);
+        int child = findChildNode(table, node, p, len);
+        if (child == -1) {
+            if (table->node_count >= table->node_capacity)
+                return;
+            child = table->node_count++;
+            MountNode *new_node = &table->nodes[child];
+            new_node->name = p;
+            new_node->name_len = len;
+            new_node->child = -1;
+            new_node->first_mount = -1;
+            new_node->sibling = table->nodes[node].child;
+            table->nodes[node].child = child;
+        }
+        node = child;
+        p = end;
+    }
+    // Keep the order of mountinfo for mounts on the same node.
+    table->next_mounts[index] = -1;
+    int *last = &table->nodes[node].first_mount;
+    while (*last != -1)
+        last = &table->next_mounts[*last];
+    *last = index;
+}
+
+static void freeMountTable(MountTable *table) {
+    if (table == NULL)
+        return;
+    free(table->buf);
+    free(table->mounts);
+    free(table->next_mounts);
+    free(table->nodes);
+    free(table);
+}
+
+static MountTable *createMountTable(int fd) {
+    MountTable *table = calloc(1, sizeof(MountTable));
+    if (table == NULL)
+        return NULL;
+    table->buf = readMountinfo(fd);
+    if (table->buf == NULL) {
+        free(table);
+        return NULL;
+    }
+    // Each line has a mount, and each component of a mount point follows a slash.
+    int line_count = 1;
+    int slash_count = 1;
+    for (const char *p = table->buf; *p != '\0'; p++) {
+        line_count += *p == '\n';
+        slash_count += *p == '/';
+    }
+    table->node_capacity = slash_count;
+    table->mounts = malloc(line_count * sizeof(envuMount));
+    table->next_mounts = malloc(line_count * sizeof(int));
+    table->nodes = malloc(slash_count * sizeof(MountNode));
+    if (table->mounts == NULL || table->next_mounts == NULL || table->nodes == NULL) {
+        freeMountTable(table);
+        return NULL;
+    }
+    table->node_count = 1;
+    table->nodes[0] = (MountNode){ "", 0, -1, -1, -1 };
+    char *saveptr;
+    for (char *line = strtok_r(table->buf, "\n", &saveptr); line != NULL;
+         line = strtok_r(NULL, "\n", &saveptr)) {
+        if (parseMount(line, &table->mounts[table->mount_count]) != 0)
+            continue;
+        insertMount(table, table->mount_count);
+        table->mount_count++;
+    }
+    return table;
+}
+
+static int hasMountId(const MountTable *table, const MountNode *node, int mount_id) {
+    for (int m = node->first_mount; m != -1; m = table->next_mounts[m]) {
+        if (table->mounts[m].mount_id == mount_id)
+            return 1;
+    }
+    return 0;
+}
+
+// Picks the visible mount on a node.
+// parent is the visible mount above the node, or -1 for the root node.
+static int pickMount(const MountTable *table, const MountNode *node, int parent) {
+    int chosen = -1;
+    for (int m = node->first_mount; m != -1; m = table->next_mounts[m]) {
+        int parent_id = table->mounts[m].parent_id;
+        if ((parent < 0 && !hasMountId(table, node, parent_id)) ||
+            (parent >= 0 && parent_id == table->mounts[parent].mount_id)) {
+            chosen = m;
+            break;
+        }
+    }
+    // Mounts under over-mounted directories are hidden.
+    if (chosen == -1)
+        return parent < 0 ? node->first_mount : -1;
+    // Mounts on the same mount point are stacked. The last one is visible.
+    for (int i = 0; i < table->mount_count; i++) {
+        int upper = -1;
+        for (int m = node->first_mount; m != -1; m = table->next_mounts[m]) {
+            if (m != chosen && table->mounts[m].parent_id == table->mounts[chosen].mount_id) {
+                upper = m;
+                break;
+            }
+        }
+        if (upper == -1)
+            break;
+        chosen = upper;
+    }
+    return chosen;
+}
+
+// Walks the trie along a full path and returns the deepest visible mount.
+static int findMount(const MountTable *table, const char *path) {
+    int node = 0;
+    int mount = pickMount(table, &table->nodes[0], -1);
+    const char *p = path;
+    while (*p != '\0') {
+        while (*p == '/')
+            p++;
+        if (*p == '\0')
+            break;
+        const char *end = strchrnul(p, '/');
+        node = findChildNode(table, node, p, (size_t)(end - p));
+        if (node == -1)
+            break;
+        if (table->nodes[node].first_mount != -1) {
+            int child_mount = pickMount(table, &table->nodes[node], mount);
+            if (child_mount != -1)
+                mount = child_mount;
+        }
+        p = end;
+    }
+    return mount;
+}
+
+// Copies a mount and its strings into a single block.
+static envuMount *copyMount(const envuMount *mount) {
+    const char *strs[6] = { mount->root, mount->mount_point, mount->fstype, mount->source,
+                            mount->options, mount->super_options };
+    size_t size = sizeof(envuMount);
+    for (int i = 0; i < 6; i++)
+        size += strlen(strs[i]) + 1;
+    envuMount *out = malloc(size);
+    if (out == NULL)
+        return NULL;
+    *out = *mount;
+    char *str = (char *)(out + 1);
+    const char **fields[6] = { &out->root, &out->mount_point, &out->fstype, &out->source,
+                               &out->options, &out->super_options };
+    for (int i = 0; i < 6; i++) {
+        size_t len = strlen(strs[i]) + 1;
+        memcpy(str, strs[i], len);
+        *fields[i] = str;
+        str += len;
+    }
+    return out;
+}
+
+static MountTable *mount_table = NULL;
+static int mountinfo_fd = -1;
+static pid_t mountinfo_pid = 0;
+static unsigned int mount_table_gen = 0;
+static pthread_mutex_t mount_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Checks if the mount table should be rebuilt.
+static int isMountTableStale(void) {
+    unsigned int gen = envuGetSysRootGen();
+    pid_t pid = getpid();
+    if (mountinfo_fd == -1 || mount_table_gen != gen || mountinfo_pid != pid) {
+        // /proc/self is resolved on open, so forked processes need their own fd.
+        if (mountinfo_fd != -1)
+            close(mountinfo_fd);
+        char path[PATH_MAX];
+        mountinfo_fd = -1;
+        if (envuGetSysPath("/proc/self/mountinfo", path, sizeof(path)) == 0)
+            mountinfo_fd = open(path, O_RDONLY | O_CLOEXEC);
+        mount_table_gen = gen;
+        mountinfo_pid = pid;
+        return 1;
+    }
+    if (mount_table == NULL)
+        return 1;
+    // The kernel reports POLLPRI and POLLERR when the mount namespace changes.
+    struct pollfd pfd = { mountinfo_fd, POLLPRI, 0 };
+    return poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLPRI | POLLERR));
+}
+
+envuMount *getMountForPathLinux(const char *path) {
+    char *full_path = envuGetFullPath(path);
+    if (full_path == NULL)
+        return NULL;
+    envuMount *mount = NULL;
+    pthread_mutex_lock(&mount_mutex);
+    if (isMountTableStale()) {
+        // Old tables can be freed because callers get copies.
+        freeMountTable(mount_table);
+        mount_table = mountinfo_fd != -1 ? createMountTable(mountinfo_fd) : NULL;
+    }
+    if (mount_table != NULL) {
+        int index = findMount(mount_table, full_path);
+        if (index >= 0)
+            mount = copyMount(&mount_table->mounts[index]);
+    }
+    pthread_mutex_unlock(&mount_mutex);
+    envuFree(full_path);
+    return mount;
+}
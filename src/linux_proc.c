@@ -0,0 +1,854 @@
+#define _GNU_SOURCE
+
+#include <sys/stat.h>
+#include <sys/statfs.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "env_utils.h"
+#include "env_utils_priv.h"
+
+#ifndef PROC_SUPER_MAGIC
+#define PROC_SUPER_MAGIC 0x9fa0
+#endif
+
+struct envuSampler {
+    int stat_fd;
+    int status_fd;
+    int fd_dir_fd;
+    int own_fd_count;  // The number of file descriptors that the sampler keeps open.
+    int is_self;
+    int is_procfs;
+    uint64_t ns_per_tick;
+    uint64_t page_size;
+    char *buf;
+    size_t buf_size;
+    int has_prev;
+    envuProcessSample prev;
+};
+
+// Reads a whole file into the buffer of the sampler.
+// The buffer only grows when a file doesn't fit in it.
+static ssize_t preadAll(envuSampler *sampler, int fd) {
+    while (1) {
+        ssize_t len;
+        do {
+            len = pread(fd, sampler->buf, sampler->buf_size - 1, 0);
+        } while (len < 0 && errno == EINTR);
+        if (len < 0)
+            return -1;
+        if ((size_t)len < sampler->buf_size - 1) {
+            sampler->buf[len] = '\0';
+            return len;
+        }
+        char *buf = realloc(sampler->buf, sampler->buf_size * 2);
+        if (buf == NULL)
+            return -1;
+        sampler->buf = buf;
+        sampler->buf_size *= 2;
+    }
+}
+
+static uint64_t scanU64(const char **p) {
+    uint64_t value = 0;
+    const char *s = *p;
+    while (*s >= '0' && *s <= '9')
+        value = value * 10 + (uint64_t)(*s++ - '0');
+    *p = s;
+    return value;
+}
+
+static const char *skipFields(const char *p, int count) {
+    for (int i = 0; i < count; i++) {
+        while (*p == ' ')
+            p++;
+        while (*p != ' ' && *p != '\0')
+            p++;
+    }
+    while (*p == ' ')
+        p++;
+    return p;
+}
+
+// Parses /proc/[pid]/stat.
+// The second field is the command name in parentheses, which can contain spaces and parentheses.
+static int parseStat(const envuSampler *sampler, const char *buf, envuProcessSample *out) {
+    const char *p = strrchr(buf, ')');
+    if (p == NULL)
+        return -1;
+    // Fields after ")" start with the 3rd field. (state)
+    // After scanning the n-th field, skipping (m - n - 1) fields moves to the m-th field.
+    p = skipFields(p + 1, 10 - 3);
+    out->total.minor_faults = scanU64(&p);
+    p = skipFields(p, 12 - 10 - 1);
+    out->total.major_faults = scanU64(&p);
+    p = skipFields(p, 14 - 12 - 1);
+    out->total.user_ns = scanU64(&p) * sampler->ns_per_tick;
+    p = skipFields(p, 15 - 14 - 1);
+    out->total.system_ns = scanU64(&p) * sampler->ns_per_tick;
+    p = skipFields(p, 20 - 15 - 1);
+    out->thread_count = (int)scanU64(&p);
+    p = skipFields(p, 24 - 20 - 1);
+    if (*p < '0' || *p > '9')
+        return -1;
+    out->rss = scanU64(&p) * sampler->page_size;
+    return 0;
+}
+
+static int hasKey(const char *line, const char *key, size_t len, const char **value) {
+    if (strncmp(line, key, len) != 0)
+        return 0;
+    const char *p = line + len;
+    while (*p == ' ' || *p == '\t')
+        p++;
+    *value = p;
+    return 1;
+}
+
+// Parses context switches in /proc/[pid]/status.
+static void parseStatus(const char *buf, envuProcessSample *out) {
+    const char *line = buf;
+    while (line != NULL && *line != '\0') {
+        const char *value;
+        if (hasKey(line, "voluntary_ctxt_switches:", 24, &value))
+            out->total.voluntary_switches = scanU64(&value);
+        else if (hasKey(line, "nonvoluntary_ctxt_switches:", 27, &value))
+            out->total.involuntary_switches = scanU64(&value);
+        line = strchr(line, '\n');
+        if (line != NULL)
+            line++;
+    }
+}
+
+static int countFds(envuSampler *sampler) {
+    if (sampler->is_procfs) {
+        // Since Linux 6.2, the size of /proc/[pid]/fd is the number of open files.
+        struct stat st;
+        if (fstat(sampler->fd_dir_fd, &st) == 0 && st.st_size > 0)
+            return (int)st.st_size;
+    }
+    if (lseek(sampler->fd_dir_fd, 0, SEEK_SET) != 0)
+        return -1;
+    int count = 0;
+    while (1) {
+        long len = syscall(SYS_getdents64, sampler->fd_dir_fd, sampler->buf, sampler->buf_size);
+        if (len < 0)
+            return -1;
+        if (len == 0)
+            break;
+        // linux_dirent64 has d_ino (8), d_off (8), d_reclen (2), d_type (1), and d_name.
+        for (long pos = 0; pos < len;) {
+            const char *ent = sampler->buf + pos;
+            unsigned short reclen;
+            memcpy(&reclen, ent + 16, sizeof(reclen));
+            if (ent[19] != '.')
+                count++;
+            pos += reclen;
+        }
+    }
+    return count;
+}
+
+static void closeFd(int fd) {
+    if (fd != -1)
+        close(fd);
+}
+
+envuSampler *openSamplerLinux(int pid) {
+    if (pid < 0)
+        return NULL;
+    char proc_path[64];
+    if (pid == 0)
+        snprintf(proc_path, sizeof(proc_path), "/proc/self");
+    else
+        snprintf(proc_path, sizeof(proc_path), "/proc/%d", pid);
+    char path[PATH_MAX];
+    if (envuGetSysPath(proc_path, path, sizeof(path)) != 0)
+        return NULL;
+    int dir_fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd == -1)
+        return NULL;
+
+    envuSampler *sampler = calloc(1, sizeof(envuSampler));
+    if (sampler == NULL) {
+        close(dir_fd);
+        return NULL;
+    }
+    sampler->stat_fd = openat(dir_fd, "stat", O_RDONLY | O_CLOEXEC);
+    sampler->status_fd = openat(dir_fd, "status", O_RDONLY | O_CLOEXEC);
+    sampler->fd_dir_fd = openat(dir_fd, "fd", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    sampler->own_fd_count = (sampler->stat_fd != -1) + (sampler->status_fd != -1) +
+                            (sampler->fd_dir_fd != -1);
+    struct statfs fs;
+    sampler->is_procfs = fstatfs(dir_fd, &fs) == 0 && fs.f_type == PROC_SUPER_MAGIC;
+    close(dir_fd);
+    // The sampler's own descriptors are only visible in the real /proc/self/fd.
+    sampler->is_self = sampler->is_procfs && (pid == 0 || pid == getpid());
+    long ticks = sysconf(_SC_CLK_TCK);
+    long page_size = sysconf(_SC_PAGESIZE);
+    sampler->ns_per_tick = ticks > 0 ? 1000000000ULL / (uint64_t)ticks : 10000000ULL;
+    sampler->page_size = page_size > 0 ? (uint64_t)page_size : 4096;
+    // status is about 1.5 KiB. It gets larger with many CPUs or NUMA nodes.
+    sampler->buf_size = 4096;
+    sampler->buf = malloc(sampler->buf_size);
+    if (sampler->stat_fd == -1 || sampler->buf == NULL) {
+        closeSamplerLinux(sampler);
+        return NULL;
+    }
+    return sampler;
+}
+
+int sampleLinux(envuSampler *sampler, envuProcessSample *out) {
+    if (out == NULL)
+        return -1;
+    memset(out, 0, sizeof(*out));
+    if (sampler == NULL)
+        return -1;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    out->timestamp_ns = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+    if (preadAll(sampler, sampler->stat_fd) <= 0 || parseStat(sampler, sampler->buf, out) != 0)
+        return -1;
+    if (sampler->status_fd != -1 && preadAll(sampler, sampler->status_fd) > 0)
+        parseStatus(sampler->buf, out);
+    out->fd_count = sampler->fd_dir_fd != -1 ? countFds(sampler) : -1;
+    if (out->fd_count >= sampler->own_fd_count && sampler->is_self)
+        out->fd_count -= sampler->own_fd_count;
+
+    if (sampler->has_prev) {
+        const envuProcessSample *prev = &sampler->prev;
+        out->elapsed_ns = out->timestamp_ns - prev->timestamp_ns;
+        out->delta_rss = (int64_t)(out->rss - prev->rss);
+        const uint64_t *cur = (const uint64_t *)&out->total;
+        const uint64_t *old = (const uint64_t *)&prev->total;
+        uint64_t *delta = (uint64_t *)&out->delta;
+        for (size_t i = 0; i < sizeof(envuProcessCounters) / sizeof(uint64_t); i++)
+            delta[i] = cur[i] >= old[i] ? cur[i] - old[i] : 0;
+        if (out->elapsed_ns > 0)
+            out->cpu_usage = (double)(out->delta.user_ns + out->delta.system_ns) /
+                             (double)out->elapsed_ns;
+    }
+    sampler->prev = *out;
+    sampler->has_prev = 1;
+    return 0;
+}
+
+void closeSamplerLinux(envuSampler *sampler) {
+    if (sampler == NULL)
+        return;
+    closeFd(sampler->stat_fd);
+    closeFd(sampler->status_fd);
+    closeFd(sampler->fd_dir_fd);
+    free(sampler->buf);
+    free(sampler);
+}
+
+// Indexes of strings in a process entry
+#define STR_COMM 0
+#define STR_EXE 1
+#define STR_CMDLINE 2
+#define STR_CGROUP 3
+#define STR_ENV 4
+#define STR_MAX (STR_ENV + ENVU_MAX_PROCESS_ENV)
+
+// A process entry that a worker found.
+// Strings are stored in the buffer of the worker and present ones are marked in str_mask.
+typedef struct ProcEntry {
+    envuProcess proc;
+    int worker;
+    size_t str_offset;
+    uint64_t str_mask;
+    // Strings except comm are copied from this process of the previous snapshot.
+    const envuProcess *reused;
+} ProcEntry;
+
+typedef struct ProcScan ProcScan;
+
+typedef struct ProcWorker {
+    ProcScan *scan;
+    int index;
+    int failed;
+    ProcEntry *entries;
+    size_t entry_count;
+    size_t entry_capacity;
+    char *strs;
+    size_t str_len;
+    size_t str_capacity;
+    char *buf;
+    size_t buf_size;
+} ProcWorker;
+
+struct ProcScan {
+    int proc_fd;
+    unsigned int fields;
+    const envuProcessFilter *filter;
+    const envuProcessSnapshot *prev;
+    // Processes of prev sorted by pid
+    const envuProcess **prev_procs;
+    int *pids;
+    int pid_count;
+    int next;
+};
+
+static int growArray(void **array, size_t *capacity, size_t count, size_t item_size) {
+    if (count < *capacity)
+        return 0;
+    size_t new_capacity = *capacity > 0 ? *capacity * 2 : 64;
+    void *p = realloc(*array, new_capacity * item_size);
+    if (p == NULL)
+        return -1;
+    *array = p;
+    *capacity = new_capacity;
+    return 0;
+}
+
+static int pushStr(ProcWorker *w, const char *str, size_t len) {
+    size_t capacity = w->str_capacity;
+    while (w->str_len + len + 1 > capacity)
+        capacity = capacity > 0 ? capacity * 2 : 4096;
+    if (capacity != w->str_capacity) {
+        char *strs = realloc(w->strs, capacity);
+        if (strs == NULL)
+            return -1;
+        w->strs = strs;
+        w->str_capacity = capacity;
+    }
+    memcpy(w->strs + w->str_len, str, len);
+    w->strs[w->str_len + len] = '\0';
+    w->str_len += len + 1;
+    return 0;
+}
+
+// Reads a file relative to /proc into the buffer of the worker.
+static ssize_t readProcFile(ProcWorker *w, const char *path) {
+    int fd = openat(w->scan->proc_fd, path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return -1;
+    size_t total = 0;
+    while (1) {
+        if (total + 1 >= w->buf_size) {
+            char *buf = realloc(w->buf, w->buf_size * 2);
+            if (buf == NULL) {
+                close(fd);
+                return -1;
+            }
+            w->buf = buf;
+            w->buf_size *= 2;
+        }
+        ssize_t len = read(fd, w->buf + total, w->buf_size - 1 - total);
+        if (len < 0 && errno == EINTR)
+            continue;
+        if (len < 0) {
+            close(fd);
+            return -1;
+        }
+        if (len == 0)
+            break;
+        total += (size_t)len;
+    }
+    close(fd);
+    w->buf[total] = '\0';
+    return (ssize_t)total;
+}
+
+// Parses comm, state, ppid, and start time in /proc/[pid]/stat.
+static int parseProcStat(const char *buf, envuProcess *proc, const char **comm, size_t *comm_len) {
+    const char *open = strchr(buf, '(');
+    const char *close = strrchr(buf, ')');
+    if (open == NULL || close == NULL || close < open)
+        return -1;
+    *comm = open + 1;
+    *comm_len = (size_t)(close - open - 1);
+    const char *p = close + 1;
+    while (*p == ' ')
+        p++;
+    proc->state = *p;
+    p = skipFields(p, 1);
+    proc->ppid = (int)scanU64(&p);
+    p = skipFields(p, 22 - 4 - 1);
+    if (*p < '0' || *p > '9')
+        return -1;
+    proc->start_time = scanU64(&p);
+    return 0;
+}
+
+static const envuProcess *findPrevProcess(const ProcScan *scan, int pid, uint64_t start_time) {
+    if (scan->prev_procs == NULL)
+        return NULL;
+    int low = 0;
+    int high = scan->prev->count - 1;
+    while (low <= high) {
+        int mid = (low + high) / 2;
+        const envuProcess *proc = scan->prev_procs[mid];
+        if (proc->pid == pid)
+            return proc->start_time == start_time ? proc : NULL;
+        if (proc->pid < pid)
+            low = mid + 1;
+        else
+            high = mid - 1;
+    }
+    return NULL;
+}
+
+// Gets the cgroup v2 path, or the path in the first hierarchy.
+static const char *findCgroupPath(char *buf, size_t *len) {
+    char *first = NULL;
+    for (char *line = buf; line != NULL && *line != '\0';) {
+        char *next = strchr(line, '\n');
+        if (next != NULL)
+            *next++ = '\0';
+        char *path = strchr(line, ':');
+        path = path != NULL ? strchr(path + 1, ':') : NULL;
+        if (path != NULL) {
+            if (strncmp(line, "0::", 3) == 0) {
+                *len = strlen(path + 1);
+                return path + 1;
+            }
+            if (first == NULL)
+                first = path + 1;
+        }
+        line = next;
+    }
+    if (first != NULL)
+        *len = strlen(first);
+    return first;
+}
+
+static int pushOptionalStrs(ProcWorker *w, const char *dir, ProcEntry *entry) {
+    const ProcScan *scan = w->scan;
+    unsigned int fields = scan->fields;
+    char path[64];
+    // Threads share exe, cmdline, and environ with the main thread.
+    if ((fields & ENVU_PROC_EXE) && !entry->proc.is_thread) {
+        snprintf(path, sizeof(path), "%s/exe", dir);
+        ssize_t len = readlinkat(scan->proc_fd, path, w->buf, w->buf_size);
+        if (len > 0 && (size_t)len < w->buf_size) {
+            if (pushStr(w, w->buf, (size_t)len) != 0)
+                return -1;
+            entry->str_mask |= 1ULL << STR_EXE;
+        }
+    }
+    if ((fields & ENVU_PROC_CMDLINE) && !entry->proc.is_thread) {
+        snprintf(path, sizeof(path), "%s/cmdline", dir);
+        ssize_t len = readProcFile(w, path);
+        if (len >= 0) {
+            while (len > 0 && w->buf[len - 1] == '\0')
+                len--;
+            for (ssize_t i = 0; i < len; i++) {
+                if (w->buf[i] == '\0')
+                    w->buf[i] = ' ';
+            }
+            if (pushStr(w, w->buf, (size_t)len) != 0)
+                return -1;
+            entry->str_mask |= 1ULL << STR_CMDLINE;
+        }
+    }
+    if ((fields & ENVU_PROC_CGROUP)) {
+        snprintf(path, sizeof(path), "%s/cgroup", dir);
+        size_t len = 0;
+        const char *cgroup = readProcFile(w, path) > 0 ? findCgroupPath(w->buf, &len) : NULL;
+        if (cgroup != NULL) {
+            if (pushStr(w, cgroup, len) != 0)
+                return -1;
+            entry->str_mask |= 1ULL << STR_CGROUP;
+        }
+    }
+    const envuProcessFilter *filter = scan->filter;
+    if ((fields & ENVU_PROC_ENVIRON) && !entry->proc.is_thread && filter->env_name_count > 0) {
+        snprintf(path, sizeof(path), "%s/environ", dir);
+        ssize_t len = readProcFile(w, path);
+        if (len < 0)
+            return 0;
+        // STR_MAX marks that environ was readable.
+        entry->str_mask |= 1ULL << STR_MAX;
+        for (int i = 0; i < filter->env_name_count; i++) {
+            size_t name_len = strlen(filter->env_names[i]);
+            for (const char *var = w->buf; var < w->buf + len; var += strlen(var) + 1) {
+                if (strncmp(var, filter->env_names[i], name_len) != 0 || var[name_len] != '=')
+                    continue;
+                const char *value = var + name_len + 1;
+                if (pushStr(w, value, strlen(value)) != 0)
+                    return -1;
+                entry->str_mask |= 1ULL << (STR_ENV + i);
+                break;
+            }
+        }
+    }
+    return 0;
+}
+
+static int addEntry(ProcWorker *w, const char *dir, int pid, int tgid, unsigned int uid) {
+    const ProcScan *scan = w->scan;
+    char path[64];
+    snprintf(path, sizeof(path), "%s/stat", dir);
+    if (readProcFile(w, path) <= 0)
+        return -1;
+    ProcEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    const char *comm;
+    size_t comm_len;
+    if (parseProcStat(w->buf, &entry.proc, &comm, &comm_len) != 0)
+        return -1;
+    entry.proc.pid = pid;
+    entry.proc.tgid = tgid;
+    entry.proc.uid = uid;
+    entry.proc.is_thread = pid != tgid;
+    const char *comm_filter = scan->filter->comm;
+    if (!entry.proc.is_thread && comm_filter != NULL &&
+        (strlen(comm_filter) != comm_len || memcmp(comm_filter, comm, comm_len) != 0))
+        return -1;
+    entry.worker = w->index;
+    entry.str_offset = w->str_len;
+    entry.str_mask = 1ULL << STR_COMM;
+    entry.reused = findPrevProcess(scan, pid, entry.proc.start_time);
+    if (growArray((void **)&w->entries, &w->entry_capacity, w->entry_count,
+                  sizeof(ProcEntry)) != 0 ||
+        pushStr(w, comm, comm_len) != 0 ||
+        (entry.reused == NULL && pushOptionalStrs(w, dir, &entry) != 0)) {
+        w->failed = 1;
+        return -1;
+    }
+    w->entries[w->entry_count++] = entry;
+    return 0;
+}
+
+static int isPidName(const char *name) {
+    if (*name == '\0')
+        return 0;
+    for (; *name != '\0'; name++) {
+        if (*name < '0' || *name > '9')
+            return 0;
+    }
+    return 1;
+}
+
+// Lists numeric entries of a directory with getdents64.
+static int listPids(int dir_fd, char *buf, size_t buf_size, int **pids, size_t *capacity) {
+    size_t count = 0;
+    while (1) {
+        long len = syscall(SYS_getdents64, dir_fd, buf, buf_size);
+        if (len < 0)
+            return -1;
+        if (len == 0)
+            break;
+        for (long pos = 0; pos < len;) {
+            const char *ent = buf + pos;
+            unsigned short reclen;
+            memcpy(&reclen, ent + 16, sizeof(reclen));
+            pos += reclen;
+            if (!isPidName(ent + 19))
+                continue;
+            if (growArray((void **)pids, capacity, count, sizeof(int)) != 0)
+                return -1;
+            (*pids)[count++] = atoi(ent + 19);
+        }
+    }
+    return (int)count;
+}
+
+static void scanThreads(ProcWorker *w, int pid, unsigned int uid) {
+    char path[64];
+    snprintf(path, sizeof(path), "%d/task", pid);
+    int dir_fd = openat(w->scan->proc_fd, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd == -1)
+        return;
+    int *tids = NULL;
+    size_t capacity = 0;
+    int count = listPids(dir_fd, w->buf, w->buf_size, &tids, &capacity);
+    close(dir_fd);
+    for (int i = 0; i < count; i++) {
+        if (tids[i] == pid)
+            continue;
+        snprintf(path, sizeof(path), "%d/task/%d", pid, tids[i]);
+        addEntry(w, path, tids[i], pid, uid);
+    }
+    if (count < 0 && errno == ENOMEM)
+        w->failed = 1;
+    free(tids);
+}
+
+static void *scanProcesses(void *arg) {
+    ProcWorker *w = arg;
+    ProcScan *scan = w->scan;
+    while (!w->failed) {
+        int i = __atomic_fetch_add(&scan->next, 1, __ATOMIC_RELAXED);
+        if (i >= scan->pid_count)
+            break;
+        int pid = scan->pids[i];
+        char dir[32];
+        snprintf(dir, sizeof(dir), "%d", pid);
+        struct stat st;
+        if (fstatat(scan->proc_fd, dir, &st, 0) != 0)
+            continue;
+        const envuProcessFilter *filter = scan->filter;
+        if (filter->has_uid && st.st_uid != filter->uid)
+            continue;
+        if (addEntry(w, dir, pid, pid, st.st_uid) == 0 && (scan->fields & ENVU_PROC_THREADS))
+            scanThreads(w, pid, st.st_uid);
+    }
+    return NULL;
+}
+
+static int compareEntries(const void *a, const void *b) {
+    const envuProcess *p1 = &(*(const ProcEntry *const *)a)->proc;
+    const envuProcess *p2 = &(*(const ProcEntry *const *)b)->proc;
+    if (p1->tgid != p2->tgid)
+        return p1->tgid < p2->tgid ? -1 : 1;
+    if (p1->is_thread != p2->is_thread)
+        return p1->is_thread - p2->is_thread;
+    return p1->pid < p2->pid ? -1 : p1->pid > p2->pid;
+}
+
+static int comparePids(const void *a, const void *b) {
+    int pid1 = (*(const envuProcess *const *)a)->pid;
+    int pid2 = (*(const envuProcess *const *)b)->pid;
+    return pid1 < pid2 ? -1 : pid1 > pid2;
+}
+
+// Gets strings of an entry. Missing ones are null.
+static void getEntryStrs(const ProcEntry *entry, const ProcWorker *workers,
+                         int env_count, const char **strs) {
+    memset(strs, 0, STR_MAX * sizeof(char *));
+    const char *p = workers[entry->worker].strs + entry->str_offset;
+    for (int i = 0; i < STR_MAX; i++) {
+        if (entry->str_mask & (1ULL << i)) {
+            strs[i] = p;
+            p += strlen(p) + 1;
+        }
+    }
+    const envuProcess *reused = entry->reused;
+    if (reused == NULL)
+        return;
+    strs[STR_EXE] = reused->exe;
+    strs[STR_CMDLINE] = reused->cmdline;
+    strs[STR_CGROUP] = reused->cgroup;
+    for (int i = 0; i < env_count && reused->env_values != NULL; i++)
+        strs[STR_ENV + i] = reused->env_values[i];
+}
+
+static char *copyStr(char **dst, const char *str) {
+    if (str == NULL)
+        return NULL;
+    char *copied = *dst;
+    size_t len = strlen(str) + 1;
+    memcpy(copied, str, len);
+    *dst += len;
+    return copied;
+}
+
+static int hasEnvValues(const ProcEntry *entry) {
+    if (entry->reused != NULL)
+        return entry->reused->env_values != NULL;
+    return (entry->str_mask & (1ULL << STR_MAX)) != 0;
+}
+
+static envuProcessSnapshot *buildSnapshot(const ProcScan *scan, ProcEntry **entries, int count,
+                                          const ProcWorker *workers) {
+    const envuProcessFilter *filter = scan->filter;
+    int env_count = (scan->fields & ENVU_PROC_ENVIRON) ? filter->env_name_count : 0;
+    const char *strs[STR_MAX];
+
+    // Allocate the snapshot, processes, pointers, and strings in a single block.
+    size_t str_size = filter->comm != NULL ? strlen(filter->comm) + 1 : 0;
+    for (int i = 0; i < env_count; i++)
+        str_size += strlen(filter->env_names[i]) + 1;
+    int env_array_count = 0;
+    for (int i = 0; i < count; i++) {
+        getEntryStrs(entries[i], workers, env_count, strs);
+        for (int j = 0; j < STR_MAX; j++)
+            str_size += strs[j] != NULL ? strlen(strs[j]) + 1 : 0;
+        env_array_count += !entries[i]->proc.is_thread && hasEnvValues(entries[i]);
+    }
+    size_t size = sizeof(envuProcessSnapshot) + count * sizeof(envuProcess) +
+                  (env_count + (size_t)env_array_count * env_count) * sizeof(char *) + str_size;
+    envuProcessSnapshot *snapshot = calloc(1, size);
+    if (snapshot == NULL)
+        return NULL;
+    snapshot->count = count;
+    snapshot->processes = (envuProcess *)(snapshot + 1);
+    snapshot->fields = scan->fields;
+    snapshot->env_name_count = env_count;
+    snapshot->env_names = (const char **)(snapshot->processes + count);
+    const char **env_values = snapshot->env_names + env_count;
+    char *str = (char *)(env_values + (size_t)env_array_count * env_count);
+    for (int i = 0; i < env_count; i++)
+        snapshot->env_names[i] = copyStr(&str, filter->env_names[i]);
+    snapshot->filter = *filter;
+    snapshot->filter.comm = copyStr(&str, filter->comm);
+    snapshot->filter.env_names = snapshot->env_names;
+    snapshot->filter.env_name_count = env_count;
+
+    const envuProcess *leader = NULL;
+    for (int i = 0; i < count; i++) {
+        const ProcEntry *entry = entries[i];
+        envuProcess *proc = &snapshot->processes[i];
+        *proc = entry->proc;
+        getEntryStrs(entry, workers, env_count, strs);
+        proc->comm = copyStr(&str, strs[STR_COMM]);
+        proc->cgroup = copyStr(&str, strs[STR_CGROUP]);
+        snapshot->reused_count += entry->reused != NULL;
+        if (proc->is_thread) {
+            if (leader != NULL && leader->pid == proc->tgid) {
+                proc->exe = leader->exe;
+                proc->cmdline = leader->cmdline;
+                proc->env_values = leader->env_values;
+            }
+            continue;
+        }
+        leader = proc;
+        proc->exe = copyStr(&str, strs[STR_EXE]);
+        proc->cmdline = copyStr(&str, strs[STR_CMDLINE]);
+        if (env_count > 0 && hasEnvValues(entry)) {
+            proc->env_values = env_values;
+            for (int j = 0; j < env_count; j++)
+                env_values[j] = copyStr(&str, strs[STR_ENV + j]);
+            env_values += env_count;
+        }
+    }
+    return snapshot;
+}
+
+static int getScanThreadCount(const envuProcessFilter *filter, int pid_count) {
+    int count = filter->thread_count;
+    if (count <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        count = cpus > 8 ? 8 : cpus > 0 ? (int)cpus : 1;
+        // Threads don't pay off for a small process table.
+        int max_count = pid_count / 64 + 1;
+        if (count > max_count)
+            count = max_count;
+    }
+    return count;
+}
+
+static int sortPrevProcesses(ProcScan *scan) {
+    const envuProcessSnapshot *prev = scan->prev;
+    if (prev == NULL || prev->count == 0)
+        return 0;
+    scan->prev_procs = malloc(prev->count * sizeof(envuProcess *));
+    if (scan->prev_procs == NULL)
+        return -1;
+    for (int i = 0; i < prev->count; i++)
+        scan->prev_procs[i] = &prev->processes[i];
+    qsort(scan->prev_procs, prev->count, sizeof(envuProcess *), comparePids);
+    return 0;
+}
+
+static int runWorkers(ProcWorker *workers, int worker_count) {
+    pthread_t *threads = calloc(worker_count, sizeof(pthread_t));
+    if (threads == NULL)
+        return -1;
+    int started = 1;
+    for (; started < worker_count; started++) {
+        if (pthread_create(&threads[started], NULL, scanProcesses, &workers[started]) != 0)
+            break;
+    }
+    // The calling thread scans as well. It takes over the work if threads fail to start.
+    scanProcesses(&workers[0]);
+    for (int i = 1; i < started; i++)
+        pthread_join(threads[i], NULL);
+    free(threads);
+    for (int i = 0; i < worker_count; i++) {
+        if (workers[i].failed)
+            return -1;
+    }
+    return 0;
+}
+
+static envuProcessSnapshot *collectSnapshot(const ProcScan *scan, const ProcWorker *workers,
+                                            int worker_count) {
+    size_t count = 0;
+    for (int i = 0; i < worker_count; i++)
+        count += workers[i].entry_count;
+    ProcEntry **entries = malloc((count > 0 ? count : 1) * sizeof(ProcEntry *));
+    if (entries == NULL)
+        return NULL;
+    count = 0;
+    for (int i = 0; i < worker_count; i++) {
+        for (size_t j = 0; j < workers[i].entry_count; j++)
+            entries[count++] = &workers[i].entries[j];
+    }
+    qsort(entries, count, sizeof(ProcEntry *), compareEntries);
+    envuProcessSnapshot *snapshot = buildSnapshot(scan, entries, (int)count, workers);
+    free(entries);
+    return snapshot;
+}
+
+static envuProcessSnapshot *scanWithWorkers(ProcScan *scan, int worker_count) {
+    ProcWorker *workers = calloc(worker_count, sizeof(ProcWorker));
+    if (workers == NULL)
+        return NULL;
+    int ok = 1;
+    for (int i = 0; i < worker_count; i++) {
+        workers[i].scan = scan;
+        workers[i].index = i;
+        workers[i].buf_size = 4096;
+        workers[i].buf = malloc(workers[i].buf_size);
+        ok = ok && workers[i].buf != NULL;
+    }
+    envuProcessSnapshot *snapshot = NULL;
+    if (ok && runWorkers(workers, worker_count) == 0)
+        snapshot = collectSnapshot(scan, workers, worker_count);
+    for (int i = 0; i < worker_count; i++) {
+        free(workers[i].entries);
+        free(workers[i].strs);
+        free(workers[i].buf);
+    }
+    free(workers);
+    return snapshot;
+}
+
+static envuProcessSnapshot *snapshotProcesses(unsigned int fields, const envuProcessFilter *filter,
+                                              const envuProcessSnapshot *prev) {
+    envuProcessFilter empty_filter = { 0 };
+    if (filter == NULL)
+        filter = &empty_filter;
+    if (filter->env_name_count < 0 || filter->env_name_count > ENVU_MAX_PROCESS_ENV ||
+        (filter->env_name_count > 0 && filter->env_names == NULL)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    char path[PATH_MAX];
+    if (envuGetSysPath("/proc", path, sizeof(path)) != 0)
+        return NULL;
+    ProcScan scan = { 0 };
+    scan.fields = fields;
+    scan.filter = filter;
+    scan.prev = prev;
+    scan.proc_fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (scan.proc_fd == -1)
+        return NULL;
+
+    size_t buf_size = 32768;
+    char *buf = malloc(buf_size);
+    size_t pid_capacity = 0;
+    scan.pid_count = buf != NULL ?
+        listPids(scan.proc_fd, buf, buf_size, &scan.pids, &pid_capacity) : -1;
+    free(buf);
+    envuProcessSnapshot *snapshot = NULL;
+    if (scan.pid_count >= 0 && sortPrevProcesses(&scan) == 0)
+        snapshot = scanWithWorkers(&scan, getScanThreadCount(filter, scan.pid_count));
+    free(scan.prev_procs);
+    free(scan.pids);
+    close(scan.proc_fd);
+    return snapshot;
+}
+
+envuProcessSnapshot *snapshotProcessesLinux(unsigned int fields, const envuProcessFilter *filter) {
+    return snapshotProcesses(fields, filter, NULL);
+}
+
+envuProcessSnapshot *updateProcessSnapshotLinux(const envuProcessSnapshot *prev) {
+    if (prev == NULL)
+        return NULL;
+    return snapshotProcesses(prev->fields, &prev->filter, prev);
+}
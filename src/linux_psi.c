@@ -0,0 +1,140 @@
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "env_utils.h"
+#include "env_utils_priv.h"
+
+static const char *pressure_names[] = { "cpu", "memory", "io" };
+
+// Parses "avg10=0.00 avg60=0.00 avg300=0.00 total=0"
+static int parsePressureStat(const char *line, envuPressureStat *stat) {
+    int fields = 0;
+    const char *p = line;
+    while (*p != '\0' && *p != '\n') {
+        while (*p == ' ')
+            p++;
+        const char *eq = strchr(p, '=');
+        if (eq == NULL)
+            break;
+        size_t key_len = (size_t)(eq - p);
+        const char *value = eq + 1;
+        const char *end;
+        if (key_len == 5 && memcmp(p, "avg10", 5) == 0) {
+            stat->avg10 = envuParseDecimal(value, &end);
+        } else if (key_len == 5 && memcmp(p, "avg60", 5) == 0) {
+            stat->avg60 = envuParseDecimal(value, &end);
+        } else if (key_len == 6 && memcmp(p, "avg300", 6) == 0) {
+            stat->avg300 = envuParseDecimal(value, &end);
+        } else if (key_len == 5 && memcmp(p, "total", 5) == 0) {
+            stat->total = strtoull(value, (char **)&end, 10);
+        } else {
+            end = value;
+            fields--;
+        }
+        fields++;
+        p = end;
+        while (*p != '\0' && *p != ' ' && *p != '\n')
+            p++;
+    }
+    return fields == 4 ? 0 : -1;
+}
+
+static int parsePressure(const char *buf, envuPressure *out) {
+    int has_some = 0;
+    const char *line = buf;
+    while (line != NULL && *line != '\0') {
+        if (strncmp(line, "some ", 5) == 0)
+            has_some = parsePressureStat(line + 5, &out->some) == 0;
+        else if (strncmp(line, "full ", 5) == 0)
+            out->has_full = parsePressureStat(line + 5, &out->full) == 0;
+        line = strchr(line, '\n');
+        if (line != NULL)
+            line++;
+    }
+    return has_some ? 0 : -1;
+}
+
+// Gets the path of *.pressure in the cgroup v2 of the process.
+static int getCgroupPressurePath(const char *name, char *path, size_t size) {
+    envuCgroupDir dir;
+    // No cgroup v1 controller has this name. It finds the cgroup v2.
+    if (envuFindCgroupDir("pressure", &dir) != 0 || dir.version != 2)
+        return -1;
+    int len = snprintf(path, size, "%s%s/%s.pressure", dir.mount_point, dir.path, name);
+    if (len < 0 || (size_t)len >= size)
+        return -1;
+    return 0;
+}
+
+int getPressureLinux(envuPressureResource resource, envuPressure *out) {
+    if (out == NULL)
+        return -1;
+    memset(out, 0, sizeof(*out));
+    if ((unsigned)resource > ENVU_PRESSURE_IO)
+        return -1;
+    const char *name = pressure_names[resource];
+    char path[PATH_MAX];
+    char buf[512];
+    if (getCgroupPressurePath(name, path, sizeof(path)) == 0 &&
+        envuReadSysFile(path, buf, sizeof(buf)) > 0 && parsePressure(buf, out) == 0) {
+        out->from_cgroup = 1;
+        return 0;
+    }
+    memset(out, 0, sizeof(*out));
+    snprintf(path, sizeof(path), "/proc/pressure/%s", name);
+    // The file doesn't exist without CONFIG_PSI, and reading fails with psi=0.
+    if (envuReadSysFile(path, buf, sizeof(buf)) <= 0 || parsePressure(buf, out) != 0) {
+        memset(out, 0, sizeof(*out));
+        return -1;
+    }
+    return 0;
+}
+
+static int openTrigger(const char *path, const char *trigger) {
+    char full_path[PATH_MAX];
+    if (envuGetSysPath(path, full_path, sizeof(full_path)) != 0)
+        return -1;
+    int fd = open(full_path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd == -1)
+        return -1;
+    // The kernel expects the trigger with a null terminator.
+    ssize_t len = (ssize_t)strlen(trigger) + 1;
+    ssize_t ret;
+    do {
+        ret = write(fd, trigger, (size_t)len);
+    } while (ret < 0 && errno == EINTR);
+    if (ret != len) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    return fd;
+}
+
+int subscribePressureLinux(envuPressureResource resource,
+                           uint64_t threshold_us, uint64_t window_us) {
+    if ((unsigned)resource > ENVU_PRESSURE_IO || threshold_us == 0 ||
+        threshold_us >= window_us) {
+        errno = EINVAL;
+        return -1;
+    }
+    const char *name = pressure_names[resource];
+    char trigger[64];
+    snprintf(trigger, sizeof(trigger), "some %llu %llu",
+             (unsigned long long)threshold_us, (unsigned long long)window_us);
+    char path[PATH_MAX];
+    if (getCgroupPressurePath(name, path, sizeof(path)) == 0) {
+        int fd = openTrigger(path, trigger);
+        if (fd != -1)
+            return fd;
+    }
+    snprintf(path, sizeof(path), "/proc/pressure/%s", name);
+    return openTrigger(path, trigger);
+}
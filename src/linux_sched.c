@@ -0,0 +1,240 @@
+#define _GNU_SOURCE
+
+#include <sys/resource.h>
+#include <sched.h>
+#include <pthread.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "env_utils.h"
+#include "env_utils_priv.h"
+
+#define CPU_SET_WORDS (ENVU_CPU_SETSIZE / 64)
+
+// Kernel parameters that affect performance.
+static const char *perf_params[] = {
+    "isolcpus", "nohz_full", "nohz", "rcu_nocbs", "rcu_nocb_poll", "irqaffinity",
+    "kthread_cpus", "housekeeping", "mitigations", "nosmt", "nopti", "pti", "spectre_v2",
+    "intel_pstate", "amd_pstate", "cpufreq.default_governor", "idle",
+    "processor.max_cstate", "intel_idle.max_cstate", "transparent_hugepage", "hugepages",
+    "hugepagesz", "default_hugepagesz", "numa_balancing", "skew_tick", "tsc", "clocksource",
+    "preempt", "threadirqs", "nowatchdog", "nmi_watchdog", "nosoftlockup", "audit",
+    NULL
+};
+
+typedef struct SchedCache {
+    envuSchedEnvironment env;
+    // Parsed /proc/cmdline
+    int param_count;
+    char **keys;
+    char **values;
+    char *perf_cmdline;
+} SchedCache;
+
+static int isPerfParam(const char *key) {
+    for (const char **p = perf_params; *p != NULL; p++) {
+        if (strcmp(*p, key) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+static int isCmdlineSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n';
+}
+
+// Splits "key=value key2="quoted value" flag" into keys and values in place.
+static int parseCmdline(char *cmdline, SchedCache *cache) {
+    int capacity = 1;
+    for (char *p = cmdline; *p != '\0'; p++)
+        capacity += isCmdlineSpace(*p);
+    cache->keys = calloc(capacity * 2, sizeof(char *));
+    if (cache->keys == NULL)
+        return -1;
+    cache->values = cache->keys + capacity;
+
+    char *p = cmdline;
+    int count = 0;
+    while (*p != '\0' && count < capacity) {
+        while (isCmdlineSpace(*p))
+            p++;
+        if (*p == '\0')
+            break;
+        char *key = p;
+        char *value = NULL;
+        int quoted = 0;
+        while (*p != '\0' && (quoted || !isCmdlineSpace(*p))) {
+            if (*p == '"')
+                quoted = !quoted;
+            else if (*p == '=' && value == NULL && !quoted)
+                value = p + 1;
+            p++;
+        }
+        if (*p != '\0')
+            *p++ = '\0';
+        if (value != NULL) {
+            value[-1] = '\0';
+            // remove quotes
+            size_t len = strlen(value);
+            if (len >= 2 && value[0] == '"' && value[len - 1] == '"') {
+                value[len - 1] = '\0';
+                value++;
+            }
+        }
+        cache->keys[count] = key;
+        cache->values[count] = value != NULL ? value : key + strlen(key);
+        count++;
+    }
+    cache->param_count = count;
+    return 0;
+}
+
+static const char *findParam(const SchedCache *cache, const char *key) {
+    for (int i = cache->param_count - 1; i >= 0; i--) {
+        if (strcmp(cache->keys[i], key) == 0)
+            return cache->values[i];
+    }
+    return NULL;
+}
+
+// Parses "domain,managed_irq,2-3" in isolcpus= and cpu lists in other parameters.
+static void parseCpuParam(const char *value, envuCpuSet *set) {
+    if (value == NULL)
+        return;
+    while ((*value >= 'a' && *value <= 'z') || (*value >= 'A' && *value <= 'Z')) {
+        const char *comma = strchr(value, ',');
+        if (comma == NULL)
+            return;
+        value = comma + 1;
+    }
+    if (envuParseCpuList(value, set->bits, CPU_SET_WORDS) < 0)
+        memset(set, 0, sizeof(*set));
+}
+
+static void readCpuMask(const char *path, const SchedCache *cache, const char *key,
+                        envuCpuSet *set) {
+    char buf[4096];
+    if (envuReadSysFile(path, buf, sizeof(buf)) > 0 &&
+        envuParseCpuList(buf, set->bits, CPU_SET_WORDS) > 0)
+        return;
+    memset(set, 0, sizeof(*set));
+    parseCpuParam(findParam(cache, key), set);
+}
+
+static char *joinPerfParams(const SchedCache *cache) {
+    size_t size = 1;
+    for (int i = 0; i < cache->param_count; i++)
+        size += strlen(cache->keys[i]) + strlen(cache->values[i]) + 2;
+    char *str = malloc(size);
+    if (str == NULL)
+        return NULL;
+    char *p = str;
+    for (int i = 0; i < cache->param_count; i++) {
+        if (!isPerfParam(cache->keys[i]))
+            continue;
+        if (p != str)
+            *p++ = ' ';
+        if (*cache->values[i] == '\0')
+            p += sprintf(p, "%s", cache->keys[i]);
+        else
+            p += sprintf(p, "%s=%s", cache->keys[i], cache->values[i]);
+    }
+    *p = '\0';
+    return str;
+}
+
+static SchedCache *createSchedCache(void) {
+    SchedCache *cache = calloc(1, sizeof(SchedCache));
+    if (cache == NULL)
+        return NULL;
+    char *cmdline = envuReadSysFileAlloc("/proc/cmdline", NULL);
+    if (cmdline != NULL && parseCmdline(cmdline, cache) != 0) {
+        free(cmdline);
+        cmdline = NULL;
+    }
+    // Note: cmdline is kept for keys and values.
+    cache->perf_cmdline = joinPerfParams(cache);
+    if (cache->perf_cmdline == NULL) {
+        free(cache->keys);
+        free(cmdline);
+        free(cache);
+        return NULL;
+    }
+
+    envuSchedEnvironment *env = &cache->env;
+    readCpuMask("/sys/devices/system/cpu/isolated", cache, "isolcpus", &env->isolated);
+    readCpuMask("/sys/devices/system/cpu/nohz_full", cache, "nohz_full", &env->nohz_full);
+    parseCpuParam(findParam(cache, "rcu_nocbs"), &env->rcu_nocbs);
+
+    long long autogroup;
+    if (envuReadSysLong("/proc/sys/kernel/sched_autogroup_enabled", &autogroup) == 0)
+        env->autogroup = autogroup != 0;
+    else
+        env->autogroup = -1;
+    env->perf_cmdline = cache->perf_cmdline;
+    return cache;
+}
+
+static SchedCache *sched_cache = NULL;
+static unsigned int sched_cache_gen = 0;
+static pthread_mutex_t sched_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static const SchedCache *getSchedCache(void) {
+    unsigned int gen = envuGetSysRootGen();
+    pthread_mutex_lock(&sched_cache_mutex);
+    if (sched_cache == NULL || sched_cache_gen != gen) {
+        // Note: Old caches are not freed because callers might still use their strings.
+        sched_cache = createSchedCache();
+        sched_cache_gen = gen;
+    }
+    const SchedCache *cache = sched_cache;
+    pthread_mutex_unlock(&sched_cache_mutex);
+    return cache;
+}
+
+static envuSchedPolicy toSchedPolicy(int policy) {
+    switch (policy & ~SCHED_RESET_ON_FORK) {
+    case SCHED_OTHER: return ENVU_SCHED_OTHER;
+    case SCHED_FIFO: return ENVU_SCHED_FIFO;
+    case SCHED_RR: return ENVU_SCHED_RR;
+    case SCHED_BATCH: return ENVU_SCHED_BATCH;
+    case SCHED_IDLE: return ENVU_SCHED_IDLE;
+#ifdef SCHED_DEADLINE
+    case SCHED_DEADLINE: return ENVU_SCHED_DEADLINE;
+#else
+    case 6: return ENVU_SCHED_DEADLINE;
+#endif
+    default: return ENVU_SCHED_UNKNOWN;
+    }
+}
+
+int getSchedEnvironmentLinux(envuSchedEnvironment *out) {
+    if (out == NULL)
+        return -1;
+    const SchedCache *cache = getSchedCache();
+    if (cache == NULL)
+        return -1;
+    *out = cache->env;
+
+    // sched_getscheduler(0) and getpriority(PRIO_PROCESS, 0) refer to the calling thread.
+    int policy = sched_getscheduler(0);
+    out->policy = policy < 0 ? ENVU_SCHED_UNKNOWN : toSchedPolicy(policy);
+    struct sched_param param;
+    if (sched_getparam(0, &param) == 0)
+        out->priority = param.sched_priority;
+    errno = 0;
+    int nice = getpriority(PRIO_PROCESS, 0);
+    if (errno == 0)
+        out->nice = nice;
+    return 0;
+}
+
+const char *getKernelCmdlineValueLinux(const char *key) {
+    if (key == NULL)
+        return NULL;
+    const SchedCache *cache = getSchedCache();
+    if (cache == NULL)
+        return NULL;
+    return findParam(cache, key);
+}
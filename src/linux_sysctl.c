@@ -0,0 +1,136 @@
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "env_utils.h"
+#include "env_utils_priv.h"
+
+// Converts "vm.swappiness" to "vm/swappiness".
+static int toSysctlPath(const char *name, char *path, size_t size) {
+    size_t len = strlen(name);
+    if (len == 0 || len >= size || name[0] == '.' || name[0] == '/' || strstr(name, ".."))
+        return -1;
+    for (size_t i = 0; i <= len; i++)
+        path[i] = name[i] == '.' ? '/' : name[i];
+    return 0;
+}
+
+static int readSysctlAt(int dir_fd, const char *name, long long *value) {
+    char path[256];
+    char buf[128];
+    if (toSysctlPath(name, path, sizeof(path)) != 0)
+        return -1;
+    int fd = openat(dir_fd, path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return -1;
+    ssize_t len;
+    do {
+        len = read(fd, buf, sizeof(buf) - 1);
+    } while (len < 0 && errno == EINTR);
+    close(fd);
+    if (len <= 0)
+        return -1;
+    buf[len] = '\0';
+    char *end;
+    errno = 0;
+    *value = strtoll(buf, &end, 10);
+    if (end == buf || errno == ERANGE)
+        return -1;
+    return 0;
+}
+
+int envuReadSysctls(const char **names, int count, long long *values, int *found) {
+    char path[PATH_MAX];
+    if (envuGetSysPath("/proc/sys", path, sizeof(path)) != 0)
+        return -1;
+    // Resolve /proc/sys once and read every value relative to it.
+    int dir_fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd == -1)
+        return -1;
+    int found_count = 0;
+    for (int i = 0; i < count; i++) {
+        found[i] = readSysctlAt(dir_fd, names[i], &values[i]) == 0;
+        if (!found[i])
+            values[i] = 0;
+        found_count += found[i];
+    }
+    close(dir_fd);
+    return found_count;
+}
+
+static int followsRule(const envuTunableRule *rule, long long value) {
+    switch (rule->check) {
+    case ENVU_TUNABLE_EQ: return value == rule->value;
+    case ENVU_TUNABLE_NE: return value != rule->value;
+    case ENVU_TUNABLE_MIN: return value >= rule->value;
+    case ENVU_TUNABLE_MAX: return value <= rule->value;
+    default: return 1;
+    }
+}
+
+int auditTunablesLinux(const envuTunableRule *rules, int rule_count,
+                       envuTunableReport *out) {
+    if (out == NULL)
+        return -1;
+    memset(out, 0, sizeof(*out));
+    if (rules == NULL || rule_count < 0)
+        return -1;
+
+    // Allocate findings and their strings in a single block.
+    size_t size = rule_count * sizeof(envuTunableFinding);
+    for (int i = 0; i < rule_count; i++) {
+        if (rules[i].name == NULL)
+            return -1;
+        size += strlen(rules[i].name) + 1;
+        if (rules[i].reason != NULL)
+            size += strlen(rules[i].reason) + 1;
+    }
+    size_t batch_size = rule_count * (sizeof(const char *) + sizeof(long long) + sizeof(int));
+    envuTunableFinding *findings = calloc(1, size > 0 ? size : 1);
+    const char **names = malloc(batch_size > 0 ? batch_size : 1);
+    if (findings == NULL || names == NULL) {
+        free(findings);
+        free(names);
+        return -1;
+    }
+    long long *values = (long long *)(names + rule_count);
+    int *found = (int *)(values + rule_count);
+    for (int i = 0; i < rule_count; i++)
+        names[i] = rules[i].name;
+    if (envuReadSysctls(names, rule_count, values, found) < 0)
+        memset(found, 0, rule_count * sizeof(int));
+
+    char *str = (char *)(findings + rule_count);
+    for (int i = 0; i < rule_count; i++) {
+        const envuTunableRule *rule = &rules[i];
+        envuTunableFinding *finding = &findings[i];
+        size_t len = strlen(rule->name) + 1;
+        memcpy(str, rule->name, len);
+        finding->name = str;
+        str += len;
+        if (rule->reason != NULL) {
+            len = strlen(rule->reason) + 1;
+            memcpy(str, rule->reason, len);
+            finding->reason = str;
+            str += len;
+        }
+        finding->check = rule->check;
+        finding->recommended = rule->value;
+        finding->actual = values[i];
+        if (!found[i]) {
+            finding->status = ENVU_TUNABLE_UNAVAILABLE;
+        } else if (!followsRule(rule, values[i])) {
+            finding->status = ENVU_TUNABLE_MISMATCH;
+            out->mismatch_count++;
+        }
+    }
+    free(names);
+    out->count = rule_count;
+    out->findings = findings;
+    return out->mismatch_count;
+}
@@ -0,0 +1,596 @@
+#define _GNU_SOURCE
+
+#include <sys/syscall.h>
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+#include "env_utils.h"
+#include "env_utils_priv.h"
+
+#define CPU_SET_WORDS (ENVU_CPU_SETSIZE / 64)
+
+// Parses a size like "32K" or "8M".
+static uint64_t parseCacheSize(const char *str) {
+    char *end;
+    uint64_t size = strtoull(str, &end, 10);
+    if (*end == 'K')
+        size *= 1024;
+    else if (*end == 'M')
+        size *= 1024 * 1024;
+    else if (*end == 'G')
+        size *= 1024 * 1024 * 1024;
+    return size;
+}
+
+static int readCacheFile(int cpu, int index, const char *name, char *buf, size_t size) {
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/%s",
+             cpu, index, name);
+    ssize_t len = envuReadSysFile(path, buf, size);
+    if (len <= 0)
+        return -1;
+    // remove the last line feed
+    if (buf[len - 1] == '\n')
+        buf[len - 1] = '\0';
+    return 0;
+}
+
+// A cache with its own cpu set. Caches share cpu sets after all caches are found.
+typedef struct CacheEntry {
+    envuCacheInfo info;
+    envuCpuSet shared_cpus;
+} CacheEntry;
+
+static int readCacheInfo(int cpu, int index, CacheEntry *entry) {
+    char buf[1024];
+    memset(entry, 0, sizeof(*entry));
+    envuCacheInfo *cache = &entry->info;
+    if (readCacheFile(cpu, index, "level", buf, sizeof(buf)) != 0)
+        return -1;
+    cache->level = atoi(buf);
+
+    if (readCacheFile(cpu, index, "type", buf, sizeof(buf)) == 0) {
+        if (strcmp(buf, "Data") == 0)
+            cache->type = ENVU_CACHE_DATA;
+        else if (strcmp(buf, "Instruction") == 0)
+            cache->type = ENVU_CACHE_INSTRUCTION;
+        else if (strcmp(buf, "Unified") == 0)
+            cache->type = ENVU_CACHE_UNIFIED;
+    }
+    if (readCacheFile(cpu, index, "size", buf, sizeof(buf)) == 0)
+        cache->size = parseCacheSize(buf);
+    if (readCacheFile(cpu, index, "coherency_line_size", buf, sizeof(buf)) == 0)
+        cache->line_size = (uint32_t)atoi(buf);
+    if (readCacheFile(cpu, index, "ways_of_associativity", buf, sizeof(buf)) == 0)
+        cache->ways = (uint32_t)atoi(buf);
+    if (readCacheFile(cpu, index, "shared_cpu_list", buf, sizeof(buf)) == 0)
+        envuParseCpuList(buf, entry->shared_cpus.bits, CPU_SET_WORDS);
+    if (!envuCpuSetHas(&entry->shared_cpus, cpu))
+        entry->shared_cpus.bits[cpu / 64] |= 1ULL << (cpu % 64);
+    cache->shared_count = envuCpuSetCount(&entry->shared_cpus);
+    return 0;
+}
+
+static int isSameCpuSet(const envuCpuSet *a, const envuCpuSet *b) {
+    return memcmp(a, b, sizeof(envuCpuSet)) == 0;
+}
+
+static int isSameCache(const CacheEntry *a, const CacheEntry *b) {
+    return a->info.level == b->info.level && a->info.type == b->info.type &&
+           a->info.shared_count == b->info.shared_count &&
+           isSameCpuSet(&a->shared_cpus, &b->shared_cpus);
+}
+
+typedef struct CacheList {
+    CacheEntry *caches;
+    int count;
+    int capacity;
+} CacheList;
+
+static int appendCache(CacheList *list, const CacheEntry *cache) {
+    for (int i = 0; i < list->count; i++) {
+        if (isSameCache(&list->caches[i], cache))
+            return 0;
+    }
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 16;
+        CacheEntry *caches = realloc(list->caches, capacity * sizeof(CacheEntry));
+        if (caches == NULL)
+            return -1;
+        list->caches = caches;
+        list->capacity = capacity;
+    }
+    list->caches[list->count++] = *cache;
+    return 0;
+}
+
+static int getCachesFromSysfs(CacheList *list) {
+    char buf[4096];
+    uint64_t online[CPU_SET_WORDS];
+    if (envuReadSysFile("/sys/devices/system/cpu/online", buf, sizeof(buf)) <= 0 ||
+        envuParseCpuList(buf, online, CPU_SET_WORDS) <= 0)
+        return -1;
+
+    for (int cpu = 0; cpu < ENVU_CPU_SETSIZE; cpu++) {
+        if (!((online[cpu / 64] >> (cpu % 64)) & 1))
+            continue;
+        CacheEntry cache;
+        for (int index = 0; readCacheInfo(cpu, index, &cache) == 0; index++) {
+            if (appendCache(list, &cache) != 0)
+                return -1;
+        }
+    }
+    return list->count > 0 ? 0 : -1;
+}
+
+#if defined(__i386__) || defined(__x86_64__)
+// Reads deterministic cache parameters with cpuid.
+// Intel uses leaf 4, and AMD uses leaf 0x8000001D.
+static int getCachesFromCpuid(CacheList *list) {
+    unsigned int eax, ebx, ecx, edx;
+    unsigned int leaf = 0;
+    if (__get_cpuid_max(0, NULL) >= 4) {
+        __cpuid_count(4, 0, eax, ebx, ecx, edx);
+        if ((eax & 0x1f) != 0)
+            leaf = 4;
+    }
+    if (leaf == 0 && __get_cpuid_max(0x80000000, NULL) >= 0x8000001D)
+        leaf = 0x8000001D;
+    if (leaf == 0)
+        return -1;
+
+    for (unsigned int index = 0; index < 16; index++) {
+        __cpuid_count(leaf, index, eax, ebx, ecx, edx);
+        unsigned int type = eax & 0x1f;
+        if (type == 0)
+            break;
+        CacheEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        envuCacheInfo *cache = &entry.info;
+        cache->level = (eax >> 5) & 0x7;
+        cache->type = type <= 3 ? type : ENVU_CACHE_UNKNOWN;
+        cache->line_size = (ebx & 0xfff) + 1;
+        unsigned int partitions = ((ebx >> 12) & 0x3ff) + 1;
+        cache->ways = ((ebx >> 22) & 0x3ff) + 1;
+        uint64_t sets = (uint64_t)ecx + 1;
+        cache->size = (uint64_t)cache->ways * partitions * cache->line_size * sets;
+        cache->shared_count = (int)((eax >> 14) & 0xfff) + 1;
+        if (appendCache(list, &entry) != 0)
+            return -1;
+    }
+    return list->count > 0 ? 0 : -1;
+}
+#else
+static int getCachesFromCpuid(CacheList *list) {
+    (void)list;
+    return -1;
+}
+#endif
+
+static envuCacheTopology *createCacheTopology(void) {
+    CacheList list = { NULL, 0, 0 };
+    if (getCachesFromSysfs(&list) != 0) {
+        list.count = 0;
+        if (getCachesFromCpuid(&list) != 0) {
+            free(list.caches);
+            return NULL;
+        }
+    }
+
+    // Caches of a core usually have the same cpus. Store each cpu set only once.
+    int *set_ids = malloc(list.count * sizeof(int));
+    if (set_ids == NULL) {
+        free(list.caches);
+        return NULL;
+    }
+    int set_count = 0;
+    for (int i = 0; i < list.count; i++) {
+        int j = 0;
+        while (j < i && !isSameCpuSet(&list.caches[j].shared_cpus, &list.caches[i].shared_cpus))
+            j++;
+        set_ids[i] = j < i ? set_ids[j] : set_count++;
+    }
+
+    // Allocate the topology, caches, and cpu sets in a single block.
+    envuCacheTopology *topo = calloc(1, sizeof(envuCacheTopology) +
+                                        list.count * sizeof(envuCacheInfo) +
+                                        set_count * sizeof(envuCpuSet));
+    if (topo == NULL) {
+        free(set_ids);
+        free(list.caches);
+        return NULL;
+    }
+    envuCacheInfo *caches = (envuCacheInfo *)(topo + 1);
+    envuCpuSet *sets = (envuCpuSet *)(caches + list.count);
+    for (int i = 0; i < list.count; i++) {
+        caches[i] = list.caches[i].info;
+        sets[set_ids[i]] = list.caches[i].shared_cpus;
+        caches[i].shared_cpus = &sets[set_ids[i]];
+    }
+    free(set_ids);
+    free(list.caches);
+    topo->count = list.count;
+    topo->caches = caches;
+
+    // Caches of the first cpu are listed first.
+    const envuCacheInfo *first = &caches[0];
+    for (int i = 0; i < list.count; i++) {
+        const envuCacheInfo *cache = &caches[i];
+        if (i > 0 && cache->level <= first->level && cache->type == first->type)
+            break;  // caches of the next cpu
+        if (cache->level == 1 && cache->type == ENVU_CACHE_DATA) {
+            topo->l1d_size = cache->size;
+            topo->line_size = cache->line_size;
+        } else if (cache->level == 1 && cache->type == ENVU_CACHE_INSTRUCTION) {
+            topo->l1i_size = cache->size;
+        } else if (cache->level == 2) {
+            topo->l2_size = cache->size;
+        } else if (cache->level == 3) {
+            topo->l3_size = cache->size;
+        }
+    }
+    return topo;
+}
+
+static envuCacheTopology *cache_topology = NULL;
+static unsigned int cache_topology_gen = 0;
+static pthread_mutex_t cache_topology_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+const envuCacheTopology *getCacheTopologyLinux(void) {
+    unsigned int gen = envuGetSysRootGen();
+    pthread_mutex_lock(&cache_topology_mutex);
+    if (cache_topology == NULL || cache_topology_gen != gen) {
+        // Note: Old topologies are not freed because callers might still use them.
+        envuCacheTopology *topo = createCacheTopology();
+        if (topo != NULL || cache_topology_gen != gen)
+            cache_topology = topo;
+        cache_topology_gen = gen;
+    }
+    const envuCacheTopology *topo = cache_topology;
+    pthread_mutex_unlock(&cache_topology_mutex);
+    return topo;
+}
+
+// Reads "Node 0 MemTotal:       32768 kB" from nodeN/meminfo.
+static uint64_t getNodeMemValue(const char *meminfo, const char *key) {
+    const char *p = strstr(meminfo, key);
+    if (p == NULL)
+        return 0;
+    p += strlen(key);
+    while (*p == ' ' || *p == ':')
+        p++;
+    return strtoull(p, NULL, 10) * 1024;
+}
+
+static envuNumaTopology *createNumaTopology(void) {
+    char buf[4096];
+    uint64_t online[CPU_SET_WORDS];
+    int node_count = -1;
+    if (envuReadSysFile("/sys/devices/system/node/online", buf, sizeof(buf)) > 0)
+        node_count = envuParseCpuList(buf, online, CPU_SET_WORDS);
+    int has_numa = node_count > 0;
+    if (!has_numa) {
+        // Kernels without CONFIG_NUMA. Use a single node.
+        node_count = 1;
+        memset(online, 0, sizeof(online));
+        online[0] = 1;
+    }
+
+    // Allocate the topology, nodes, and distances in a single block.
+    size_t size = sizeof(envuNumaTopology) + node_count * sizeof(envuNumaNode) +
+                  node_count * node_count * sizeof(int);
+    envuNumaTopology *topo = calloc(1, size);
+    if (topo == NULL)
+        return NULL;
+    envuNumaNode *nodes = (envuNumaNode *)(topo + 1);
+    int *distances = (int *)(nodes + node_count);
+    topo->count = node_count;
+    topo->nodes = nodes;
+    topo->distances = distances;
+
+    int i = 0;
+    for (int id = 0; id < ENVU_CPU_SETSIZE && i < node_count; id++) {
+        if (!((online[id / 64] >> (id % 64)) & 1))
+            continue;
+        envuNumaNode *node = &nodes[i];
+        node->id = id;
+        char path[128];
+
+        if (!has_numa) {
+            if (envuReadSysFile("/sys/devices/system/cpu/online", buf, sizeof(buf)) > 0)
+                envuParseCpuList(buf, node->cpus.bits, CPU_SET_WORDS);
+            if (envuReadSysFile("/proc/meminfo", buf, sizeof(buf)) > 0) {
+                node->mem_total = getNodeMemValue(buf, "MemTotal");
+                node->mem_free = getNodeMemValue(buf, "MemFree");
+            }
+            distances[0] = 10;
+            break;
+        }
+
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", id);
+        if (envuReadSysFile(path, buf, sizeof(buf)) > 0)
+            envuParseCpuList(buf, node->cpus.bits, CPU_SET_WORDS);
+
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/meminfo", id);
+        if (envuReadSysFile(path, buf, sizeof(buf)) > 0) {
+            node->mem_total = getNodeMemValue(buf, "MemTotal");
+            node->mem_free = getNodeMemValue(buf, "MemFree");
+        }
+
+        // "10 21" The distances are listed in the order of online nodes.
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/distance", id);
+        int *row = &distances[i * node_count];
+        if (envuReadSysFile(path, buf, sizeof(buf)) > 0) {
+            char *p = buf;
+            for (int j = 0; j < node_count; j++) {
+                char *end;
+                long dist = strtol(p, &end, 10);
+                if (end == p)
+                    break;
+                row[j] = (int)dist;
+                p = end;
+            }
+        }
+        if (row[i] == 0)
+            row[i] = 10;
+        i++;
+    }
+    return topo;
+}
+
+static envuNumaTopology *numa_topology = NULL;
+static unsigned int numa_topology_gen = 0;
+static pthread_mutex_t numa_topology_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+const envuNumaTopology *getNumaTopologyLinux(void) {
+    unsigned int gen = envuGetSysRootGen();
+    pthread_mutex_lock(&numa_topology_mutex);
+    if (numa_topology == NULL || numa_topology_gen != gen) {
+        // Note: Old topologies are not freed because callers might still use them.
+        numa_topology = createNumaTopology();
+        numa_topology_gen = gen;
+    }
+    const envuNumaTopology *topo = numa_topology;
+    pthread_mutex_unlock(&numa_topology_mutex);
+    return topo;
+}
+
+int getCurrentNumaNodeLinux(void) {
+    unsigned int cpu;
+    unsigned int node;
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 29))
+    // glibc uses the vDSO for getcpu().
+    if (getcpu(&cpu, &node) != 0)
+        return -1;
+#elif defined(SYS_getcpu)
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0)
+        return -1;
+#else
+    return -1;
+#endif
+    return (int)node;
+}
+
+static int readTopologyInt(int cpu, const char *name, int *value) {
+    char path[128];
+    long long val;
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, name);
+    if (envuReadSysLong(path, &val) != 0)
+        return -1;
+    *value = (int)val;
+    return 0;
+}
+
+static envuCpuTopology *createCpuTopology(void) {
+    char buf[4096];
+    uint64_t online[CPU_SET_WORDS];
+    int cpu_count = 0;
+    if (envuReadSysFile("/sys/devices/system/cpu/online", buf, sizeof(buf)) > 0)
+        cpu_count = envuParseCpuList(buf, online, CPU_SET_WORDS);
+    if (cpu_count <= 0)
+        return NULL;
+
+    envuCpuTopology *topo = calloc(1, sizeof(envuCpuTopology) +
+                                      cpu_count * sizeof(envuLogicalCpu));
+    if (topo == NULL)
+        return NULL;
+    envuLogicalCpu *cpus = (envuLogicalCpu *)(topo + 1);
+    topo->count = cpu_count;
+    topo->cpus = cpus;
+
+    const envuNumaTopology *numa = getNumaTopologyLinux();
+    int i = 0;
+    for (int id = 0; id < ENVU_CPU_SETSIZE && i < cpu_count; id++) {
+        if (!((online[id / 64] >> (id % 64)) & 1))
+            continue;
+        envuLogicalCpu *cpu = &cpus[i++];
+        cpu->id = id;
+        if (readTopologyInt(id, "core_id", &cpu->core_id) != 0)
+            cpu->core_id = id;
+        if (readTopologyInt(id, "physical_package_id", &cpu->package_id) != 0 ||
+            cpu->package_id < 0)
+            cpu->package_id = 0;
+
+        char path[128];
+        snprintf(path, sizeof(path),
+                 "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", id);
+        if (envuReadSysFile(path, buf, sizeof(buf)) > 0)
+            envuParseCpuList(buf, cpu->siblings.bits, CPU_SET_WORDS);
+        cpu->siblings.bits[id / 64] |= 1ULL << (id % 64);
+        for (int j = 0; j < id; j++)
+            cpu->smt_index += envuCpuSetHas(&cpu->siblings, j);
+
+        for (int j = 0; numa != NULL && j < numa->count; j++) {
+            if (envuCpuSetHas(&numa->nodes[j].cpus, id)) {
+                cpu->node_id = numa->nodes[j].id;
+                break;
+            }
+        }
+    }
+
+    for (i = 0; i < cpu_count; i++) {
+        topo->core_count += cpus[i].smt_index == 0;
+        int first_in_package = 1;
+        for (int j = 0; j < i; j++) {
+            if (cpus[j].package_id == cpus[i].package_id) {
+                first_in_package = 0;
+                break;
+            }
+        }
+        topo->package_count += first_in_package;
+    }
+    return topo;
+}
+
+static envuCpuTopology *cpu_topology = NULL;
+static unsigned int cpu_topology_gen = 0;
+static pthread_mutex_t cpu_topology_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+const envuCpuTopology *getCpuTopologyLinux(void) {
+    unsigned int gen = envuGetSysRootGen();
+    pthread_mutex_lock(&cpu_topology_mutex);
+    if (cpu_topology == NULL || cpu_topology_gen != gen) {
+        // Note: Old topologies are not freed because callers might still use them.
+        cpu_topology = createCpuTopology();
+        cpu_topology_gen = gen;
+    }
+    const envuCpuTopology *topo = cpu_topology;
+    pthread_mutex_unlock(&cpu_topology_mutex);
+    return topo;
+}
+
+int pinCurrentThreadLinux(int cpu) {
+    if (cpu < 0 || cpu >= ENVU_CPU_SETSIZE)
+        return -1;
+    cpu_set_t *set = CPU_ALLOC(ENVU_CPU_SETSIZE);
+    if (set == NULL)
+        return -1;
+    size_t size = CPU_ALLOC_SIZE(ENVU_CPU_SETSIZE);
+    CPU_ZERO_S(size, set);
+    CPU_SET_S(cpu, size, set);
+    int ret = sched_setaffinity(0, size, set) == 0 ? 0 : -1;
+    CPU_FREE(set);
+    return ret;
+}
+
+int getThreadAffinityLinux(envuCpuSet *out) {
+    if (out == NULL)
+        return -1;
+    memset(out, 0, sizeof(*out));
+    // cpu_set_t only has 1024 cpus. Allocate a set as large as envuCpuSet.
+    cpu_set_t *set = CPU_ALLOC(ENVU_CPU_SETSIZE);
+    if (set == NULL)
+        return -1;
+    size_t size = CPU_ALLOC_SIZE(ENVU_CPU_SETSIZE);
+    if (sched_getaffinity(0, size, set) != 0) {
+        CPU_FREE(set);
+        return -1;
+    }
+    for (int cpu = 0; cpu < ENVU_CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET_S(cpu, size, set))
+            out->bits[cpu / 64] |= 1ULL << (cpu % 64);
+    }
+    CPU_FREE(set);
+    return envuCpuSetCount(out);
+}
+
+typedef struct Placement {
+    const envuLogicalCpu *cpu;
+    // The package or the NUMA node that the policy spreads workers over.
+    int group;
+    // The order of the core in the group.
+    int core_rank;
+} Placement;
+
+static int compareCompact(const void *a, const void *b) {
+    const envuLogicalCpu *x = ((const Placement *)a)->cpu;
+    const envuLogicalCpu *y = ((const Placement *)b)->cpu;
+    if (x->package_id != y->package_id)
+        return x->package_id - y->package_id;
+    if (x->core_id != y->core_id)
+        return x->core_id - y->core_id;
+    return x->id - y->id;
+}
+
+static int compareGroupCore(const void *a, const void *b) {
+    const Placement *x = (const Placement *)a;
+    const Placement *y = (const Placement *)b;
+    if (x->group != y->group)
+        return x->group - y->group;
+    return compareCompact(a, b);
+}
+
+static int compareScatter(const void *a, const void *b) {
+    const Placement *x = (const Placement *)a;
+    const Placement *y = (const Placement *)b;
+    if (x->cpu->smt_index != y->cpu->smt_index)
+        return x->cpu->smt_index - y->cpu->smt_index;
+    if (x->core_rank != y->core_rank)
+        return x->core_rank - y->core_rank;
+    if (x->group != y->group)
+        return x->group - y->group;
+    return x->cpu->id - y->cpu->id;
+}
+
+int *planWorkersLinux(int n, envuPlacementPolicy policy) {
+    if (n <= 0)
+        return NULL;
+    const envuCpuTopology *topo = getCpuTopologyLinux();
+    if (topo == NULL)
+        return NULL;
+    Placement *list = calloc(topo->count, sizeof(Placement));
+    int *plan = malloc(n * sizeof(int));
+    if (list == NULL || plan == NULL) {
+        free(list);
+        free(plan);
+        return NULL;
+    }
+
+    // The affinity of this process is meaningless for fixtures of envuSetSysRoot().
+    envuCpuSet affinity;
+    int has_affinity = !envuHasSysRoot() && getThreadAffinityLinux(&affinity) > 0;
+    int count = 0;
+    for (int i = 0; i < topo->count; i++) {
+        const envuLogicalCpu *cpu = &topo->cpus[i];
+        if (has_affinity && !envuCpuSetHas(&affinity, cpu->id))
+            continue;
+        list[count].cpu = cpu;
+        list[count].group = policy == ENVU_PLACE_NUMA_NODES ? cpu->node_id : cpu->package_id;
+        count++;
+    }
+    if (count == 0) {
+        free(list);
+        free(plan);
+        return NULL;
+    }
+
+    if (policy == ENVU_PLACE_COMPACT) {
+        qsort(list, count, sizeof(Placement), compareCompact);
+    } else {
+        // Rank cores in each group, then take the n-th core of every group in turn.
+        qsort(list, count, sizeof(Placement), compareGroupCore);
+        int rank = -1;
+        for (int i = 0; i < count; i++) {
+            const Placement *prev = i > 0 ? &list[i - 1] : NULL;
+            if (prev == NULL || prev->group != list[i].group)
+                rank = -1;
+            if (prev == NULL || rank < 0 || prev->cpu->package_id != list[i].cpu->package_id ||
+                prev->cpu->core_id != list[i].cpu->core_id)
+                rank++;
+            list[i].core_rank = rank;
+        }
+        qsort(list, count, sizeof(Placement), compareScatter);
+    }
+
+    for (int i = 0; i < n; i++)
+        plan[i] = list[i % count].cpu->id;
+    free(list);
+    return plan;
+}
@@ -0,0 +1,350 @@
+#define _GNU_SOURCE
+
+#include <unistd.h>
+#include <pthread.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+#include "env_utils.h"
+#include "env_utils_priv.h"
+
+static const char *hypervisor_names[] = {
+    "none", "unknown", "kvm", "qemu", "xen", "hyperv", "vmware", "virtualbox", "parallels",
+    "bhyve", "acrn", "firecracker", "wsl",
+};
+
+static const char *container_names[] = {
+    "none", "unknown", "docker", "podman", "kubernetes", "lxc", "systemd-nspawn", "gvisor",
+};
+
+static const char *cloud_names[] = {
+    "none", "aws", "gcp", "azure", "alibaba", "oracle", "digitalocean", "openstack",
+};
+
+typedef struct NameMap {
+    const char *pattern;
+    int value;
+} NameMap;
+
+// Hypervisor vendors in cpuid leaf 0x40000000
+static const NameMap cpuid_vendors[] = {
+    { "KVMKVMKVM", ENVU_HV_KVM },
+    { "Linux KVM Hv", ENVU_HV_KVM },
+    { "TCGTCGTCGTCG", ENVU_HV_QEMU },
+    { "XenVMMXenVMM", ENVU_HV_XEN },
+    { "Microsoft Hv", ENVU_HV_HYPERV },
+    { "VMwareVMware", ENVU_HV_VMWARE },
+    { "VBoxVBoxVBox", ENVU_HV_VIRTUALBOX },
+    { " lrpepyh  vr", ENVU_HV_PARALLELS },
+    { "bhyve bhyve ", ENVU_HV_BHYVE },
+    { "ACRNACRNACRN", ENVU_HV_ACRN },
+    { NULL, 0 }
+};
+
+// Substrings of DMI sys_vendor, product_name, or bios_vendor
+static const NameMap dmi_hypervisors[] = {
+    { "KVM", ENVU_HV_KVM },
+    { "Amazon EC2", ENVU_HV_KVM },
+    { "Google", ENVU_HV_KVM },
+    { "QEMU", ENVU_HV_QEMU },
+    { "Standard PC", ENVU_HV_QEMU },
+    { "Xen", ENVU_HV_XEN },
+    { "VMware", ENVU_HV_VMWARE },
+    { "VirtualBox", ENVU_HV_VIRTUALBOX },
+    { "innotek GmbH", ENVU_HV_VIRTUALBOX },
+    { "Parallels", ENVU_HV_PARALLELS },
+    { "BHYVE", ENVU_HV_BHYVE },
+    { "Virtual Machine", ENVU_HV_HYPERV },
+    { NULL, 0 }
+};
+
+// Substrings of DMI sys_vendor, product_name, or chassis_asset_tag
+static const NameMap dmi_clouds[] = {
+    { "Amazon EC2", ENVU_CLOUD_AWS },
+    { "Google Compute Engine", ENVU_CLOUD_GCP },
+    { "7783-7084-3265-9085-8269-3286-77", ENVU_CLOUD_AZURE },
+    { "Alibaba Cloud", ENVU_CLOUD_ALIBABA },
+    { "OracleCloud.com", ENVU_CLOUD_ORACLE },
+    { "DigitalOcean", ENVU_CLOUD_DIGITALOCEAN },
+    { "OpenStack", ENVU_CLOUD_OPENSTACK },
+    { NULL, 0 }
+};
+
+// Markers in /proc/1/cgroup
+static const NameMap cgroup_containers[] = {
+    { "/kubepods", ENVU_CONTAINER_KUBERNETES },
+    { "libpod", ENVU_CONTAINER_PODMAN },
+    { "/docker", ENVU_CONTAINER_DOCKER },
+    { "docker-", ENVU_CONTAINER_DOCKER },
+    { "/lxc/", ENVU_CONTAINER_LXC },
+    { "/lxc.payload", ENVU_CONTAINER_LXC },
+    { "/machine.slice/machine-", ENVU_CONTAINER_SYSTEMD_NSPAWN },
+    { NULL, 0 }
+};
+
+// Values of container= in /proc/1/environ and /run/systemd/container
+static const NameMap container_values[] = {
+    { "docker", ENVU_CONTAINER_DOCKER },
+    { "podman", ENVU_CONTAINER_PODMAN },
+    { "lxc", ENVU_CONTAINER_LXC },
+    { "lxc-libvirt", ENVU_CONTAINER_LXC },
+    { "systemd-nspawn", ENVU_CONTAINER_SYSTEMD_NSPAWN },
+    { NULL, 0 }
+};
+
+static int findSubstring(const NameMap *map, const char *str) {
+    for (const NameMap *m = map; m->pattern != NULL; m++) {
+        if (strstr(str, m->pattern) != NULL)
+            return m->value;
+    }
+    return 0;
+}
+
+static int findExact(const NameMap *map, const char *str) {
+    for (const NameMap *m = map; m->pattern != NULL; m++) {
+        if (strcmp(str, m->pattern) == 0)
+            return m->value;
+    }
+    return -1;
+}
+
+static int sysFileExists(const char *path) {
+    char full_path[PATH_MAX];
+    if (envuGetSysPath(path, full_path, sizeof(full_path)) != 0)
+        return 0;
+    return access(full_path, F_OK) == 0;
+}
+
+// Reads the first line of a file.
+static int readLine(const char *path, char *buf, size_t size) {
+    if (envuReadSysFile(path, buf, size) <= 0) {
+        buf[0] = '\0';
+        return -1;
+    }
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
+}
+
+// Collects results from multiple sources.
+typedef struct Votes {
+    int result;
+    int agree;
+    int hint_only;
+} Votes;
+
+static void addVote(Votes *votes, int value, int unknown) {
+    if (value == 0)
+        return;
+    if (votes->result == 0 || (votes->result == unknown && value != unknown)) {
+        votes->result = value;
+        votes->agree = 1;
+    } else if (votes->result == value) {
+        votes->agree++;
+    }
+}
+
+static envuConfidence getConfidence(const Votes *votes, int unknown) {
+    if (votes->result == unknown || votes->hint_only)
+        return ENVU_CONFIDENCE_LOW;
+    return votes->agree >= 2 ? ENVU_CONFIDENCE_HIGH : ENVU_CONFIDENCE_MEDIUM;
+}
+
+// Returns 1 if cpuid reports a hypervisor, 0 if not, or -1 if cpuid is not available.
+static int getCpuidHypervisor(char *vendor) {
+#if defined(__i386__) || defined(__x86_64__)
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0)
+        return -1;
+    if (!((ecx >> 31) & 1))
+        return 0;
+    __cpuid(0x40000000, eax, ebx, ecx, edx);
+    memcpy(vendor, &ebx, 4);
+    memcpy(vendor + 4, &ecx, 4);
+    memcpy(vendor + 8, &edx, 4);
+    vendor[12] = '\0';
+    if (strcmp(vendor, "Microsoft Hv") == 0 && eax >= 0x40000100) {
+        // KVM with Hyper-V enlightenments has its own leaf after the Hyper-V leaves.
+        char kvm[13];
+        __cpuid(0x40000100, eax, ebx, ecx, edx);
+        memcpy(kvm, &ebx, 4);
+        memcpy(kvm + 4, &ecx, 4);
+        memcpy(kvm + 8, &edx, 4);
+        kvm[12] = '\0';
+        if (strcmp(kvm, "KVMKVMKVM") == 0)
+            memcpy(vendor, kvm, 13);
+    }
+    return 1;
+#else
+    (void)vendor;
+    return -1;
+#endif
+}
+
+// Firecracker attaches virtio-mmio devices via the kernel command line.
+static int hasVirtioMmioDevices(void) {
+    char buf[4096];
+    if (envuReadSysFile("/proc/cmdline", buf, sizeof(buf)) > 0 &&
+        strstr(buf, "virtio_mmio.device=") != NULL)
+        return 1;
+    return sysFileExists("/sys/devices/platform/virtio-mmio.0");
+}
+
+static void detectHypervisor(envuVirtualization *virt) {
+    Votes votes = { 0 };
+    char buf[256];
+
+    // cpuid reports the host, so it's meaningless for fixtures.
+    int cpuid = envuHasSysRoot() ? -1 : getCpuidHypervisor(virt->cpuid_vendor);
+    if (cpuid == 1) {
+        int hv = findExact(cpuid_vendors, virt->cpuid_vendor);
+        addVote(&votes, hv > 0 ? hv : ENVU_HV_UNKNOWN, ENVU_HV_UNKNOWN);
+        if (hv > 0)
+            votes.agree++;  // The vendor ID is definitive.
+    }
+
+    if (readLine("/sys/hypervisor/type", buf, sizeof(buf)) == 0 && strcmp(buf, "xen") == 0)
+        addVote(&votes, ENVU_HV_XEN, ENVU_HV_UNKNOWN);
+
+    int has_dmi = sysFileExists("/sys/class/dmi/id");
+    readLine("/sys/class/dmi/id/sys_vendor", virt->dmi_vendor, sizeof(virt->dmi_vendor));
+    readLine("/sys/class/dmi/id/product_name", virt->dmi_product, sizeof(virt->dmi_product));
+    int dmi_hv = findSubstring(dmi_hypervisors, virt->dmi_product);
+    if (dmi_hv == 0)
+        dmi_hv = findSubstring(dmi_hypervisors, virt->dmi_vendor);
+    if (dmi_hv == 0 && readLine("/sys/class/dmi/id/bios_vendor", buf, sizeof(buf)) == 0)
+        dmi_hv = findSubstring(dmi_hypervisors, buf);
+    if (dmi_hv == ENVU_HV_HYPERV && strstr(virt->dmi_vendor, "Microsoft") == NULL)
+        dmi_hv = 0;
+    // QEMU machines with KVM acceleration are reported as KVM.
+    if (dmi_hv == ENVU_HV_QEMU && votes.result == ENVU_HV_KVM)
+        dmi_hv = ENVU_HV_KVM;
+    addVote(&votes, dmi_hv, ENVU_HV_UNKNOWN);
+
+    if (readLine("/proc/sys/kernel/osrelease", buf, sizeof(buf)) == 0 &&
+        (strstr(buf, "microsoft") != NULL || strstr(buf, "Microsoft") != NULL ||
+         strstr(buf, "WSL") != NULL)) {
+        // The "official" way to detect WSL.
+        votes.result = ENVU_HV_WSL;
+        votes.agree = 2;
+    }
+
+    // Firecracker doesn't provide SMBIOS tables, but other KVM machines might not either.
+    if ((votes.result == ENVU_HV_KVM || (votes.result == ENVU_HV_NONE && cpuid != 0)) &&
+        !has_dmi && hasVirtioMmioDevices()) {
+        // virtio-mmio devices alone are just a hint when cpuid is not available.
+        votes.hint_only = votes.result == ENVU_HV_NONE;
+        votes.result = ENVU_HV_FIRECRACKER;
+        votes.agree = 1;
+    }
+
+    virt->hypervisor = (envuHypervisor)votes.result;
+    if (votes.result == ENVU_HV_NONE) {
+        // The hypervisor bit is the most reliable way to detect bare metal.
+        virt->hypervisor_confidence =
+            cpuid == 0 && has_dmi ? ENVU_CONFIDENCE_HIGH :
+            cpuid == 0 || has_dmi ? ENVU_CONFIDENCE_MEDIUM : ENVU_CONFIDENCE_LOW;
+    } else {
+        virt->hypervisor_confidence = getConfidence(&votes, ENVU_HV_UNKNOWN);
+    }
+}
+
+static void detectCloud(envuVirtualization *virt) {
+    char buf[256];
+    int cloud = findSubstring(dmi_clouds, virt->dmi_vendor);
+    if (cloud == 0)
+        cloud = findSubstring(dmi_clouds, virt->dmi_product);
+    if (cloud == 0 && readLine("/sys/class/dmi/id/chassis_asset_tag", buf, sizeof(buf)) == 0)
+        cloud = findSubstring(dmi_clouds, buf);
+    virt->cloud = (envuCloud)cloud;
+}
+
+// Finds "container=..." in /proc/1/environ.
+static int getContainerFromEnviron(void) {
+    size_t size;
+    char *environ = envuReadSysFileAlloc("/proc/1/environ", &size);
+    if (environ == NULL)
+        return 0;
+    int container = 0;
+    for (char *p = environ; p < environ + size; p += strlen(p) + 1) {
+        if (strncmp(p, "container=", 10) == 0) {
+            container = findExact(container_values, p + 10);
+            if (container < 0)
+                container = ENVU_CONTAINER_UNKNOWN;
+            break;
+        }
+    }
+    free(environ);
+    return container;
+}
+
+static void detectContainer(envuVirtualization *virt) {
+    Votes votes = { 0 };
+    char buf[256];
+
+    if (sysFileExists("/.dockerenv"))
+        addVote(&votes, ENVU_CONTAINER_DOCKER, ENVU_CONTAINER_UNKNOWN);
+    if (sysFileExists("/run/.containerenv"))
+        addVote(&votes, ENVU_CONTAINER_PODMAN, ENVU_CONTAINER_UNKNOWN);
+    if (readLine("/run/systemd/container", buf, sizeof(buf)) == 0 && buf[0] != '\0') {
+        int container = findExact(container_values, buf);
+        addVote(&votes, container > 0 ? container : ENVU_CONTAINER_UNKNOWN,
+                ENVU_CONTAINER_UNKNOWN);
+    }
+    addVote(&votes, getContainerFromEnviron(), ENVU_CONTAINER_UNKNOWN);
+
+    char *cgroup = envuReadSysFileAlloc("/proc/1/cgroup", NULL);
+    int has_cgroup = cgroup != NULL;
+    if (has_cgroup) {
+        addVote(&votes, findSubstring(cgroup_containers, cgroup), ENVU_CONTAINER_UNKNOWN);
+        free(cgroup);
+    }
+
+    // gVisor reports a fixed kernel version.
+    // It wins over other markers because runsc also runs Docker and Podman containers.
+    if (envuReadSysFile("/proc/version", buf, sizeof(buf)) > 0 &&
+        strstr(buf, "#1 SMP Sun Jan 10 15:06:54 PST 2016") != NULL) {
+        votes.result = ENVU_CONTAINER_GVISOR;
+        votes.agree = 1;
+    }
+
+    virt->container = (envuContainer)votes.result;
+    if (votes.result == ENVU_CONTAINER_NONE)
+        virt->container_confidence = has_cgroup ? ENVU_CONFIDENCE_MEDIUM : ENVU_CONFIDENCE_LOW;
+    else
+        virt->container_confidence = getConfidence(&votes, ENVU_CONTAINER_UNKNOWN);
+}
+
+static envuVirtualization *createVirtualization(void) {
+    envuVirtualization *virt = calloc(1, sizeof(envuVirtualization));
+    if (virt == NULL)
+        return NULL;
+    detectHypervisor(virt);
+    detectCloud(virt);
+    detectContainer(virt);
+    virt->hypervisor_name = hypervisor_names[virt->hypervisor];
+    virt->container_name = container_names[virt->container];
+    virt->cloud_name = cloud_names[virt->cloud];
+    return virt;
+}
+
+static envuVirtualization *virtualization = NULL;
+static unsigned int virtualization_gen = 0;
+static pthread_mutex_t virtualization_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+const envuVirtualization *getVirtualizationLinux(void) {
+    unsigned int gen = envuGetSysRootGen();
+    pthread_mutex_lock(&virtualization_mutex);
+    if (virtualization == NULL || virtualization_gen != gen) {
+        // Note: Old results are not freed because callers might still use them.
+        virtualization = createVirtualization();
+        virtualization_gen = gen;
+    }
+    const envuVirtualization *virt = virtualization;
+    pthread_mutex_unlock(&virtualization_mutex);
+    return virt;
+}
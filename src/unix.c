@@ -3,6 +3,8 @@
 #ifdef __APPLE__
 #include <CoreFoundation/CoreFoundation.h>
 #include <mach-o/dyld.h>
+// for envuGetResourceLimits()
+#include <sys/sysctl.h>
 #elif defined(__FreeBSD__) || defined(__OpenBSD__)
 // for GetExecutablePath()
 #include <sys/param.h>
@@ -12,15 +14,36 @@
 #include <kernel/image.h>
 #endif
 
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <sys/resource.h>
 #include <sys/utsname.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <pwd.h>
 #include <limits.h>
 #include <libgen.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
 #include <string.h>
 #include <stdio.h>
 
+#ifdef __linux__
+// for snapshots
+#include <sys/auxv.h>
+#include <sys/syscall.h>
+// for envuGetFastScratchDir()
+#include <sys/statfs.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+// for envuGetClockInfo()
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
 #include "env_utils.h"
 #include "env_utils_priv.h"
 
@@ -80,6 +103,300 @@ char *envuGetRealPath(const char *path) {
     return envuAllocStrWithConst(resolved);
 }
 
+// Snapshots of environment information shared with child processes.
+#define SNAPSHOT_ENV "ENVU_SNAPSHOT"
+#define SNAPSHOT_MAGIC "ENVUSNAP"
+#define SNAPSHOT_FORMAT 1
+#define SNAPSHOT_MAX_SIZE (1024 * 1024)
+
+#if defined(__linux__) && defined(SYS_memfd_create) && defined(F_ADD_SEALS)
+#define SNAPSHOT_USE_MEMFD
+#ifndef MFD_ALLOW_SEALING
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+#define SNAPSHOT_SEALS (F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE)
+#endif
+
+enum {
+    SNAP_EXE_PATH,
+    SNAP_OS,
+    SNAP_OS_VERSION,
+    SNAP_OS_PRODUCT_NAME,
+    SNAP_HOME,
+    SNAP_USERNAME,
+    SNAP_FIELD_MAX,
+};
+
+typedef struct SnapshotHeader {
+    char magic[8];
+    uint32_t format;
+    uint32_t lib_version;
+    uint32_t header_size;
+    uint32_t total_size;
+    uint32_t uid;
+    uint32_t checksum;
+    // Offsets to null-terminated strings. 0 means the value was not available.
+    uint32_t offsets[SNAP_FIELD_MAX];
+} SnapshotHeader;
+
+static const SnapshotHeader *attached_snapshot = NULL;
+static unsigned int attached_fields = 0;  // bit flags of fields that can be served
+static int published_fd = -1;
+static char published_name[32] = { 0 };
+
+static uint32_t fnv1a(const unsigned char *p, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char *end = p + size; p < end; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static const char *getSnapshotStr(int field) {
+    const SnapshotHeader *snap = attached_snapshot;
+    if (snap == NULL || !(attached_fields & (1u << field)))
+        return NULL;
+    return (const char *)snap + snap->offsets[field];
+}
+
+static unsigned char *buildSnapshot(uint32_t *size) {
+    char *values[SNAP_FIELD_MAX];
+    values[SNAP_EXE_PATH] = envuGetExecutablePath();
+    values[SNAP_OS] = envuGetOS();
+    values[SNAP_OS_VERSION] = envuGetOSVersion();
+    values[SNAP_OS_PRODUCT_NAME] = envuGetOSProductName();
+    values[SNAP_HOME] = envuGetHome();
+    values[SNAP_USERNAME] = envuGetUsername();
+
+    size_t total_size = sizeof(SnapshotHeader);
+    for (int i = 0; i < SNAP_FIELD_MAX; i++) {
+        if (values[i] != NULL)
+            total_size += strlen(values[i]) + 1;
+    }
+
+    unsigned char *buf = NULL;
+    if (total_size <= SNAPSHOT_MAX_SIZE)
+        buf = calloc(total_size, 1);
+    if (buf != NULL) {
+        SnapshotHeader *header = (SnapshotHeader *)buf;
+        memcpy(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic));
+        header->format = SNAPSHOT_FORMAT;
+        header->lib_version = ENVU_VERSION_INT;
+        header->header_size = sizeof(SnapshotHeader);
+        header->total_size = (uint32_t)total_size;
+        header->uid = (uint32_t)getuid();
+
+        size_t offset = sizeof(SnapshotHeader);
+        for (int i = 0; i < SNAP_FIELD_MAX; i++) {
+            if (values[i] == NULL)
+                continue;
+            size_t len = strlen(values[i]) + 1;
+            memcpy(buf + offset, values[i], len);
+            header->offsets[i] = (uint32_t)offset;
+            offset += len;
+        }
+        header->checksum = fnv1a(buf + sizeof(SnapshotHeader),
+                                 total_size - sizeof(SnapshotHeader));
+        *size = (uint32_t)total_size;
+    }
+
+    for (int i = 0; i < SNAP_FIELD_MAX; i++)
+        envuFree(values[i]);
+    return buf;
+}
+
+static int writeAll(int fd, const unsigned char *buf, size_t size) {
+    while (size > 0) {
+        ssize_t ret = write(fd, buf, size);
+        if (ret < 0)
+            return -1;
+        buf += ret;
+        size -= (size_t)ret;
+    }
+    return 0;
+}
+
+int envuPublishSnapshot(void) {
+    envuUnpublishSnapshot();
+
+    uint32_t size;
+    unsigned char *buf = buildSnapshot(&size);
+    if (buf == NULL)
+        return -1;
+
+    char value[64];
+#ifdef SNAPSHOT_USE_MEMFD
+    // Note: The fd should be inherited by child processes. So, we don't use MFD_CLOEXEC here.
+    int fd = (int)syscall(SYS_memfd_create, "envu-snapshot", MFD_ALLOW_SEALING);
+    if (fd == -1) {
+        free(buf);
+        return -1;
+    }
+    if (writeAll(fd, buf, size) != 0 ||
+        fcntl(fd, F_ADD_SEALS, SNAPSHOT_SEALS | F_SEAL_SEAL) != 0) {
+        close(fd);
+        free(buf);
+        return -1;
+    }
+    free(buf);
+    snprintf(value, sizeof(value), "fd:%d", fd);
+    published_fd = fd;
+#elif defined(__serenity__)
+    free(buf);
+    return -1;
+#else
+    // Use a read-only POSIX shared memory object instead of a sealed memfd.
+    snprintf(published_name, sizeof(published_name), "/envu-snapshot-%d", (int)getpid());
+    shm_unlink(published_name);
+    int fd = shm_open(published_name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd == -1) {
+        free(buf);
+        published_name[0] = '\0';
+        return -1;
+    }
+    int ret = writeAll(fd, buf, size);
+    if (ret == 0)
+        ret = fchmod(fd, 0400);
+    close(fd);
+    free(buf);
+    if (ret != 0) {
+        envuUnpublishSnapshot();
+        return -1;
+    }
+    snprintf(value, sizeof(value), "shm:%s", published_name);
+#endif
+    if (envuSetEnv(SNAPSHOT_ENV, value) != 0) {
+        envuUnpublishSnapshot();
+        return -1;
+    }
+    return 0;
+}
+
+void envuUnpublishSnapshot(void) {
+    if (published_fd == -1 && published_name[0] == '\0')
+        return;
+    if (published_fd != -1)
+        close(published_fd);
+#ifndef __serenity__
+    if (published_name[0] != '\0')
+        shm_unlink(published_name);
+#endif
+    published_fd = -1;
+    published_name[0] = '\0';
+    envuSetEnv(SNAPSHOT_ENV, NULL);
+}
+
+// Returns bit flags of valid fields. Or 0 if the snapshot is broken or incompatible.
+static unsigned int validateSnapshot(const unsigned char *buf, size_t size) {
+    const SnapshotHeader *header = (const SnapshotHeader *)buf;
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->format != SNAPSHOT_FORMAT ||
+        header->lib_version != ENVU_VERSION_INT ||
+        header->header_size != sizeof(SnapshotHeader) ||
+        header->total_size != size ||
+        buf[size - 1] != '\0')
+        return 0;
+    if (header->checksum != fnv1a(buf + sizeof(SnapshotHeader), size - sizeof(SnapshotHeader)))
+        return 0;
+
+    unsigned int fields = 0;
+    for (int i = 0; i < SNAP_FIELD_MAX; i++) {
+        uint32_t offset = header->offsets[i];
+        if (offset == 0)
+            continue;
+        if (offset < sizeof(SnapshotHeader) || offset >= size)
+            return 0;
+        fields |= 1u << i;
+    }
+
+    // User information is stale when the uid was changed.
+    if (header->uid != (uint32_t)getuid())
+        fields &= ~((1u << SNAP_HOME) | (1u << SNAP_USERNAME));
+
+    // The executable path is only valid for processes that run the same executable.
+    unsigned int exe_flag = 1u << SNAP_EXE_PATH;
+    fields &= ~exe_flag;
+#ifdef __linux__
+    const char *execfn = (const char *)getauxval(AT_EXECFN);
+    if (header->offsets[SNAP_EXE_PATH] != 0 && execfn != NULL &&
+        strcmp(execfn, (const char *)buf + header->offsets[SNAP_EXE_PATH]) == 0)
+        fields |= exe_flag;
+#endif
+    return fields;
+}
+
+int envuAttachSnapshot(void) {
+    if (attached_snapshot != NULL)
+        return 0;
+
+    const char *value = getenv(SNAPSHOT_ENV);
+    if (value == NULL)
+        return -1;
+
+    int fd = -1;
+    int need_close = 0;
+    if (strncmp(value, "fd:", 3) == 0) {
+#ifdef SNAPSHOT_USE_MEMFD
+        char *end;
+        long num = strtol(value + 3, &end, 10);
+        if (end == value + 3 || *end != '\0' || num < 0 || num > INT_MAX)
+            return -1;
+        fd = (int)num;
+        // Reject snapshots that can still be modified.
+        int seals = fcntl(fd, F_GET_SEALS);
+        if (seals == -1 || (seals & SNAPSHOT_SEALS) != SNAPSHOT_SEALS)
+            return -1;
+#else
+        return -1;
+#endif
+    } else if (strncmp(value, "shm:", 4) == 0) {
+#ifdef __serenity__
+        return -1;
+#else
+        fd = shm_open(value + 4, O_RDONLY, 0);
+        if (fd == -1)
+            return -1;
+        need_close = 1;
+#endif
+    } else {
+        return -1;
+    }
+
+    struct stat st;
+    int ret = fstat(fd, &st);
+    if (ret != 0 || st.st_size < (off_t)sizeof(SnapshotHeader) ||
+        st.st_size > SNAPSHOT_MAX_SIZE || (need_close && (st.st_mode & 0222))) {
+        if (need_close)
+            close(fd);
+        return -1;
+    }
+    size_t size = (size_t)st.st_size;
+    void *p = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (need_close)
+        close(fd);
+    if (p == MAP_FAILED)
+        return -1;
+
+    unsigned int fields = validateSnapshot((const unsigned char *)p, size);
+    if (fields == 0) {
+        munmap(p, size);
+        return -1;
+    }
+    attached_fields = fields;
+    attached_snapshot = (const SnapshotHeader *)p;
+    return 0;
+}
+
+void envuDetachSnapshot(void) {
+    const SnapshotHeader *snap = attached_snapshot;
+    if (snap == NULL)
+        return;
+    attached_snapshot = NULL;
+    attached_fields = 0;
+    munmap((void *)snap, snap->total_size);
+}
+
 #ifdef __APPLE__
 // macOS requires _NSGetExecutablePath to get the executable path.
 static inline char *getExecutablePathApple(void) {
@@ -240,6 +557,9 @@ static inline char *getExecutablePathProcfs(void) {
 #endif
 
 char *envuGetExecutablePath(void) {
+    const char *cached = getSnapshotStr(SNAP_EXE_PATH);
+    if (cached != NULL)
+        return envuAllocStrWithConst(cached);
 #ifdef __APPLE__
     return getExecutablePathApple();
 #elif defined(__FreeBSD__)
@@ -359,10 +679,136 @@ char *envuGetCwd(void) {
     return envuAllocStrWithConst(ret);
 }
 
+// Preformatted crash info for envuWriteCrashInfo().
+// Writers fill a slot that no reader uses and publish its index,
+// so signal handlers never see a half-written header or path.
+#define CRASH_HEADER_MAX 4096
+#define CRASH_SLOT_COUNT 3
+typedef struct CrashInfo {
+    char header[CRASH_HEADER_MAX];
+    size_t header_len;
+    char cwd[PATH_MAX + 8];
+    size_t cwd_len;
+} CrashInfo;
+static CrashInfo crash_slots[CRASH_SLOT_COUNT];
+static int crash_readers[CRASH_SLOT_COUNT];
+static int crash_index = -1;  // -1 until envuPrepareCrashInfo() is called.
+static int crash_writing = 0;
+
+// Publishes a new slot. It keeps the current header if header is a null pointer.
+static void publishCrashInfo(const char *header, size_t header_len) {
+    // Serialize writers. Readers (signal handlers) never wait.
+    while (__atomic_exchange_n(&crash_writing, 1, __ATOMIC_ACQUIRE)) {
+    }
+    int cur = __atomic_load_n(&crash_index, __ATOMIC_RELAXED);
+    if (header == NULL && cur < 0) {
+        // Not prepared yet.
+        __atomic_store_n(&crash_writing, 0, __ATOMIC_RELEASE);
+        return;
+    }
+    // Skip slots being read. Readers only write() the slot, so this ends soon.
+    int next = -1;
+    while (next < 0) {
+        for (int i = 0; i < CRASH_SLOT_COUNT; i++) {
+            if (i != cur && __atomic_load_n(&crash_readers[i], __ATOMIC_SEQ_CST) == 0) {
+                next = i;
+                break;
+            }
+        }
+    }
+    CrashInfo *slot = &crash_slots[next];
+    if (header == NULL) {
+        header = crash_slots[cur].header;
+        header_len = crash_slots[cur].header_len;
+    }
+    memcpy(slot->header, header, header_len);
+    slot->header_len = header_len;
+    memcpy(slot->cwd, "CWD: ", 5);
+    if (getcwd(slot->cwd + 5, PATH_MAX) == NULL)
+        memcpy(slot->cwd + 5, "(null)", 7);
+    size_t len = strlen(slot->cwd);
+    slot->cwd[len] = '\n';
+    slot->cwd_len = len + 1;
+    __atomic_store_n(&crash_index, next, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&crash_writing, 0, __ATOMIC_RELEASE);
+}
+
+static void updateCrashCwd(void) {
+    publishCrashInfo(NULL, 0);
+}
+
+int envuPrepareCrashInfo(void) {
+    char *exe_path = envuGetExecutablePath();
+    char *os = envuGetOS();
+    char *os_ver = envuGetOSVersion();
+    char *os_pn = envuGetOSProductName();
+    char *username = envuGetUsername();
+
+    char header[CRASH_HEADER_MAX];
+    int len = snprintf(header, CRASH_HEADER_MAX,
+                       "Executable: %s\nOS: %s %s\nOS product name: %s\nUser: %s\n",
+                       exe_path ? exe_path : "(null)",
+                       os ? os : "(null)", os_ver ? os_ver : "(null)",
+                       os_pn ? os_pn : "(null)",
+                       username ? username : "(null)");
+    envuFree(exe_path);
+    envuFree(os);
+    envuFree(os_ver);
+    envuFree(os_pn);
+    envuFree(username);
+    if (len < 0)
+        return -1;
+    if (len >= CRASH_HEADER_MAX) {
+        // truncated
+        len = CRASH_HEADER_MAX - 1;
+        header[len - 1] = '\n';
+    }
+    publishCrashInfo(header, (size_t)len);
+    return 0;
+}
+
+static int writeAllSignalSafe(int fd, const char *buf, size_t size) {
+    while (size > 0) {
+        ssize_t ret = write(fd, buf, size);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        buf += ret;
+        size -= (size_t)ret;
+    }
+    return 0;
+}
+
+int envuWriteCrashInfo(int fd) {
+    // Pin the published slot. Retry if a writer published another one in the meantime.
+    int index;
+    while (1) {
+        index = __atomic_load_n(&crash_index, __ATOMIC_SEQ_CST);
+        if (index < 0)
+            return -1;
+        __atomic_add_fetch(&crash_readers[index], 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&crash_index, __ATOMIC_SEQ_CST) == index)
+            break;
+        __atomic_sub_fetch(&crash_readers[index], 1, __ATOMIC_SEQ_CST);
+    }
+    int saved_errno = errno;
+    const CrashInfo *slot = &crash_slots[index];
+    int ret = writeAllSignalSafe(fd, slot->header, slot->header_len);
+    if (ret == 0)
+        ret = writeAllSignalSafe(fd, slot->cwd, slot->cwd_len);
+    __atomic_sub_fetch(&crash_readers[index], 1, __ATOMIC_SEQ_CST);
+    errno = saved_errno;
+    return ret;
+}
+
 int envuSetCwd(const char *path) {
     if (path == NULL)
         return -1;
     int ret = chdir(path);
+    if (ret == 0)
+        updateCrashCwd();
     return -(ret != 0);
 }
 
@@ -410,6 +856,10 @@ static struct passwd *getpwuid_safe(char **buf) {
 }
 
 char *envuGetHome(void) {
+    const char *cached = getSnapshotStr(SNAP_HOME);
+    if (cached != NULL)
+        return envuAllocStrWithConst(cached);
+
     char *buf;
     struct passwd *p = getpwuid_safe(&buf);
 
@@ -428,7 +878,29 @@ char *envuGetHome(void) {
     return str;
 }
 
+// Removes trailing slashes except the root.
+static void removeTrailingSlashes(char *path) {
+    size_t len = strlen(path);
+    while (len > 1 && path[len - 1] == '/')
+        path[--len] = '\0';
+}
+
+char *envuGetTempDir(void) {
+    char *dir = envuGetEnv("TMPDIR");
+    if (dir == NULL || dir[0] == '\0') {
+        envuFree(dir);
+        dir = envuAllocStrWithConst("/tmp");
+    }
+    if (dir != NULL)
+        removeTrailingSlashes(dir);  // macOS uses "/var/folders/.../T/"
+    return dir;
+}
+
 char *envuGetUsername(void) {
+    const char *cached = getSnapshotStr(SNAP_USERNAME);
+    if (cached != NULL)
+        return envuAllocStrWithConst(cached);
+
     char *buf;
     struct passwd *p = getpwuid_safe(&buf);
 
@@ -449,8 +921,138 @@ char *envuGetUsername(void) {
     return str;
 }
 
+static int toRlimitResource(envuResource resource) {
+    switch (resource) {
+#ifdef RLIMIT_AS
+    case ENVU_RLIMIT_AS: return RLIMIT_AS;
+#endif
+    case ENVU_RLIMIT_CORE: return RLIMIT_CORE;
+    case ENVU_RLIMIT_CPU: return RLIMIT_CPU;
+    case ENVU_RLIMIT_DATA: return RLIMIT_DATA;
+    case ENVU_RLIMIT_FSIZE: return RLIMIT_FSIZE;
+#ifdef RLIMIT_MEMLOCK
+    case ENVU_RLIMIT_MEMLOCK: return RLIMIT_MEMLOCK;
+#endif
+#ifdef RLIMIT_MSGQUEUE
+    case ENVU_RLIMIT_MSGQUEUE: return RLIMIT_MSGQUEUE;
+#endif
+#ifdef RLIMIT_NICE
+    case ENVU_RLIMIT_NICE: return RLIMIT_NICE;
+#endif
+    case ENVU_RLIMIT_NOFILE: return RLIMIT_NOFILE;
+#ifdef RLIMIT_NPROC
+    case ENVU_RLIMIT_NPROC: return RLIMIT_NPROC;
+#endif
+#ifdef RLIMIT_RSS
+    case ENVU_RLIMIT_RSS: return RLIMIT_RSS;
+#endif
+#ifdef RLIMIT_RTPRIO
+    case ENVU_RLIMIT_RTPRIO: return RLIMIT_RTPRIO;
+#endif
+#ifdef RLIMIT_RTTIME
+    case ENVU_RLIMIT_RTTIME: return RLIMIT_RTTIME;
+#endif
+#ifdef RLIMIT_SIGPENDING
+    case ENVU_RLIMIT_SIGPENDING: return RLIMIT_SIGPENDING;
+#endif
+    case ENVU_RLIMIT_STACK: return RLIMIT_STACK;
+    default: return -1;
+    }
+}
+
+static uint64_t fromRlim(rlim_t value) {
+    return value == RLIM_INFINITY ? ENVU_RLIM_INFINITY : (uint64_t)value;
+}
+
+static rlim_t toRlim(uint64_t value) {
+    return value == ENVU_RLIM_INFINITY ? RLIM_INFINITY : (rlim_t)value;
+}
+
+#if defined(__APPLE__) || defined(__FreeBSD__)
+static long long getSysctlInt(const char *name) {
+    int value;
+    size_t size = sizeof(value);
+    if (sysctlbyname(name, &value, &size, NULL, 0) != 0)
+        return -1;
+    return value;
+}
+#endif
+
+int envuGetResourceLimits(envuResourceLimits *out) {
+    if (out == NULL)
+        return -1;
+    envuInitResourceLimits(out);
+    for (int i = 0; i < ENVU_RLIMIT_MAX; i++) {
+        int resource = toRlimitResource((envuResource)i);
+        struct rlimit rl;
+        if (resource < 0 || getrlimit(resource, &rl) != 0)
+            continue;
+        envuResourceLimit *limit = &out->limits[i];
+        limit->supported = 1;
+        limit->soft = fromRlim(rl.rlim_cur);
+        limit->hard = fromRlim(rl.rlim_max);
+    }
+#ifdef __linux__
+    static const char *names[] = {
+        "fs.nr_open", "fs.file-max", "kernel.threads-max", "kernel.pid_max"
+    };
+    long long values[4];
+    int found[4];
+    if (envuReadSysctls(names, 4, values, found) > 0) {
+        long long *caps[] = { &out->nr_open, &out->file_max, &out->threads_max, &out->pid_max };
+        for (int i = 0; i < 4; i++) {
+            if (found[i])
+                *caps[i] = values[i];
+        }
+    }
+#elif defined(__APPLE__) || defined(__FreeBSD__)
+    out->nr_open = getSysctlInt("kern.maxfilesperproc");
+    out->file_max = getSysctlInt("kern.maxfiles");
+    out->threads_max = getSysctlInt("kern.maxproc");
+#endif
+    return 0;
+}
+
+int envuRaiseLimit(envuResource resource, uint64_t desired, uint64_t *achieved) {
+    if (achieved != NULL)
+        *achieved = 0;
+    int res = toRlimitResource(resource);
+    struct rlimit rl;
+    if (res < 0 || getrlimit(res, &rl) != 0)
+        return -1;
+    uint64_t soft = fromRlim(rl.rlim_cur);
+    uint64_t hard = fromRlim(rl.rlim_max);
+    uint64_t target = desired < hard ? desired : hard;
+    // The highest soft limit that the platform accepts.
+    uint64_t max = hard;
+    if (soft < target) {
+        rl.rlim_cur = toRlim(target);
+        int ret = setrlimit(res, &rl);
+#ifdef __APPLE__
+        // macOS rejects RLIMIT_NOFILE above OPEN_MAX even if the hard limit is unlimited.
+        if (ret != 0 && resource == ENVU_RLIMIT_NOFILE && target > OPEN_MAX &&
+            soft <= OPEN_MAX) {
+            target = max = OPEN_MAX;
+            rl.rlim_cur = toRlim(target);
+            ret = setrlimit(res, &rl);
+        }
+#endif
+        if (ret == 0)
+            soft = target;
+    }
+    if (achieved != NULL)
+        *achieved = soft;
+    if (desired == ENVU_RLIM_INFINITY)
+        return soft == max ? 0 : -1;
+    return soft >= desired ? 0 : -1;
+}
+
 // Darwin, Linux, FreeBSD, OpenBSD, NetBSD, Haiku, SunOS, etc.
 char *envuGetOS(void) {
+    const char *cached = getSnapshotStr(SNAP_OS);
+    if (cached != NULL)
+        return envuAllocStrWithConst(cached);
+
     struct utsname buf = { 0 };
     // Note: uname(&buf) can be positive on Solaris
     if (uname(&buf) == -1) {
@@ -460,6 +1062,10 @@ char *envuGetOS(void) {
 }
 
 char *envuGetOSVersion(void) {
+    const char *cached = getSnapshotStr(SNAP_OS_VERSION);
+    if (cached != NULL)
+        return envuAllocStrWithConst(cached);
+
     struct utsname buf = { 0 };
     // Note: uname(&buf) can be positive on Solaris
     if (uname(&buf) == -1) {
@@ -649,6 +1255,10 @@ static inline char *getOSProductNameOthers(void) {
 #endif
 
 char *envuGetOSProductName(void) {
+    const char *cached = getSnapshotStr(SNAP_OS_PRODUCT_NAME);
+    if (cached != NULL)
+        return envuAllocStrWithConst(cached);
+
 #ifdef __APPLE__
     return getOSProductNameApple();
 #elif defined(__linux__)
@@ -661,3 +1271,803 @@ char *envuGetOSProductName(void) {
     return getOSProductNameOthers();
 #endif
 }
+
+const envuKernelFeatures *envuGetKernelFeatures(void) {
+#ifdef __linux__
+    return getKernelFeaturesLinux();
+#else
+    return NULL;
+#endif
+}
+
+#ifdef __x86_64__
+// envuNowNs() can read the TSC.
+#define ENVU_NOW_HAS_TSC
+#endif
+
+static envuClockInfo clock_info;
+static pthread_once_t clock_info_once = PTHREAD_ONCE_INIT;
+static pthread_once_t now_source_once = PTHREAD_ONCE_INIT;
+static int now_use_tsc = 0;
+#ifdef ENVU_NOW_HAS_TSC
+// The TSC is scaled from the last anchor, and re-anchored to CLOCK_MONOTONIC periodically.
+// Anchors are published with a sequence counter. (odd while updating)
+static unsigned int now_seq = 0;
+static uint64_t now_tsc_base = 0;
+static uint64_t now_ns_base = 0;
+// Nanoseconds per tick in 32.32 fixed point. 0 until the TSC is calibrated.
+static uint64_t now_tsc_mult = 0;
+// Ticks until the next anchor
+static uint64_t now_tsc_interval = 0;
+// The last CLOCK_MONOTONIC sample to measure the TSC frequency. Guarded by now_anchoring.
+static int now_anchoring = 0;
+static uint64_t now_sample_ns = 0;
+static uint64_t now_sample_tsc = 0;
+
+// The TSC frequency is measured in 100ms before the TSC is used without cpuid.
+#define NOW_CALIBRATION_NS 100000000ULL
+#define NOW_ANCHOR_INTERVAL_NS 1000000000ULL
+#endif
+
+static uint64_t getMonotonicNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static double measureClockCost(clockid_t clock) {
+    struct timespec ts;
+    const int count = 1000;
+    for (int i = 0; i < 10; i++)
+        clock_gettime(clock, &ts);
+    uint64_t start = getMonotonicNs();
+    for (int i = 0; i < count; i++)
+        clock_gettime(clock, &ts);
+    return (double)(getMonotonicNs() - start) / count;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+static uint64_t getTscHzFromCpuid(void) {
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid_max(0, NULL) >= 0x15) {
+        // The ratio of the TSC to the core crystal clock
+        __cpuid_count(0x15, 0, eax, ebx, ecx, edx);
+        if (eax != 0 && ebx != 0 && ecx != 0)
+            return (uint64_t)ecx * ebx / eax;
+    }
+    __cpuid(1, eax, ebx, ecx, edx);
+    if ((ecx >> 31) & 1) {
+        // Hypervisors report the TSC frequency in kHz.
+        __cpuid(0x40000000, eax, ebx, ecx, edx);
+        if (eax >= 0x40000010) {
+            __cpuid(0x40000010, eax, ebx, ecx, edx);
+            if (eax != 0)
+                return (uint64_t)eax * 1000;
+        }
+    }
+    return 0;
+}
+#endif
+
+#ifdef ENVU_NOW_HAS_TSC
+// Scales ticks with a 32.32 fixed point multiplier without 128-bit integers.
+static uint64_t scaleTsc(uint64_t ticks, uint64_t mult) {
+    uint64_t hi = ticks >> 32;
+    uint64_t lo = ticks & 0xFFFFFFFFULL;
+    return hi * mult + ((lo * mult) >> 32);
+}
+
+typedef struct NowAnchor {
+    uint64_t tsc_base;
+    uint64_t ns_base;
+    uint64_t mult;
+    uint64_t interval;
+} NowAnchor;
+
+static void loadNowAnchor(NowAnchor *anchor) {
+    unsigned int seq;
+    do {
+        seq = __atomic_load_n(&now_seq, __ATOMIC_ACQUIRE);
+        anchor->tsc_base = __atomic_load_n(&now_tsc_base, __ATOMIC_RELAXED);
+        anchor->ns_base = __atomic_load_n(&now_ns_base, __ATOMIC_RELAXED);
+        anchor->mult = __atomic_load_n(&now_tsc_mult, __ATOMIC_RELAXED);
+        anchor->interval = __atomic_load_n(&now_tsc_interval, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || seq != __atomic_load_n(&now_seq, __ATOMIC_RELAXED));
+}
+
+static void storeNowAnchor(const NowAnchor *anchor) {
+    __atomic_store_n(&now_seq, now_seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&now_tsc_base, anchor->tsc_base, __ATOMIC_RELAXED);
+    __atomic_store_n(&now_ns_base, anchor->ns_base, __ATOMIC_RELAXED);
+    __atomic_store_n(&now_tsc_mult, anchor->mult, __ATOMIC_RELAXED);
+    __atomic_store_n(&now_tsc_interval, anchor->interval, __ATOMIC_RELAXED);
+    __atomic_store_n(&now_seq, now_seq + 1, __ATOMIC_RELEASE);
+}
+
+// Re-anchors the TSC to CLOCK_MONOTONIC, and measures its frequency since the last sample.
+// It never goes back from the time that the old anchor reports.
+static uint64_t anchorTsc(const NowAnchor *old) {
+    if (__atomic_exchange_n(&now_anchoring, 1, __ATOMIC_ACQUIRE)) {
+        // Another thread is updating the anchor.
+        if (old->mult == 0)
+            return getMonotonicNs();
+        return old->ns_base + scaleTsc(__rdtsc() - old->tsc_base, old->mult);
+    }
+    uint64_t ns = getMonotonicNs();
+    uint64_t tsc = __rdtsc();
+    uint64_t elapsed_ns = ns - now_sample_ns;
+    if (old->mult == 0 && elapsed_ns < NOW_CALIBRATION_NS) {
+        __atomic_store_n(&now_anchoring, 0, __ATOMIC_RELEASE);
+        return ns;
+    }
+    double ns_per_tick = (double)elapsed_ns / (double)(tsc - now_sample_tsc);
+    NowAnchor anchor;
+    anchor.tsc_base = tsc;
+    anchor.ns_base = ns;
+    if (old->mult != 0) {
+        uint64_t prev = old->ns_base + scaleTsc(tsc - old->tsc_base, old->mult);
+        if (prev > ns)
+            anchor.ns_base = prev;
+    }
+    anchor.mult = (uint64_t)(ns_per_tick * 4294967296.0);
+    anchor.interval = (uint64_t)((double)NOW_ANCHOR_INTERVAL_NS / ns_per_tick);
+    storeNowAnchor(&anchor);
+    now_sample_ns = ns;
+    now_sample_tsc = tsc;
+    __atomic_store_n(&now_anchoring, 0, __ATOMIC_RELEASE);
+    return anchor.ns_base;
+}
+#endif
+
+static void getTscFlags(envuClockInfo *info) {
+#ifdef __linux__
+    char *cpuinfo = envuReadSysFileAlloc("/proc/cpuinfo", NULL);
+    if (cpuinfo == NULL)
+        return;
+    char *flags = strstr(cpuinfo, "\nflags");
+    if (flags != NULL) {
+        char *end = strchr(flags + 1, '\n');
+        if (end != NULL)
+            *end = '\0';
+        flags = strchr(flags, ':');
+        if (flags != NULL) {
+            info->constant_tsc = envuHasWord(flags + 1, "constant_tsc");
+            info->nonstop_tsc = envuHasWord(flags + 1, "nonstop_tsc");
+        }
+    }
+    free(cpuinfo);
+#elif defined(__x86_64__) || defined(__i386__)
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid_max(0x80000000, NULL) >= 0x80000007) {
+        // Invariant TSC implies both of them.
+        __cpuid(0x80000007, eax, ebx, ecx, edx);
+        info->constant_tsc = info->nonstop_tsc = (edx >> 8) & 1;
+    }
+#else
+    (void)info;
+#endif
+}
+
+#ifdef __linux__
+// Clocksources that the vDSO can read without syscalls.
+static const char *vdso_clocksources[] = {
+    "tsc", "kvm-clock", "arch_sys_counter", "hyperv_clocksource_tsc_page",
+    "riscv_clocksource", NULL
+};
+
+static void readClocksource(const char *name, char *buf, size_t size) {
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/clocksource/clocksource0/%s", name);
+    if (envuReadSysFile(path, buf, size) <= 0) {
+        buf[0] = '\0';
+        return;
+    }
+    buf[strcspn(buf, "\n")] = '\0';
+    // remove the last space of available_clocksource
+    size_t len = strlen(buf);
+    while (len > 0 && buf[len - 1] == ' ')
+        buf[--len] = '\0';
+}
+#endif
+
+// Selects the source of envuNowNs(). It doesn't measure costs of clocks.
+static void initNowSource(void) {
+    envuClockInfo *info = &clock_info;
+#ifdef __linux__
+    readClocksource("current_clocksource", info->current_clocksource,
+                    sizeof(info->current_clocksource));
+    readClocksource("available_clocksource", info->available_clocksources,
+                    sizeof(info->available_clocksources));
+    for (const char **p = vdso_clocksources; *p != NULL; p++) {
+        if (strcmp(info->current_clocksource, *p) == 0)
+            info->vdso = 1;
+    }
+#endif
+    getTscFlags(info);
+#if defined(__x86_64__) || defined(__i386__)
+    info->tsc_hz = getTscHzFromCpuid();
+#endif
+
+    info->now_source = ENVU_NOW_MONOTONIC;
+#ifdef ENVU_NOW_HAS_TSC
+    // Only trust the TSC when the kernel uses it. Then, rdtsc is also cheaper than the vDSO.
+    if (strcmp(info->current_clocksource, "tsc") == 0 &&
+        info->constant_tsc && info->nonstop_tsc) {
+        now_sample_ns = getMonotonicNs();
+        now_sample_tsc = __rdtsc();
+        NowAnchor anchor = { now_sample_tsc, now_sample_ns, 0, 0 };
+        // Nanoseconds per tick should fit in 32 bits of the fixed point multiplier.
+        // Without the frequency from cpuid, it's measured by envuNowNs() later.
+        if (info->tsc_hz >= 1000000000ULL) {
+            anchor.mult = (1000000000ULL << 32) / info->tsc_hz;
+            anchor.interval = NOW_ANCHOR_INTERVAL_NS / 1000000000ULL * info->tsc_hz;
+        }
+        storeNowAnchor(&anchor);
+        info->now_source = ENVU_NOW_TSC;
+    }
+#endif
+    __atomic_store_n(&now_use_tsc, info->now_source == ENVU_NOW_TSC, __ATOMIC_RELEASE);
+}
+
+static void initClockInfo(void) {
+    envuClockInfo *info = &clock_info;
+    pthread_once(&now_source_once, initNowSource);
+    info->monotonic_ns = measureClockCost(CLOCK_MONOTONIC);
+#ifdef CLOCK_MONOTONIC_COARSE
+    struct timespec res;
+    if (clock_getres(CLOCK_MONOTONIC_COARSE, &res) == 0) {
+        info->coarse_resolution_ns = (uint64_t)res.tv_sec * 1000000000ULL + res.tv_nsec;
+        info->coarse_ns = measureClockCost(CLOCK_MONOTONIC_COARSE);
+    }
+#endif
+}
+
+const envuClockInfo *envuGetClockInfo(void) {
+    pthread_once(&clock_info_once, initClockInfo);
+    return &clock_info;
+}
+
+uint64_t envuNowNs(void) {
+    // Costs of clocks are not needed here, so skip envuGetClockInfo().
+    pthread_once(&now_source_once, initNowSource);
+#ifdef ENVU_NOW_HAS_TSC
+    if (now_use_tsc) {
+        NowAnchor anchor;
+        loadNowAnchor(&anchor);
+        uint64_t ticks = __rdtsc() - anchor.tsc_base;
+        if (anchor.mult != 0 && ticks < anchor.interval)
+            return anchor.ns_base + scaleTsc(ticks, anchor.mult);
+        return anchorTsc(&anchor);
+    }
+#endif
+    return getMonotonicNs();
+}
+
+// Returns the zone name in a path to a tzfile. e.g. "/usr/share/zoneinfo/Asia/Tokyo"
+static const char *getZoneNameFromPath(const char *path) {
+    const char *name = strstr(path, "/zoneinfo/");
+    if (name == NULL)
+        return NULL;
+    name += strlen("/zoneinfo/");
+    // Skip the directories for leap seconds.
+    if (strncmp(name, "posix/", 6) == 0)
+        name += 6;
+    else if (strncmp(name, "right/", 6) == 0)
+        name += 6;
+    if (*name == '\0')
+        return NULL;
+    return name;
+}
+
+static char *getTimezoneFromFiles(void) {
+    // Try the symlink target of /etc/localtime
+    char *path = envuGetRealPath("/etc/localtime");
+    if (path != NULL) {
+        const char *name = getZoneNameFromPath(path);
+        char *ret = envuAllocStrWithConst(name);
+        envuFree(path);
+        if (ret != NULL)
+            return ret;
+    }
+
+    // Try /etc/timezone (Debian and its derivatives)
+    FILE *fptr = fopen("/etc/timezone", "r");
+    if (!fptr)
+        return NULL;
+    char line[256];
+    char *ret = NULL;
+    if (fgets(line, sizeof(line), fptr) != NULL) {
+        line[strcspn(line, " \t\r\n")] = '\0';
+        if (*line != '\0')
+            ret = envuAllocStrWithConst(line);
+    }
+    fclose(fptr);
+    return ret;
+}
+
+static char *cached_timezone = NULL;
+static pthread_once_t cached_timezone_once = PTHREAD_ONCE_INIT;
+
+static void initCachedTimezone(void) {
+    cached_timezone = getTimezoneFromFiles();
+}
+
+char *envuGetTimezone(void) {
+    const char *tz = getenv("TZ");
+    if (tz != NULL) {
+        // Note: Empty TZ means UTC in glibc.
+        if (*tz == ':')
+            tz++;
+        if (*tz == '\0')
+            return envuAllocStrWithConst("UTC");
+        if (*tz != '/')
+            return envuAllocStrWithConst(tz);
+        // TZ is a path to a tzfile.
+        if (strcmp(tz, "/etc/localtime") != 0) {
+            char *path = envuGetRealPath(tz);
+            if (path == NULL)
+                return envuAllocStrWithConst(tz);
+            const char *name = getZoneNameFromPath(path);
+            char *ret = envuAllocStrWithConst(name ? name : tz);
+            envuFree(path);
+            return ret;
+        }
+    }
+    pthread_once(&cached_timezone_once, initCachedTimezone);
+    return envuAllocStrWithConst(cached_timezone);
+}
+
+int envuPinTimezone(void) {
+    if (getenv("TZ") != NULL)
+        return 0;
+
+    int ret;
+    if (envuPathExists("/etc/localtime")) {
+        // Note: glibc skips reloading the tzfile when TZ is not changed.
+        ret = envuSetEnv("TZ", ":/etc/localtime");
+    } else {
+        char *tz = envuGetTimezone();
+        if (tz == NULL)
+            return -1;
+        ret = envuSetEnv("TZ", tz);
+        envuFree(tz);
+    }
+    if (ret == 0)
+        tzset();
+    return ret;
+}
+
+char *envuGetExecutableBuildId(void) {
+#ifdef __linux__
+    return getExecutableBuildIdLinux();
+#else
+    return NULL;
+#endif
+}
+
+envuModule *envuGetLoadedModules(int *module_count) {
+#ifdef __linux__
+    return getLoadedModulesLinux(module_count);
+#else
+    if (module_count != NULL)
+        *module_count = 0;
+    return NULL;
+#endif
+}
+
+int envuSetSysRoot(const char *path) {
+#ifdef __linux__
+    return setSysRootLinux(path);
+#else
+    (void)path;
+    return -1;
+#endif
+}
+
+int envuGetEffectiveCpuCount(envuCpuCountInfo *out) {
+#ifdef __linux__
+    return getEffectiveCpuCountLinux(out);
+#else
+    int count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (count <= 0)
+        return -1;
+    if (out != NULL) {
+        memset(out, 0, sizeof(*out));
+        out->online = count;
+        out->affinity = -1;
+        out->cpuset = -1;
+        out->effective = count;
+    }
+    return count;
+#endif
+}
+
+const envuCacheTopology *envuGetCacheTopology(void) {
+#ifdef __linux__
+    return getCacheTopologyLinux();
+#else
+    return NULL;
+#endif
+}
+
+const envuNumaTopology *envuGetNumaTopology(void) {
+#ifdef __linux__
+    return getNumaTopologyLinux();
+#else
+    return NULL;
+#endif
+}
+
+int envuGetCurrentNumaNode(void) {
+#ifdef __linux__
+    return getCurrentNumaNodeLinux();
+#else
+    return -1;
+#endif
+}
+
+const envuCpuTopology *envuGetCpuTopology(void) {
+#ifdef __linux__
+    return getCpuTopologyLinux();
+#else
+    return NULL;
+#endif
+}
+
+int envuPinCurrentThread(int cpu) {
+#ifdef __linux__
+    return pinCurrentThreadLinux(cpu);
+#else
+    (void)cpu;
+    return -1;
+#endif
+}
+
+int envuGetThreadAffinity(envuCpuSet *out) {
+#ifdef __linux__
+    return getThreadAffinityLinux(out);
+#else
+    (void)out;
+    return -1;
+#endif
+}
+
+int *envuPlanWorkers(int n, envuPlacementPolicy policy) {
+#ifdef __linux__
+    return planWorkersLinux(n, policy);
+#else
+    (void)n;
+    (void)policy;
+    return NULL;
+#endif
+}
+
+int envuGetSchedEnvironment(envuSchedEnvironment *out) {
+#ifdef __linux__
+    return getSchedEnvironmentLinux(out);
+#else
+    if (out == NULL)
+        return -1;
+    memset(out, 0, sizeof(*out));
+    out->autogroup = -1;
+    out->perf_cmdline = "";
+    int policy;
+    struct sched_param param;
+    if (pthread_getschedparam(pthread_self(), &policy, &param) == 0) {
+        if (policy == SCHED_OTHER)
+            out->policy = ENVU_SCHED_OTHER;
+        else if (policy == SCHED_FIFO)
+            out->policy = ENVU_SCHED_FIFO;
+        else if (policy == SCHED_RR)
+            out->policy = ENVU_SCHED_RR;
+        if (out->policy == ENVU_SCHED_FIFO || out->policy == ENVU_SCHED_RR)
+            out->priority = param.sched_priority;
+    }
+    errno = 0;
+    int nice = getpriority(PRIO_PROCESS, 0);
+    if (errno == 0)
+        out->nice = nice;
+    return 0;
+#endif
+}
+
+const char *envuGetKernelCmdlineValue(const char *key) {
+#ifdef __linux__
+    return getKernelCmdlineValueLinux(key);
+#else
+    (void)key;
+    return NULL;
+#endif
+}
+
+int envuGetMemoryInfo(envuMemoryInfo *out) {
+#ifdef __linux__
+    return getMemoryInfoLinux(out);
+#else
+    if (out == NULL)
+        return -1;
+    memset(out, 0, sizeof(*out));
+    long page_size = sysconf(_SC_PAGESIZE);
+    long pages = sysconf(_SC_PHYS_PAGES);
+    if (page_size <= 0 || pages <= 0)
+        return -1;
+    out->page_size = (uint64_t)page_size;
+    out->total = (uint64_t)pages * page_size;
+#ifdef _SC_AVPHYS_PAGES
+    long av_pages = sysconf(_SC_AVPHYS_PAGES);
+    if (av_pages > 0)
+        out->available = (uint64_t)av_pages * page_size;
+#endif
+    out->cgroup_max = out->cgroup_high = out->cgroup_swap_max = ENVU_MEMORY_UNLIMITED;
+    out->effective_limit = out->total;
+    out->budget = out->available;
+    return 0;
+#endif
+}
+
+const envuHugePageInfo *envuGetHugePageInfo(void) {
+#ifdef __linux__
+    return getHugePageInfoLinux(0);
+#else
+    return NULL;
+#endif
+}
+
+const envuHugePageInfo *envuRefreshHugePageInfo(void) {
+#ifdef __linux__
+    return getHugePageInfoLinux(1);
+#else
+    return NULL;
+#endif
+}
+
+int envuAuditTunablesWithRules(const envuTunableRule *rules, int rule_count,
+                               envuTunableReport *out) {
+#ifdef __linux__
+    return auditTunablesLinux(rules, rule_count, out);
+#else
+    (void)rules;
+    (void)rule_count;
+    if (out != NULL)
+        memset(out, 0, sizeof(*out));
+    return -1;
+#endif
+}
+
+int envuGetPressure(envuPressureResource resource, envuPressure *out) {
+#ifdef __linux__
+    return getPressureLinux(resource, out);
+#else
+    (void)resource;
+    if (out != NULL)
+        memset(out, 0, sizeof(*out));
+    return -1;
+#endif
+}
+
+int envuSubscribePressure(envuPressureResource resource,
+                          uint64_t threshold_us, uint64_t window_us) {
+#ifdef __linux__
+    return subscribePressureLinux(resource, threshold_us, window_us);
+#else
+    (void)resource;
+    (void)threshold_us;
+    (void)window_us;
+    return -1;
+#endif
+}
+
+const envuVirtualization *envuGetVirtualization(void) {
+#ifdef __linux__
+    return getVirtualizationLinux();
+#else
+    return NULL;
+#endif
+}
+
+envuBenchEnvironment *envuGetBenchEnvironment(void) {
+#ifdef __linux__
+    return getBenchEnvironmentLinux();
+#else
+    return NULL;
+#endif
+}
+
+envuSampler *envuOpenSampler(int pid) {
+#ifdef __linux__
+    return openSamplerLinux(pid);
+#else
+    (void)pid;
+    return NULL;
+#endif
+}
+
+int envuSample(envuSampler *sampler, envuProcessSample *out) {
+#ifdef __linux__
+    return sampleLinux(sampler, out);
+#else
+    (void)sampler;
+    if (out != NULL)
+        memset(out, 0, sizeof(*out));
+    return -1;
+#endif
+}
+
+void envuCloseSampler(envuSampler *sampler) {
+#ifdef __linux__
+    closeSamplerLinux(sampler);
+#else
+    (void)sampler;
+#endif
+}
+
+envuProcessSnapshot *envuSnapshotProcesses(unsigned int fields, const envuProcessFilter *filter) {
+#ifdef __linux__
+    return snapshotProcessesLinux(fields, filter);
+#else
+    (void)fields;
+    (void)filter;
+    return NULL;
+#endif
+}
+
+envuProcessSnapshot *envuUpdateProcessSnapshot(const envuProcessSnapshot *prev) {
+#ifdef __linux__
+    return updateProcessSnapshotLinux(prev);
+#else
+    (void)prev;
+    return NULL;
+#endif
+}
+
+const envuStorageInfo *envuGetStorageInfo(const char *path) {
+#ifdef __linux__
+    return getStorageInfoLinux(path);
+#else
+    (void)path;
+    return NULL;
+#endif
+}
+
+const envuStorageInfo *envuGetStorageInfoForDevice(unsigned int major, unsigned int minor) {
+#ifdef __linux__
+    return getStorageInfoForDeviceLinux(major, minor);
+#else
+    (void)major;
+    (void)minor;
+    return NULL;
+#endif
+}
+
+int envuGetFsCapabilities(const char *path, envuFsCapabilities *out) {
+#ifdef __linux__
+    return getFsCapabilitiesLinux(path, out);
+#else
+    (void)path;
+    (void)out;
+    return -1;
+#endif
+}
+
+envuMount *envuGetMountForPath(const char *path) {
+#ifdef __linux__
+    return getMountForPathLinux(path);
+#else
+    (void)path;
+    return NULL;
+#endif
+}
+
+// Storage classes of scratch directories.
+enum {
+    SCRATCH_FAST_DISK = 0,
+    SCRATCH_MEMORY,
+    SCRATCH_SLOW_DISK,
+    SCRATCH_NETWORK,
+    SCRATCH_CLASS_MAX,
+};
+
+// Orders of storage classes for envuScratchFlag.
+static const int scratch_orders[3][SCRATCH_CLASS_MAX] = {
+    { SCRATCH_FAST_DISK, SCRATCH_MEMORY, SCRATCH_SLOW_DISK, SCRATCH_NETWORK },
+    { SCRATCH_MEMORY, SCRATCH_FAST_DISK, SCRATCH_SLOW_DISK, SCRATCH_NETWORK },
+    { SCRATCH_FAST_DISK, SCRATCH_SLOW_DISK, SCRATCH_MEMORY, SCRATCH_NETWORK },
+};
+
+static int getScratchClass(const char *dir) {
+#ifdef __linux__
+    // Only the type is needed. envuGetFsCapabilities() would write probe files.
+    struct statfs sfs;
+    if (statfs(dir, &sfs) != 0)
+        return SCRATCH_SLOW_DISK;
+    envuFsClass fs_class = getFsClassLinux((uint64_t)(unsigned long)sfs.f_type);
+    if (fs_class == ENVU_FS_CLASS_MEMORY)
+        return SCRATCH_MEMORY;
+    if (fs_class == ENVU_FS_CLASS_NETWORK)
+        return SCRATCH_NETWORK;
+#endif
+    const envuStorageInfo *storage = envuGetStorageInfo(dir);
+    if (storage != NULL && storage->rotational == 0)
+        return SCRATCH_FAST_DISK;
+    return SCRATCH_SLOW_DISK;
+}
+
+// Gets free space for unprivileged users. Returns -1 if the directory is not usable.
+static int getScratchFreeBytes(const char *dir, uint64_t *free_bytes) {
+    struct stat st;
+    struct statvfs vfs;
+    if (dir == NULL || dir[0] != '/' || stat(dir, &st) != 0 || !S_ISDIR(st.st_mode) ||
+        access(dir, W_OK | X_OK) != 0 || statvfs(dir, &vfs) != 0 || (vfs.f_flag & ST_RDONLY))
+        return -1;
+    *free_bytes = (uint64_t)vfs.f_bavail * vfs.f_frsize;
+    return 0;
+}
+
+static char *selectScratchDir(uint64_t min_free_bytes, unsigned int flags) {
+    const int *order = scratch_orders[0];
+    if (flags & ENVU_SCRATCH_MEMORY)
+        order = scratch_orders[1];
+    else if (flags & ENVU_SCRATCH_LOCAL_DISK)
+        order = scratch_orders[2];
+    char *tmp_dir = envuGetTempDir();
+    char *runtime_dir = envuGetEnv("XDG_RUNTIME_DIR");
+    const char *candidates[] = { tmp_dir, runtime_dir, "/dev/shm", "/tmp", "/var/tmp" };
+    int best = -1;
+    int best_rank = SCRATCH_CLASS_MAX;
+    uint64_t best_free = 0;
+    for (int i = 0; i < (int)(sizeof(candidates) / sizeof(candidates[0])); i++) {
+        uint64_t free_bytes;
+        if (getScratchFreeBytes(candidates[i], &free_bytes) != 0 || free_bytes < min_free_bytes)
+            continue;
+        int scratch_class = getScratchClass(candidates[i]);
+        int rank = 0;
+        while (order[rank] != scratch_class)
+            rank++;
+        // Candidates in the same class are ranked by free space.
+        if (rank < best_rank || (rank == best_rank && free_bytes > best_free)) {
+            best = i;
+            best_rank = rank;
+            best_free = free_bytes;
+        }
+    }
+    char *dir = best >= 0 ? envuAllocStrWithConst(candidates[best]) : NULL;
+    envuFree(tmp_dir);
+    envuFree(runtime_dir);
+    if (dir != NULL)
+        removeTrailingSlashes(dir);
+    return dir;
+}
+
+#define SCRATCH_FLAG_MASK (ENVU_SCRATCH_MEMORY | ENVU_SCRATCH_LOCAL_DISK)
+
+// The best directory for each combination of flags, selected without a threshold.
+// Null pointers mean no candidate is suitable.
+static char *scratch_dirs[SCRATCH_FLAG_MASK + 1];
+static int scratch_dir_cached[SCRATCH_FLAG_MASK + 1];
+static pthread_mutex_t scratch_dir_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+char *envuGetFastScratchDir(uint64_t min_free_bytes, unsigned int flags) {
+    int refresh = (flags & ENVU_SCRATCH_REFRESH) != 0;
+    flags &= SCRATCH_FLAG_MASK;
+    char *dir = NULL;
+    pthread_mutex_lock(&scratch_dir_mutex);
+    if (!scratch_dir_cached[flags] || refresh) {
+        // Callers get copies, so the old decision can be freed.
+        envuFree(scratch_dirs[flags]);
+        scratch_dirs[flags] = selectScratchDir(0, flags);
+        scratch_dir_cached[flags] = 1;
+    }
+    uint64_t free_bytes;
+    if (scratch_dirs[flags] != NULL &&
+        getScratchFreeBytes(scratch_dirs[flags], &free_bytes) == 0 &&
+        free_bytes >= min_free_bytes)
+        dir = envuAllocStrWithConst(scratch_dirs[flags]);
+    pthread_mutex_unlock(&scratch_dir_mutex);
+    if (dir == NULL && min_free_bytes > 0) {
+        // The cached directory is too small. Look for a larger one without caching it.
+        dir = selectScratchDir(min_free_bytes, flags);
+    }
+    return dir;
+}
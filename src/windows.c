@@ -3,6 +3,7 @@
 #include <malloc.h>
 #include <Lmcons.h>
 #include <limits.h>
+#include <stdio.h>
 
 #include "env_utils.h"
 #include "env_utils_windows.h"
@@ -324,6 +325,27 @@ char *envuGetHome(void) {
     return str;
 }
 
+char *envuGetTempDir(void) {
+    // GetTempPathW checks TMP, TEMP, and USERPROFILE.
+    DWORD size = GetTempPathW(0, NULL);
+    if (size == 0)
+        return NULL;
+    wchar_t *wpath = envuAllocWstr(size);
+    if (wpath == NULL)
+        return NULL;
+    DWORD len = GetTempPathW(size, wpath);
+    if (len == 0 || len >= size) {
+        envuFree(wpath);
+        return NULL;
+    }
+    // Remove the trailing backslash except for drive roots. e.g. "C:\"
+    if (len > 3 && wpath[len - 1] == L'\\')
+        wpath[len - 1] = L'\0';
+    char *path = envuUTF16toUTF8(wpath);
+    envuFree(wpath);
+    return path;
+}
+
 char *envuGetUsername(void) {
     // Try GetUserNameW
     wchar_t wname[UNLEN + 1];
@@ -342,6 +364,37 @@ char *envuGetUsername(void) {
     return NULL;
 }
 
+// The max value that _setmaxstdio() accepts.
+#define MAX_STDIO 8192
+
+int envuGetResourceLimits(envuResourceLimits *out) {
+    if (out == NULL)
+        return -1;
+    envuInitResourceLimits(out);
+    // Windows has no rlimits. The CRT limits the number of stdio streams.
+    envuResourceLimit *limit = &out->limits[ENVU_RLIMIT_NOFILE];
+    limit->supported = 1;
+    limit->soft = (uint64_t)_getmaxstdio();
+    limit->hard = MAX_STDIO;
+    return 0;
+}
+
+int envuRaiseLimit(envuResource resource, uint64_t desired, uint64_t *achieved) {
+    if (achieved != NULL)
+        *achieved = 0;
+    if (resource != ENVU_RLIMIT_NOFILE)
+        return -1;
+    int soft = _getmaxstdio();
+    int target = desired < MAX_STDIO ? (int)desired : MAX_STDIO;
+    if (soft < target && _setmaxstdio(target) == target)
+        soft = target;
+    if (achieved != NULL)
+        *achieved = (uint64_t)soft;
+    if (desired == ENVU_RLIM_INFINITY)
+        return soft == MAX_STDIO ? 0 : -1;
+    return (uint64_t)soft >= desired ? 0 : -1;
+}
+
 char *envuGetOS(void) {
     return envuAllocStrWithConst("Windows");
 }
@@ -355,3 +408,309 @@ char *envuGetOSProductName(void) {
     wchar_t *wstr = getOSInfoFromWMI(L"Caption");
     return envuUTF16toUTF8(wstr);
 }
+
+int envuPublishSnapshot(void) {
+    return -1;
+}
+
+void envuUnpublishSnapshot(void) {
+}
+
+int envuAttachSnapshot(void) {
+    return -1;
+}
+
+void envuDetachSnapshot(void) {
+}
+
+int envuPrepareCrashInfo(void) {
+    return -1;
+}
+
+int envuWriteCrashInfo(int fd) {
+    (void)fd;
+    return -1;
+}
+
+const envuKernelFeatures *envuGetKernelFeatures(void) {
+    return NULL;
+}
+
+char *envuGetTimezone(void) {
+    char *tz = envuGetEnv("TZ");
+    if (tz != NULL)
+        return tz;
+
+    DYNAMIC_TIME_ZONE_INFORMATION info;
+    if (GetDynamicTimeZoneInformation(&info) == TIME_ZONE_ID_INVALID)
+        return NULL;
+    if (info.TimeZoneKeyName[0] == L'\0')
+        return NULL;
+    return envuUTF16toUTF8(info.TimeZoneKeyName);
+}
+
+int envuPinTimezone(void) {
+    // Note: CRTs on Windows don't read tzfiles.
+    return -1;
+}
+
+char *envuGetExecutableBuildId(void) {
+    return NULL;
+}
+
+envuModule *envuGetLoadedModules(int *module_count) {
+    if (module_count != NULL)
+        *module_count = 0;
+    return NULL;
+}
+
+int envuSetSysRoot(const char *path) {
+    (void)path;
+    return -1;
+}
+
+int envuGetEffectiveCpuCount(envuCpuCountInfo *out) {
+    envuCpuCountInfo info;
+    memset(&info, 0, sizeof(info));
+    info.online = (int)GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+    info.affinity = -1;
+    info.cpuset = -1;
+
+    DWORD_PTR proc_mask;
+    DWORD_PTR sys_mask;
+    if (GetProcessAffinityMask(GetCurrentProcess(), &proc_mask, &sys_mask)) {
+        int count = 0;
+        for (; proc_mask; proc_mask &= proc_mask - 1)
+            count++;
+        info.affinity = count;
+    }
+
+    int count = info.online;
+    if (info.affinity > 0 && info.affinity < count)
+        count = info.affinity;
+    if (count <= 0)
+        return -1;
+    info.effective = count;
+    if (out != NULL)
+        *out = info;
+    return count;
+}
+
+const envuCacheTopology *envuGetCacheTopology(void) {
+    return NULL;
+}
+
+const envuNumaTopology *envuGetNumaTopology(void) {
+    return NULL;
+}
+
+int envuGetCurrentNumaNode(void) {
+    PROCESSOR_NUMBER proc;
+    GetCurrentProcessorNumberEx(&proc);
+    USHORT node;
+    if (!GetNumaProcessorNodeEx(&proc, &node))
+        return -1;
+    return (int)node;
+}
+
+const envuCpuTopology *envuGetCpuTopology(void) {
+    return NULL;
+}
+
+int envuPinCurrentThread(int cpu) {
+    if (cpu < 0)
+        return -1;
+    GROUP_AFFINITY affinity;
+    memset(&affinity, 0, sizeof(affinity));
+    affinity.Group = (WORD)(cpu / 64);
+    affinity.Mask = (KAFFINITY)1 << (cpu % 64);
+    return SetThreadGroupAffinity(GetCurrentThread(), &affinity, NULL) ? 0 : -1;
+}
+
+int envuGetThreadAffinity(envuCpuSet *out) {
+    if (out == NULL)
+        return -1;
+    memset(out, 0, sizeof(*out));
+    GROUP_AFFINITY affinity;
+    if (!GetThreadGroupAffinity(GetCurrentThread(), &affinity) ||
+        affinity.Group >= ENVU_CPU_SETSIZE / 64)
+        return -1;
+    out->bits[affinity.Group] = (uint64_t)affinity.Mask;
+    return envuCpuSetCount(out);
+}
+
+int *envuPlanWorkers(int n, envuPlacementPolicy policy) {
+    (void)n;
+    (void)policy;
+    return NULL;
+}
+
+int envuGetSchedEnvironment(envuSchedEnvironment *out) {
+    if (out != NULL)
+        memset(out, 0, sizeof(*out));
+    return -1;
+}
+
+const char *envuGetKernelCmdlineValue(const char *key) {
+    (void)key;
+    return NULL;
+}
+
+int envuGetMemoryInfo(envuMemoryInfo *out) {
+    if (out == NULL)
+        return -1;
+    memset(out, 0, sizeof(*out));
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    if (!GlobalMemoryStatusEx(&status))
+        return -1;
+    SYSTEM_INFO sysinfo;
+    GetSystemInfo(&sysinfo);
+    out->page_size = sysinfo.dwPageSize;
+    out->total = status.ullTotalPhys;
+    out->available = status.ullAvailPhys;
+    out->cgroup_max = out->cgroup_high = out->cgroup_swap_max = ENVU_MEMORY_UNLIMITED;
+    out->effective_limit = out->total;
+    out->budget = out->available;
+    return 0;
+}
+
+const envuHugePageInfo *envuGetHugePageInfo(void) {
+    return NULL;
+}
+
+const envuHugePageInfo *envuRefreshHugePageInfo(void) {
+    return NULL;
+}
+
+int envuAuditTunablesWithRules(const envuTunableRule *rules, int rule_count,
+                               envuTunableReport *out) {
+    (void)rules;
+    (void)rule_count;
+    if (out != NULL)
+        memset(out, 0, sizeof(*out));
+    return -1;
+}
+
+int envuGetPressure(envuPressureResource resource, envuPressure *out) {
+    (void)resource;
+    if (out != NULL)
+        memset(out, 0, sizeof(*out));
+    return -1;
+}
+
+int envuSubscribePressure(envuPressureResource resource,
+                          uint64_t threshold_us, uint64_t window_us) {
+    (void)resource;
+    (void)threshold_us;
+    (void)window_us;
+    return -1;
+}
+
+static envuClockInfo clock_info;
+static INIT_ONCE clock_info_once = INIT_ONCE_STATIC_INIT;
+static LARGE_INTEGER qpc_freq;
+
+static BOOL CALLBACK initClockInfo(PINIT_ONCE once, PVOID param, PVOID *context) {
+    (void)once;
+    (void)param;
+    (void)context;
+    QueryPerformanceFrequency(&qpc_freq);
+    LARGE_INTEGER start, end, now;
+    const int count = 1000;
+    QueryPerformanceCounter(&start);
+    for (int i = 0; i < count; i++)
+        QueryPerformanceCounter(&now);
+    QueryPerformanceCounter(&end);
+    clock_info.monotonic_ns =
+        (double)(end.QuadPart - start.QuadPart) * 1e9 / (double)qpc_freq.QuadPart / count;
+    clock_info.now_source = ENVU_NOW_MONOTONIC;
+    return TRUE;
+}
+
+const envuClockInfo *envuGetClockInfo(void) {
+    InitOnceExecuteOnce(&clock_info_once, initClockInfo, NULL, NULL);
+    return &clock_info;
+}
+
+uint64_t envuNowNs(void) {
+    envuGetClockInfo();
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    uint64_t sec = (uint64_t)now.QuadPart / qpc_freq.QuadPart;
+    uint64_t rest = (uint64_t)now.QuadPart % qpc_freq.QuadPart;
+    return sec * 1000000000ULL + rest * 1000000000ULL / qpc_freq.QuadPart;
+}
+
+const envuVirtualization *envuGetVirtualization(void) {
+    return NULL;
+}
+
+envuBenchEnvironment *envuGetBenchEnvironment(void) {
+    return NULL;
+}
+
+envuSampler *envuOpenSampler(int pid) {
+    (void)pid;
+    return NULL;
+}
+
+int envuSample(envuSampler *sampler, envuProcessSample *out) {
+    (void)sampler;
+    if (out != NULL)
+        memset(out, 0, sizeof(*out));
+    return -1;
+}
+
+void envuCloseSampler(envuSampler *sampler) {
+    (void)sampler;
+}
+
+envuProcessSnapshot *envuSnapshotProcesses(unsigned int fields, const envuProcessFilter *filter) {
+    (void)fields;
+    (void)filter;
+    return NULL;
+}
+
+envuProcessSnapshot *envuUpdateProcessSnapshot(const envuProcessSnapshot *prev) {
+    (void)prev;
+    return NULL;
+}
+
+const envuStorageInfo *envuGetStorageInfo(const char *path) {
+    (void)path;
+    return NULL;
+}
+
+const envuStorageInfo *envuGetStorageInfoForDevice(unsigned int major, unsigned int minor) {
+    (void)major;
+    (void)minor;
+    return NULL;
+}
+
+int envuGetFsCapabilities(const char *path, envuFsCapabilities *out) {
+    (void)path;
+    (void)out;
+    return -1;
+}
+
+envuMount *envuGetMountForPath(const char *path) {
+    (void)path;
+    return NULL;
+}
+
+char *envuGetFastScratchDir(uint64_t min_free_bytes, unsigned int flags) {
+    (void)flags;
+    char *dir = envuGetTempDir();
+    if (dir == NULL)
+        return NULL;
+    wchar_t *wdir = envuUTF8toUTF16(dir);
+    ULARGE_INTEGER available;
+    BOOL ok = wdir != NULL && GetDiskFreeSpaceExW(wdir, &available, NULL, NULL);
+    envuFree(wdir);
+    if (!ok || available.QuadPart < min_free_bytes) {
+        envuFree(dir);
+        return NULL;
+    }
+    return dir;
+}
@@ -0,0 +1,112 @@
+#pragma once
+// Tests for envuGetBenchEnvironment
+
+#include <string>
+#include <gtest/gtest.h>
+#include "env_utils.h"
+#include "cpu_tests.hpp"
+
+#ifdef __linux__
+TEST(BenchTest, envuGetBenchEnvironment) {
+    envuBenchEnvironment *env = envuGetBenchEnvironment();
+    ASSERT_NE(nullptr, env);
+    EXPECT_GT(env->cpu_count, 0);
+    ASSERT_NE(nullptr, env->hypervisor);
+    ASSERT_NE(nullptr, env->container);
+    EXPECT_GE(env->loadavg[0], 0);
+    char *json = envuSerializeBenchEnvironment(env);
+    ASSERT_NE(nullptr, json);
+    EXPECT_EQ('{', json[0]);
+    envuFree(json);
+    envuFree(env);
+}
+
+TEST_F(SysRootTest, envuGetBenchEnvironmentWarnings) {
+    SetSysRoot("bench_env");
+    envuBenchEnvironment *env = envuGetBenchEnvironment();
+    ASSERT_NE(nullptr, env);
+    ASSERT_EQ(4, env->cpu_count);
+    EXPECT_EQ(1, env->cpus[1].cpu);
+    EXPECT_STREQ("powersave", env->cpus[1].governor);
+    EXPECT_STREQ("intel_pstate", env->cpus[1].driver);
+    EXPECT_EQ(2500000u, env->cpus[1].cur_khz);
+    EXPECT_EQ(800000u, env->cpus[1].min_khz);
+    EXPECT_EQ(4700000u, env->cpus[1].max_khz);
+    EXPECT_STREQ("performance", env->cpus[3].governor);
+    EXPECT_EQ(1, env->turbo);
+    EXPECT_STREQ("on", env->smt_control);
+    EXPECT_EQ(1, env->smt_active);
+    EXPECT_EQ(2, env->aslr);
+    EXPECT_DOUBLE_EQ(3.5, env->loadavg[0]);
+    EXPECT_DOUBLE_EQ(1.25, env->loadavg[1]);
+    EXPECT_DOUBLE_EQ(0.75, env->loadavg[2]);
+    EXPECT_EQ(2, env->runnable);
+    EXPECT_STREQ("none", env->hypervisor);
+    EXPECT_STREQ("none", env->container);
+    EXPECT_EQ((unsigned)(ENVU_BENCH_WARN_GOVERNOR | ENVU_BENCH_WARN_TURBO |
+                         ENVU_BENCH_WARN_SMT | ENVU_BENCH_WARN_ASLR | ENVU_BENCH_WARN_LOAD),
+              env->warnings);
+    ASSERT_EQ(5, env->warning_count);
+    EXPECT_STREQ("2 of 4 CPUs use the \"powersave\" governor instead of \"performance\".",
+                 env->warning_messages[0]);
+    envuFree(env);
+}
+
+TEST_F(SysRootTest, envuGetBenchEnvironmentTuned) {
+    SetSysRoot("bench_tuned");
+    envuBenchEnvironment *env = envuGetBenchEnvironment();
+    ASSERT_NE(nullptr, env);
+    ASSERT_EQ(2, env->cpu_count);
+    EXPECT_EQ(2, env->cpus[1].cpu);
+    EXPECT_EQ(0, env->turbo);
+    EXPECT_STREQ("off", env->smt_control);
+    EXPECT_EQ(0, env->smt_active);
+    EXPECT_EQ(0, env->aslr);
+    EXPECT_EQ(0u, env->warnings);
+    EXPECT_EQ(0, env->warning_count);
+    envuFree(env);
+}
+
+TEST_F(SysRootTest, envuSerializeBenchEnvironment) {
+    SetSysRoot("bench_tuned");
+    envuBenchEnvironment *env = envuGetBenchEnvironment();
+    ASSERT_NE(nullptr, env);
+    char *json = envuSerializeBenchEnvironment(env);
+    envuFree(env);
+    ASSERT_NE(nullptr, json);
+    const char *expected =
+        "{\"cpus\":["
+        "{\"cpu\":0,\"governor\":\"performance\",\"driver\":\"amd-pstate-epp\","
+        "\"cur_khz\":3000000,\"min_khz\":3000000,\"max_khz\":3000000},"
+        "{\"cpu\":2,\"governor\":\"performance\",\"driver\":\"amd-pstate-epp\","
+        "\"cur_khz\":3000000,\"min_khz\":3000000,\"max_khz\":3000000}],"
+        "\"turbo\":false,\"smt_control\":\"off\",\"smt_active\":false,\"aslr\":0,"
+        "\"loadavg\":[0.05,0.10,0.08],\"runnable\":1,"
+        "\"hypervisor\":\"none\",\"container\":\"none\",\"warning_flags\":0,\"warnings\":[]}";
+    EXPECT_STREQ(expected, json);
+    envuFree(json);
+}
+
+TEST(BenchTest, envuSerializeBenchEnvironmentEscape) {
+    const char *message = "\"quoted\"\tpath\\";
+    envuBenchEnvironment env = {};
+    env.turbo = env.smt_active = env.aslr = env.runnable = -1;
+    env.loadavg[0] = env.loadavg[1] = env.loadavg[2] = -1;
+    env.hypervisor = "unknown";
+    env.container = "none";
+    env.warning_count = 1;
+    env.warning_messages = &message;
+    char *json = envuSerializeBenchEnvironment(&env);
+    ASSERT_NE(nullptr, json);
+    std::string str = json;
+    envuFree(json);
+    EXPECT_NE(std::string::npos, str.find("\"turbo\":null,\"smt_control\":null"));
+    EXPECT_NE(std::string::npos, str.find("\"loadavg\":[null,null,null]"));
+    EXPECT_NE(std::string::npos, str.find("\"warnings\":[\"\\\"quoted\\\"\\u0009path\\\\\"]"));
+}
+#else
+TEST(BenchTest, envuGetBenchEnvironment) {
+    EXPECT_EQ(nullptr, envuGetBenchEnvironment());
+    EXPECT_EQ(nullptr, envuSerializeBenchEnvironment(nullptr));
+}
+#endif
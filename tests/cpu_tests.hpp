@@ -0,0 +1,278 @@
+#pragma once
+// Tests for cpu queries
+
+#include <gtest/gtest.h>
+#include <string>
+#ifdef __linux__
+#include <sched.h>
+#endif
+#include "env_utils.h"
+#include "true_env_info.h"
+
+#ifdef __linux__
+// Replaces the sysroot with a fixture in tests/data
+class SysRootTest : public ::testing::Test {
+ protected:
+    void SetSysRoot(const char *name) {
+        std::string root = std::string(TRUE_CWD) + "/tests/data/" + name;
+        ASSERT_EQ(0, envuSetSysRoot(root.c_str()));
+    }
+
+    virtual void TearDown() {
+        envuSetSysRoot(NULL);
+    }
+};
+
+TEST(CpuTest, envuGetEffectiveCpuCount) {
+    envuCpuCountInfo info;
+    int count = envuGetEffectiveCpuCount(&info);
+    ASSERT_LE(1, count);
+    EXPECT_EQ(count, info.effective);
+    EXPECT_LE(count, info.online);
+    if (info.affinity > 0) {
+        EXPECT_LE(count, info.affinity);
+    }
+    EXPECT_EQ(count, envuGetEffectiveCpuCount(NULL));
+}
+
+TEST_F(SysRootTest, envuGetEffectiveCpuCountCgroupV2) {
+    SetSysRoot("cgroup_v2");
+    envuCpuCountInfo info;
+    int count = envuGetEffectiveCpuCount(&info);
+    EXPECT_EQ(2, info.cgroup_version);
+    EXPECT_EQ(8, info.online);
+    EXPECT_EQ(6, info.cpuset);
+    // The minimum quota in ancestors.
+    EXPECT_DOUBLE_EQ(1.5, info.quota);
+    // The quota should be rounded up.
+    int expected = info.affinity > 0 && info.affinity < 2 ? info.affinity : 2;
+    EXPECT_EQ(expected, count);
+}
+
+TEST_F(SysRootTest, envuGetEffectiveCpuCountCgroupV1) {
+    SetSysRoot("cgroup_v1");
+    envuCpuCountInfo info;
+    int count = envuGetEffectiveCpuCount(&info);
+    EXPECT_EQ(1, info.cgroup_version);
+    EXPECT_EQ(8, info.online);
+    EXPECT_EQ(2, info.cpuset);
+    EXPECT_DOUBLE_EQ(4.0, info.quota);
+    int expected = info.affinity > 0 && info.affinity < 2 ? info.affinity : 2;
+    EXPECT_EQ(expected, count);
+}
+
+TEST_F(SysRootTest, envuSetSysRootInvalid) {
+    SetSysRoot("no_one_use_this_dir");
+    // It should fall back to sysconf.
+    envuCpuCountInfo info;
+    EXPECT_LE(1, envuGetEffectiveCpuCount(&info));
+    EXPECT_EQ(0, info.cgroup_version);
+    EXPECT_EQ(-1, info.cpuset);
+}
+
+TEST(CpuTest, envuGetCacheTopology) {
+    const envuCacheTopology *topo = envuGetCacheTopology();
+    if (topo == NULL)
+        GTEST_SKIP() << "No cache information available";
+    ASSERT_LT(0, topo->count);
+    // The cache should return the same pointer.
+    EXPECT_EQ(topo, envuGetCacheTopology());
+    for (int i = 0; i < topo->count; i++) {
+        EXPECT_LE(1, topo->caches[i].level);
+        EXPECT_LE(1, topo->caches[i].shared_count);
+    }
+}
+
+TEST_F(SysRootTest, envuGetCacheTopology) {
+    SetSysRoot("cpu_topology");
+    const envuCacheTopology *topo = envuGetCacheTopology();
+    ASSERT_NE(nullptr, topo);
+    // 2 cores with SMT share L1 and L2. All cpus share L3.
+    ASSERT_EQ(7, topo->count);
+    EXPECT_EQ(48 * 1024u, topo->l1d_size);
+    EXPECT_EQ(32 * 1024u, topo->l1i_size);
+    EXPECT_EQ(1280 * 1024u, topo->l2_size);
+    EXPECT_EQ(30 * 1024 * 1024u, topo->l3_size);
+    EXPECT_EQ(64u, topo->line_size);
+
+    const envuCacheInfo *l1d = &topo->caches[0];
+    EXPECT_EQ(1, l1d->level);
+    EXPECT_EQ(ENVU_CACHE_DATA, l1d->type);
+    EXPECT_EQ(12u, l1d->ways);
+    EXPECT_EQ(2, l1d->shared_count);
+    EXPECT_EQ(1, envuCpuSetHas(l1d->shared_cpus, 1));
+    EXPECT_EQ(0, envuCpuSetHas(l1d->shared_cpus, 2));
+
+    const envuCacheInfo *l3 = &topo->caches[3];
+    EXPECT_EQ(3, l3->level);
+    EXPECT_EQ(ENVU_CACHE_UNIFIED, l3->type);
+    EXPECT_EQ(4, envuCpuSetCount(l3->shared_cpus));
+
+    const envuCacheInfo *l1d_2 = &topo->caches[4];
+    EXPECT_EQ(1, l1d_2->level);
+    EXPECT_EQ(1, envuCpuSetHas(l1d_2->shared_cpus, 2));
+    // L1 and L2 of a core share the same cpu set.
+    EXPECT_EQ(l1d->shared_cpus, topo->caches[2].shared_cpus);
+}
+
+TEST(CpuTest, envuGetNumaTopology) {
+    const envuNumaTopology *topo = envuGetNumaTopology();
+    ASSERT_NE(nullptr, topo);
+    ASSERT_LE(1, topo->count);
+    EXPECT_EQ(topo, envuGetNumaTopology());
+
+    int node = envuGetCurrentNumaNode();
+    ASSERT_LE(0, node);
+    bool found = false;
+    for (int i = 0; i < topo->count; i++)
+        found |= topo->nodes[i].id == node;
+    EXPECT_TRUE(found);
+}
+
+TEST_F(SysRootTest, envuGetNumaTopology) {
+    SetSysRoot("numa");
+    const envuNumaTopology *topo = envuGetNumaTopology();
+    ASSERT_NE(nullptr, topo);
+    ASSERT_EQ(2, topo->count);
+    EXPECT_EQ(0, topo->nodes[0].id);
+    EXPECT_EQ(1, topo->nodes[1].id);
+    EXPECT_EQ(8, envuCpuSetCount(&topo->nodes[0].cpus));
+    EXPECT_EQ(1, envuCpuSetHas(&topo->nodes[0].cpus, 9));
+    EXPECT_EQ(1, envuCpuSetHas(&topo->nodes[1].cpus, 12));
+    EXPECT_EQ(32768000ULL * 1024, topo->nodes[0].mem_total);
+    EXPECT_EQ(8192000ULL * 1024, topo->nodes[1].mem_free);
+    EXPECT_EQ(10, topo->distances[0]);
+    EXPECT_EQ(21, topo->distances[1]);
+    EXPECT_EQ(21, topo->distances[2]);
+    EXPECT_EQ(10, topo->distances[3]);
+}
+
+TEST_F(SysRootTest, envuGetNumaTopologyWithoutNuma) {
+    SetSysRoot("numa_none");
+    const envuNumaTopology *topo = envuGetNumaTopology();
+    ASSERT_NE(nullptr, topo);
+    ASSERT_EQ(1, topo->count);
+    EXPECT_EQ(0, topo->nodes[0].id);
+    EXPECT_EQ(2, envuCpuSetCount(&topo->nodes[0].cpus));
+    EXPECT_EQ(4096000ULL * 1024, topo->nodes[0].mem_total);
+    EXPECT_EQ(10, topo->distances[0]);
+}
+TEST(CpuTest, envuGetCpuTopology) {
+    const envuCpuTopology *topo = envuGetCpuTopology();
+    ASSERT_NE(nullptr, topo);
+    ASSERT_LE(1, topo->count);
+    EXPECT_LE(1, topo->core_count);
+    EXPECT_LE(1, topo->package_count);
+    EXPECT_TRUE(envuCpuSetHas(&topo->cpus[0].siblings, topo->cpus[0].id));
+}
+
+TEST(CpuTest, envuPinCurrentThread) {
+    envuCpuSet old_affinity;
+    int count = envuGetThreadAffinity(&old_affinity);
+    ASSERT_LE(1, count);
+    int cpu = 0;
+    while (!envuCpuSetHas(&old_affinity, cpu))
+        cpu++;
+    ASSERT_EQ(0, envuPinCurrentThread(cpu));
+    envuCpuSet affinity;
+    EXPECT_EQ(1, envuGetThreadAffinity(&affinity));
+    EXPECT_TRUE(envuCpuSetHas(&affinity, cpu));
+    EXPECT_EQ(-1, envuPinCurrentThread(-1));
+
+    // Restore the affinity
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int i = 0; i < CPU_SETSIZE; i++) {
+        if (envuCpuSetHas(&old_affinity, i))
+            CPU_SET(i, &set);
+    }
+    sched_setaffinity(0, sizeof(set), &set);
+}
+
+TEST(CpuTest, envuPlanWorkers) {
+    int *plan = envuPlanWorkers(4, ENVU_PLACE_SCATTER);
+    ASSERT_NE(nullptr, plan);
+    envuCpuSet affinity;
+    envuGetThreadAffinity(&affinity);
+    for (int i = 0; i < 4; i++) {
+        EXPECT_TRUE(envuCpuSetHas(&affinity, plan[i]));
+    }
+    envuFree(plan);
+    EXPECT_EQ(nullptr, envuPlanWorkers(0, ENVU_PLACE_COMPACT));
+}
+
+TEST_F(SysRootTest, envuGetCpuTopology) {
+    SetSysRoot("dual_socket");
+    const envuCpuTopology *topo = envuGetCpuTopology();
+    ASSERT_NE(nullptr, topo);
+    ASSERT_EQ(8, topo->count);
+    EXPECT_EQ(4, topo->core_count);
+    EXPECT_EQ(2, topo->package_count);
+    const envuLogicalCpu *cpu = &topo->cpus[6];
+    EXPECT_EQ(6, cpu->id);
+    EXPECT_EQ(0, cpu->core_id);
+    EXPECT_EQ(1, cpu->package_id);
+    EXPECT_EQ(1, cpu->node_id);
+    EXPECT_EQ(1, cpu->smt_index);
+    EXPECT_TRUE(envuCpuSetHas(&cpu->siblings, 2));
+    EXPECT_EQ(2, envuCpuSetCount(&cpu->siblings));
+}
+
+TEST_F(SysRootTest, envuPlanWorkers) {
+    SetSysRoot("dual_socket");
+    const int compact[] = { 0, 4, 1, 5, 2, 6, 3, 7, 0 };
+    const int scatter[] = { 0, 2, 1, 3, 4, 6, 5, 7, 0 };
+    int *plan = envuPlanWorkers(9, ENVU_PLACE_COMPACT);
+    ASSERT_NE(nullptr, plan);
+    for (int i = 0; i < 9; i++) {
+        EXPECT_EQ(compact[i], plan[i]);
+    }
+    envuFree(plan);
+    plan = envuPlanWorkers(9, ENVU_PLACE_SCATTER);
+    ASSERT_NE(nullptr, plan);
+    for (int i = 0; i < 9; i++) {
+        EXPECT_EQ(scatter[i], plan[i]);
+    }
+    envuFree(plan);
+    plan = envuPlanWorkers(2, ENVU_PLACE_NUMA_NODES);
+    ASSERT_NE(nullptr, plan);
+    EXPECT_EQ(0, plan[0]);
+    EXPECT_EQ(2, plan[1]);
+    envuFree(plan);
+}
+#else
+TEST(CpuTest, envuGetEffectiveCpuCount) {
+    envuCpuCountInfo info;
+    int count = envuGetEffectiveCpuCount(&info);
+    ASSERT_LE(1, count);
+    EXPECT_EQ(count, info.effective);
+}
+#endif
+
+TEST(CpuTest, envuGetCpuFeatures) {
+    const envuCpuFeatures *cpu = envuGetCpuFeatures();
+    ASSERT_NE(nullptr, cpu);
+    EXPECT_EQ(cpu, envuGetCpuFeatures());
+    for (int i = 0; i < ENVU_CPU_FEATURE_MAX; i++) {
+        envuCpuFeature f = (envuCpuFeature)i;
+        EXPECT_EQ((int)((cpu->features >> i) & 1), envuCpuHas(f));
+        EXPECT_NE(nullptr, envuGetCpuFeatureName(f));
+    }
+    EXPECT_EQ(0, envuCpuHas(ENVU_CPU_FEATURE_MAX));
+    EXPECT_EQ(nullptr, envuGetCpuFeatureName(ENVU_CPU_FEATURE_MAX));
+#if defined(__x86_64__) || defined(_M_X64)
+    // x86_64 always has SSE2.
+    EXPECT_TRUE(envuCpuHas(ENVU_CPU_SSE2));
+    EXPECT_STRNE("", cpu->vendor);
+    EXPECT_LT(0, cpu->family);
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    EXPECT_TRUE(envuCpuHas(ENVU_CPU_NEON));
+#endif
+    // Features that need OS support imply their base features.
+    if (envuCpuHas(ENVU_CPU_AVX2)) {
+        EXPECT_TRUE(envuCpuHas(ENVU_CPU_AVX));
+    }
+    if (envuCpuHas(ENVU_CPU_AVX512BW)) {
+        EXPECT_TRUE(envuCpuHas(ENVU_CPU_AVX512F));
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+// Tests for envu*CrashInfo functions
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include "env_utils.h"
+#include "true_env_info.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+
+static std::string WriteCrashInfoToPipe() {
+    int fds[2];
+    if (pipe(fds) != 0)
+        return "";
+    int ret = envuWriteCrashInfo(fds[1]);
+    close(fds[1]);
+    std::string out;
+    char buf[256];
+    ssize_t size;
+    while ((size = read(fds[0], buf, sizeof(buf))) > 0)
+        out.append(buf, size);
+    close(fds[0]);
+    return ret == 0 ? out : "";
+}
+
+TEST(CrashInfoTest, envuWriteCrashInfo) {
+    ASSERT_EQ(0, envuPrepareCrashInfo());
+    std::string out = WriteCrashInfoToPipe();
+    EXPECT_NE(std::string::npos, out.find(std::string("Executable: ") + TRUE_EXE_PATH + "\n"));
+    EXPECT_NE(std::string::npos, out.find(std::string("User: ") + TRUE_USERNAME + "\n"));
+    EXPECT_NE(std::string::npos, out.find(std::string("CWD: ") + TRUE_CWD + "\n"));
+}
+
+TEST_F(SymlinkTest, envuWriteCrashInfoAfterSetCwd) {
+    // SetUp() moved cwd to the build dir.
+    ASSERT_EQ(0, envuPrepareCrashInfo());
+    std::string out = WriteCrashInfoToPipe();
+    EXPECT_NE(std::string::npos, out.find(std::string("CWD: ") + TRUE_BUILD_DIR + "\n"));
+
+    ASSERT_EQ(0, envuSetCwd(TRUE_CWD));
+    out = WriteCrashInfoToPipe();
+    EXPECT_NE(std::string::npos, out.find(std::string("CWD: ") + TRUE_CWD + "\n"));
+    ASSERT_EQ(0, envuSetCwd(TRUE_BUILD_DIR));
+}
+
+TEST_F(SymlinkTest, envuWriteCrashInfoWhileSetCwd) {
+    ASSERT_EQ(0, envuPrepareCrashInfo());
+    std::string build_cwd = std::string("CWD: ") + TRUE_BUILD_DIR + "\n";
+    std::string true_cwd = std::string("CWD: ") + TRUE_CWD + "\n";
+    std::atomic<bool> done(false);
+    std::thread writer([&done] {
+        while (!done) {
+            envuSetCwd(TRUE_CWD);
+            envuSetCwd(TRUE_BUILD_DIR);
+            envuPrepareCrashInfo();
+        }
+    });
+    for (int i = 0; i < 1000; i++) {
+        std::string out = WriteCrashInfoToPipe();
+        ASSERT_NE(std::string::npos, out.find(std::string("User: ") + TRUE_USERNAME + "\n"));
+        size_t pos = out.find("CWD: ");
+        ASSERT_NE(std::string::npos, pos);
+        std::string cwd = out.substr(pos);
+        ASSERT_TRUE(cwd == build_cwd || cwd == true_cwd) << cwd;
+    }
+    done = true;
+    writer.join();
+    ASSERT_EQ(0, envuSetCwd(TRUE_BUILD_DIR));
+}
+
+TEST(CrashInfoTest, envuWriteCrashInfoInvalidFd) {
+    ASSERT_EQ(0, envuPrepareCrashInfo());
+    EXPECT_EQ(-1, envuWriteCrashInfo(-1));
+}
+#endif
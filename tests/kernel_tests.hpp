@@ -0,0 +1,52 @@
+#pragma once
+// Tests for envuGetKernelFeatures and its helpers
+
+#include <gtest/gtest.h>
+#include <string>
+#include "env_utils.h"
+#include "true_env_info.h"
+
+#ifdef __linux__
+TEST(KernelTest, envuGetKernelFeatures) {
+    const envuKernelFeatures *kf = envuGetKernelFeatures();
+    ASSERT_NE(nullptr, kf);
+    // The cache should return the same pointer.
+    EXPECT_EQ(kf, envuGetKernelFeatures());
+
+    std::string ver = std::to_string(kf->version_major) + "." +
+                      std::to_string(kf->version_minor) + "." +
+                      std::to_string(kf->version_patch);
+    EXPECT_EQ(0u, std::string(TRUE_OS_VERSION).find(ver));
+}
+
+TEST(KernelTest, envuCompareKernelVersion) {
+    const envuKernelFeatures *kf = envuGetKernelFeatures();
+    ASSERT_NE(nullptr, kf);
+    int major = kf->version_major;
+    int minor = kf->version_minor;
+    int patch = kf->version_patch;
+    EXPECT_EQ(0, envuCompareKernelVersion(major, minor, patch));
+    EXPECT_LT(0, envuCompareKernelVersion(major, minor, patch - 1));
+    EXPECT_GT(0, envuCompareKernelVersion(major, minor + 1, 0));
+    EXPECT_GT(0, envuCompareKernelVersion(major + 1, 0, 0));
+    EXPECT_LT(0, envuCompareKernelVersion(2, 6, 0));
+}
+
+TEST(KernelTest, envuHasKernelFeature) {
+    EXPECT_EQ(0, envuHasKernelFeature(ENVU_KF_MAX));
+    EXPECT_EQ(0, envuHasIoUringOp(256));
+    // IORING_OP_NOP is supported by every kernel that has io_uring and the probe API.
+    if (!envuHasKernelFeature(ENVU_KF_IO_URING)) {
+        EXPECT_EQ(0, envuHasIoUringOp(0));
+    }
+    if (envuCompareKernelVersion(3, 17, 0) >= 0) {
+        EXPECT_EQ(1, envuHasKernelFeature(ENVU_KF_MEMFD_CREATE));
+    }
+}
+#else
+TEST(KernelTest, envuGetKernelFeatures) {
+    EXPECT_EQ(nullptr, envuGetKernelFeatures());
+    EXPECT_EQ(0, envuHasKernelFeature(ENVU_KF_STATX));
+    EXPECT_EQ(-1, envuCompareKernelVersion(0, 0, 0));
+}
+#endif
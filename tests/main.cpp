@@ -2,6 +2,20 @@
 #include <gtest/gtest.h>
 #include "util_tests.hpp"
 #include "path_tests.hpp"
+#include "snapshot_tests.hpp"
+#include "crash_tests.hpp"
+#include "kernel_tests.hpp"
+#include "timezone_tests.hpp"
+#include "module_tests.hpp"
+#include "cpu_tests.hpp"
+#include "memory_tests.hpp"
+#include "sched_tests.hpp"
+#include "tunable_tests.hpp"
+#include "pressure_tests.hpp"
+#include "virt_tests.hpp"
+#include "bench_tests.hpp"
+#include "proc_tests.hpp"
+#include "storage_tests.hpp"
 #include "true_env_info.h"
 
 int main(int argc, char* argv[]) {
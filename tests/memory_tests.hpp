@@ -0,0 +1,115 @@
+#pragma once
+// Tests for envuGetMemoryInfo
+
+#include <gtest/gtest.h>
+#include "env_utils.h"
+#include "cpu_tests.hpp"
+
+TEST(MemoryTest, envuGetMemoryInfo) {
+    envuMemoryInfo info;
+    ASSERT_EQ(0, envuGetMemoryInfo(&info));
+    EXPECT_LT(0u, info.total);
+    EXPECT_LE(info.available, info.total);
+    EXPECT_LT(0u, info.page_size);
+    EXPECT_LE(info.effective_limit, info.total);
+    EXPECT_LE(info.budget, info.effective_limit);
+}
+
+TEST(MemoryTest, envuGetMemoryInfoNull) {
+    EXPECT_EQ(-1, envuGetMemoryInfo(NULL));
+}
+
+#ifdef __linux__
+TEST_F(SysRootTest, envuGetMemoryInfoCgroupV2) {
+    SetSysRoot("cgroup_v2");
+    envuMemoryInfo info;
+    ASSERT_EQ(0, envuGetMemoryInfo(&info));
+    EXPECT_EQ(16384000ULL * 1024, info.total);
+    EXPECT_EQ(8192000ULL * 1024, info.available);
+    EXPECT_EQ(2097152ULL * 1024, info.swap_total);
+    EXPECT_EQ(1048576ULL * 1024, info.swap_free);
+    EXPECT_EQ(2, info.cgroup_version);
+    // The limit of the parent is smaller.
+    EXPECT_EQ(1073741824ULL, info.cgroup_max);
+    EXPECT_EQ(ENVU_MEMORY_UNLIMITED, info.cgroup_high);
+    // 0 disables swap. It's not unlimited.
+    EXPECT_EQ(0u, info.cgroup_swap_max);
+    EXPECT_EQ(536870912ULL, info.cgroup_usage);
+    EXPECT_EQ(1073741824ULL, info.effective_limit);
+    EXPECT_EQ(1073741824ULL - 536870912ULL, info.budget);
+}
+
+TEST_F(SysRootTest, envuGetMemoryInfoCgroupV1) {
+    SetSysRoot("cgroup_v1");
+    envuMemoryInfo info;
+    ASSERT_EQ(0, envuGetMemoryInfo(&info));
+    EXPECT_EQ(8192000ULL * 1024, info.total);
+    // MemFree + Buffers + Cached
+    EXPECT_EQ(2024000ULL * 1024, info.available);
+    EXPECT_EQ(1, info.cgroup_version);
+    EXPECT_EQ(4294967296ULL, info.cgroup_max);
+    EXPECT_EQ(1073741824ULL, info.cgroup_usage);
+    EXPECT_EQ(2147483648ULL, info.cgroup_swap_max);
+    EXPECT_EQ(4294967296ULL, info.effective_limit);
+    // The available memory is smaller than the rest of the limit.
+    EXPECT_EQ(2024000ULL * 1024, info.budget);
+}
+
+TEST_F(SysRootTest, envuGetMemoryInfoNoMeminfo) {
+    SetSysRoot("no_one_use_this_dir");
+    envuMemoryInfo info;
+    EXPECT_EQ(-1, envuGetMemoryInfo(&info));
+}
+#endif
+
+#ifdef __linux__
+TEST(MemoryTest, envuGetHugePageInfo) {
+    const envuHugePageInfo *info = envuGetHugePageInfo();
+    ASSERT_NE(nullptr, info);
+    EXPECT_EQ(info, envuGetHugePageInfo());
+    for (int i = 0; i < info->size_count; i++) {
+        EXPECT_LT(0u, info->sizes[i].size);
+        EXPECT_LE(info->sizes[i].free, info->sizes[i].total + info->sizes[i].surplus);
+    }
+    EXPECT_LT(0u, info->memlock_limit);
+}
+
+TEST_F(SysRootTest, envuGetHugePageInfo) {
+    SetSysRoot("hugepages");
+    const envuHugePageInfo *info = envuGetHugePageInfo();
+    ASSERT_NE(nullptr, info);
+    ASSERT_EQ(2, info->size_count);
+    ASSERT_EQ(2, info->node_count);
+    EXPECT_EQ(1, info->node_ids[1]);
+    EXPECT_EQ(2048ULL * 1024, info->default_size);
+    const envuHugePageSize *hp = &info->sizes[0];
+    EXPECT_EQ(2048ULL * 1024, hp->size);
+    EXPECT_EQ(16u, hp->total);
+    EXPECT_EQ(10u, hp->free);
+    EXPECT_EQ(2u, hp->reserved);
+    EXPECT_EQ(8u, hp->node_total[0]);
+    EXPECT_EQ(6u, hp->node_free[0]);
+    EXPECT_EQ(4u, hp->node_free[1]);
+    EXPECT_EQ(1024ULL * 1024 * 1024, info->sizes[1].size);
+    EXPECT_EQ(0u, info->sizes[1].total);
+    EXPECT_STREQ("madvise", info->thp_enabled);
+    EXPECT_STREQ("madvise", info->thp_defrag);
+    EXPECT_STREQ("never", info->shmem_enabled);
+    EXPECT_EQ(2097152u, info->thp_pmd_size);
+
+    // The refreshed counts are stored in the same structure.
+    EXPECT_EQ(info, envuRefreshHugePageInfo());
+    EXPECT_EQ(hp, &envuGetHugePageInfo()->sizes[0]);
+    EXPECT_EQ(16u, hp->total);
+    EXPECT_EQ(6u, hp->node_free[0]);
+}
+
+TEST_F(SysRootTest, envuGetHugePageInfoWithoutHugePages) {
+    SetSysRoot("numa_none");
+    const envuHugePageInfo *info = envuGetHugePageInfo();
+    ASSERT_NE(nullptr, info);
+    EXPECT_EQ(0, info->size_count);
+    EXPECT_EQ(1, info->node_count);
+    EXPECT_STREQ("", info->thp_enabled);
+}
+#endif
@@ -0,0 +1,68 @@
+#pragma once
+// Tests for envuGetExecutableBuildId and envuGetLoadedModules
+
+#include <gtest/gtest.h>
+#include <string>
+#include "env_utils.h"
+#include "true_env_info.h"
+
+#ifdef __linux__
+static bool IsHexString(const char *str) {
+    if (str == NULL || *str == '\0')
+        return false;
+    for (const char *p = str; *p != '\0'; p++) {
+        if (!((*p >= '0' && *p <= '9') || (*p >= 'a' && *p <= 'f')))
+            return false;
+    }
+    return true;
+}
+
+TEST(ModuleTest, envuGetExecutableBuildId) {
+    char *build_id = envuGetExecutableBuildId();
+    ASSERT_NE(nullptr, build_id);
+    if (strncmp(build_id, "hash:", 5) == 0) {
+        EXPECT_TRUE(IsHexString(build_id + 5)) << "  build_id: " << build_id;
+    } else {
+        EXPECT_TRUE(IsHexString(build_id)) << "  build_id: " << build_id;
+    }
+
+    // The cached value should be the same.
+    char *build_id2 = envuGetExecutableBuildId();
+    EXPECT_STREQ(build_id, build_id2);
+    envuFree(build_id);
+    envuFree(build_id2);
+}
+
+TEST(ModuleTest, envuGetLoadedModules) {
+    int count;
+    envuModule *modules = envuGetLoadedModules(&count);
+    ASSERT_NE(nullptr, modules);
+    ASSERT_LT(0, count);
+    EXPECT_EQ(nullptr, modules[count].path);
+
+    // The first module is the executable.
+    EXPECT_STREQ(TRUE_EXE_PATH, modules[0].path);
+    char *build_id = envuGetExecutableBuildId();
+    if (modules[0].build_id != NULL) {
+        EXPECT_STREQ(build_id, modules[0].build_id);
+    }
+    envuFree(build_id);
+
+    // The cached list should be the same.
+    int count2;
+    envuModule *modules2 = envuGetLoadedModules(&count2);
+    ASSERT_EQ(count, count2);
+    for (int i = 0; i < count; i++) {
+        EXPECT_STREQ(modules[i].path, modules2[i].path);
+        EXPECT_EQ(modules[i].base, modules2[i].base);
+    }
+    envuFree(modules);
+    envuFree(modules2);
+}
+#else
+TEST(ModuleTest, envuGetLoadedModules) {
+    int count = -1;
+    EXPECT_EQ(nullptr, envuGetLoadedModules(&count));
+    EXPECT_EQ(0, count);
+}
+#endif
@@ -0,0 +1,66 @@
+#pragma once
+// Tests for Pressure Stall Information
+
+#include <gtest/gtest.h>
+#include "env_utils.h"
+#include "cpu_tests.hpp"
+
+#ifdef __linux__
+#include <poll.h>
+#include <unistd.h>
+
+TEST(PressureTest, envuGetPressure) {
+    envuPressure pressure;
+    if (envuGetPressure(ENVU_PRESSURE_MEMORY, &pressure) != 0) {
+        GTEST_SKIP() << "PSI is not available.";
+    }
+    EXPECT_LE(0.0, pressure.some.avg10);
+    EXPECT_GE(100.0, pressure.some.avg10);
+    EXPECT_EQ(1, pressure.has_full);
+    EXPECT_EQ(-1, envuGetPressure(ENVU_PRESSURE_CPU, NULL));
+}
+
+TEST(PressureTest, envuSubscribePressure) {
+    EXPECT_EQ(-1, envuSubscribePressure(ENVU_PRESSURE_MEMORY, 0, 2000000));
+    EXPECT_EQ(-1, envuSubscribePressure(ENVU_PRESSURE_MEMORY, 2000000, 2000000));
+    EXPECT_EQ(-1, envuSubscribePressure((envuPressureResource)100, 100000, 2000000));
+    int fd = envuSubscribePressure(ENVU_PRESSURE_MEMORY, 100000, 2000000);
+    if (fd == -1) {
+        GTEST_SKIP() << "PSI triggers are not available.";
+    }
+    struct pollfd pfd = { fd, POLLPRI, 0 };
+    EXPECT_LE(0, poll(&pfd, 1, 0));
+    close(fd);
+}
+
+TEST_F(SysRootTest, envuGetPressure) {
+    SetSysRoot("cgroup_v2");
+    envuPressure pressure;
+    ASSERT_EQ(0, envuGetPressure(ENVU_PRESSURE_MEMORY, &pressure));
+    EXPECT_EQ(1, pressure.from_cgroup);
+    EXPECT_DOUBLE_EQ(12.5, pressure.some.avg10);
+    EXPECT_DOUBLE_EQ(3.05, pressure.some.avg60);
+    EXPECT_DOUBLE_EQ(0.7, pressure.some.avg300);
+    EXPECT_EQ(123456789u, pressure.some.total);
+    EXPECT_EQ(1, pressure.has_full);
+    EXPECT_DOUBLE_EQ(0.25, pressure.full.avg60);
+    EXPECT_EQ(2345678u, pressure.full.total);
+
+    // Falls back to the system-wide pressure.
+    ASSERT_EQ(0, envuGetPressure(ENVU_PRESSURE_CPU, &pressure));
+    EXPECT_EQ(0, pressure.from_cgroup);
+    EXPECT_DOUBLE_EQ(0.42, pressure.some.avg10);
+    EXPECT_EQ(987654u, pressure.some.total);
+    EXPECT_EQ(0, pressure.has_full);
+
+    // Kernels without PSI
+    EXPECT_EQ(-1, envuGetPressure(ENVU_PRESSURE_IO, &pressure));
+    EXPECT_EQ(0u, pressure.some.total);
+}
+#else
+TEST(PressureTest, envuGetPressure) {
+    envuPressure pressure;
+    EXPECT_EQ(-1, envuGetPressure(ENVU_PRESSURE_MEMORY, &pressure));
+    EXPECT_EQ(-1, envuSubscribePressure(ENVU_PRESSURE_MEMORY, 100000, 2000000));
+}
+#endif
@@ -0,0 +1,238 @@
+#pragma once
+// Tests for envuSampler and envuSnapshotProcesses
+
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <gtest/gtest.h>
+#include "env_utils.h"
+#include "cpu_tests.hpp"
+
+#ifdef __linux__
+#include <time.h>
+#include <unistd.h>
+
+static void burnCpu(uint64_t ns) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    uint64_t start = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    volatile uint64_t sum = 0;
+    uint64_t now = start;
+    while (now - start < ns) {
+        for (int i = 0; i < 10000; i++)
+            sum += i;
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+        now = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+}
+
+TEST(ProcTest, envuSample) {
+    envuSampler *sampler = envuOpenSampler(0);
+    ASSERT_NE(nullptr, sampler);
+    envuProcessSample first;
+    ASSERT_EQ(0, envuSample(sampler, &first));
+    EXPECT_LT(0u, first.rss);
+    EXPECT_LE(1, first.thread_count);
+    EXPECT_LE(3, first.fd_count);
+    EXPECT_EQ(0u, first.elapsed_ns);
+    EXPECT_EQ(0u, first.delta.user_ns);
+
+    int fds[3];
+    for (int &fd : fds)
+        fd = dup(0);
+    burnCpu(50000000);
+    envuProcessSample second;
+    ASSERT_EQ(0, envuSample(sampler, &second));
+    for (int fd : fds)
+        close(fd);
+    EXPECT_LT(0u, second.elapsed_ns);
+    EXPECT_EQ(second.timestamp_ns - first.timestamp_ns, second.elapsed_ns);
+    EXPECT_LT(0u, second.delta.user_ns + second.delta.system_ns);
+    EXPECT_LT(0.0, second.cpu_usage);
+    EXPECT_EQ(first.fd_count + 3, second.fd_count);
+    EXPECT_LE(first.total.user_ns, second.total.user_ns);
+    envuCloseSampler(sampler);
+}
+
+TEST_F(SysRootTest, envuSample) {
+    SetSysRoot("sampler");
+    envuSampler *sampler = envuOpenSampler(0);
+    ASSERT_NE(nullptr, sampler);
+    envuProcessSample sample;
+    ASSERT_EQ(0, envuSample(sampler, &sample));
+    uint64_t ns_per_tick = 1000000000ULL / sysconf(_SC_CLK_TCK);
+    EXPECT_EQ(3000u * sysconf(_SC_PAGESIZE), sample.rss);
+    EXPECT_EQ(4, sample.thread_count);
+    EXPECT_EQ(5, sample.fd_count);
+    EXPECT_EQ(250 * ns_per_tick, sample.total.user_ns);
+    EXPECT_EQ(75 * ns_per_tick, sample.total.system_ns);
+    EXPECT_EQ(1500u, sample.total.minor_faults);
+    EXPECT_EQ(12u, sample.total.major_faults);
+    EXPECT_EQ(321u, sample.total.voluntary_switches);
+    EXPECT_EQ(45u, sample.total.involuntary_switches);
+
+    ASSERT_EQ(0, envuSample(sampler, &sample));
+    EXPECT_EQ(0, sample.delta_rss);
+    EXPECT_EQ(0u, sample.delta.voluntary_switches);
+    EXPECT_EQ(0.0, sample.cpu_usage);
+    envuCloseSampler(sampler);
+}
+
+TEST_F(SysRootTest, envuOpenSamplerNoProcess) {
+    SetSysRoot("sampler");
+    EXPECT_EQ(nullptr, envuOpenSampler(1234));
+    EXPECT_EQ(nullptr, envuOpenSampler(-1));
+    envuProcessSample sample;
+    EXPECT_EQ(-1, envuSample(nullptr, &sample));
+    envuCloseSampler(nullptr);
+}
+
+static const envuProcess *findProcess(const envuProcessSnapshot *snapshot, int pid) {
+    for (int i = 0; i < snapshot->count; i++) {
+        if (snapshot->processes[i].pid == pid)
+            return &snapshot->processes[i];
+    }
+    return nullptr;
+}
+
+TEST(ProcTest, envuSnapshotProcesses) {
+    std::atomic<bool> done(false);
+    std::thread worker([&done] {
+        while (!done)
+            std::this_thread::yield();
+    });
+    envuProcessFilter filter = {};
+    filter.has_uid = 1;
+    filter.uid = getuid();
+    unsigned int fields = ENVU_PROC_EXE | ENVU_PROC_CMDLINE | ENVU_PROC_THREADS;
+    envuProcessSnapshot *snapshot = envuSnapshotProcesses(fields, &filter);
+    done = true;
+    worker.join();
+    ASSERT_NE(nullptr, snapshot);
+    EXPECT_EQ(fields, snapshot->fields);
+    const envuProcess *self = findProcess(snapshot, getpid());
+    ASSERT_NE(nullptr, self);
+    EXPECT_EQ(0, self->is_thread);
+    EXPECT_EQ(getppid(), self->ppid);
+    char *exe = envuGetExecutablePath();
+    EXPECT_STREQ(exe, self->exe);
+    envuFree(exe);
+    ASSERT_NE(nullptr, self->cmdline);
+    EXPECT_NE(nullptr, strstr(self->cmdline, "env_utils_test"));
+    EXPECT_EQ(nullptr, self->cgroup);
+    int thread_count = 0;
+    for (int i = 0; i < snapshot->count; i++) {
+        const envuProcess *proc = &snapshot->processes[i];
+        EXPECT_EQ(getuid(), proc->uid);
+        if (proc->is_thread && proc->tgid == getpid()) {
+            thread_count++;
+            EXPECT_EQ(self->exe, proc->exe);
+        }
+    }
+    EXPECT_LE(1, thread_count);
+    envuFree(snapshot);
+}
+
+TEST_F(SysRootTest, envuSnapshotProcesses) {
+    SetSysRoot("procs");
+    const char *env_names[] = { "APP_MODE", "HOME" };
+    envuProcessFilter filter = {};
+    filter.env_names = env_names;
+    filter.env_name_count = 2;
+    filter.thread_count = 2;
+    unsigned int fields = ENVU_PROC_EXE | ENVU_PROC_CMDLINE | ENVU_PROC_ENVIRON |
+                          ENVU_PROC_CGROUP | ENVU_PROC_THREADS;
+    envuProcessSnapshot *snapshot = envuSnapshotProcesses(fields, &filter);
+    ASSERT_NE(nullptr, snapshot);
+    ASSERT_EQ(3, snapshot->count);
+    ASSERT_EQ(2, snapshot->env_name_count);
+    EXPECT_STREQ("APP_MODE", snapshot->env_names[0]);
+
+    const envuProcess *init = &snapshot->processes[0];
+    EXPECT_EQ(1, init->pid);
+    EXPECT_EQ(0, init->ppid);
+    EXPECT_EQ('S', init->state);
+    EXPECT_EQ(5u, init->start_time);
+    EXPECT_STREQ("init", init->comm);
+    EXPECT_STREQ("/sbin/init", init->exe);
+    EXPECT_STREQ("/sbin/init splash", init->cmdline);
+    EXPECT_STREQ("/init.scope", init->cgroup);
+    ASSERT_NE(nullptr, init->env_values);
+    EXPECT_EQ(nullptr, init->env_values[0]);
+    EXPECT_STREQ("/", init->env_values[1]);
+
+    const envuProcess *app = &snapshot->processes[1];
+    EXPECT_EQ(200, app->pid);
+    EXPECT_EQ(200, app->tgid);
+    EXPECT_EQ('R', app->state);
+    EXPECT_EQ(12345u, app->start_time);
+    EXPECT_STREQ("my (app)", app->comm);
+    EXPECT_STREQ("/opt/app/bin/app", app->exe);
+    EXPECT_STREQ("./app --port 8080", app->cmdline);
+    EXPECT_STREQ("/app", app->cgroup);
+    ASSERT_NE(nullptr, app->env_values);
+    EXPECT_STREQ("fast", app->env_values[0]);
+    EXPECT_EQ(nullptr, app->env_values[1]);
+
+    const envuProcess *worker = &snapshot->processes[2];
+    EXPECT_EQ(201, worker->pid);
+    EXPECT_EQ(200, worker->tgid);
+    EXPECT_EQ(1, worker->is_thread);
+    EXPECT_STREQ("worker", worker->comm);
+    EXPECT_STREQ("/app/worker", worker->cgroup);
+    EXPECT_EQ(app->exe, worker->exe);
+    EXPECT_EQ(app->env_values, worker->env_values);
+
+    envuProcessSnapshot *updated = envuUpdateProcessSnapshot(snapshot);
+    envuFree(snapshot);
+    ASSERT_NE(nullptr, updated);
+    EXPECT_EQ(3, updated->count);
+    EXPECT_EQ(3, updated->reused_count);
+    EXPECT_STREQ("./app --port 8080", updated->processes[1].cmdline);
+    EXPECT_STREQ("fast", updated->processes[1].env_values[0]);
+    EXPECT_STREQ("APP_MODE", updated->env_names[0]);
+    envuFree(updated);
+}
+
+TEST_F(SysRootTest, envuSnapshotProcessesFilter) {
+    SetSysRoot("procs");
+    envuProcessFilter filter = {};
+    filter.comm = "my (app)";
+    envuProcessSnapshot *snapshot = envuSnapshotProcesses(0, &filter);
+    ASSERT_NE(nullptr, snapshot);
+    ASSERT_EQ(1, snapshot->count);
+    EXPECT_EQ(200, snapshot->processes[0].pid);
+    EXPECT_EQ(nullptr, snapshot->processes[0].exe);
+    EXPECT_EQ(nullptr, snapshot->processes[0].env_values);
+    envuProcessSnapshot *updated = envuUpdateProcessSnapshot(snapshot);
+    envuFree(snapshot);
+    ASSERT_NE(nullptr, updated);
+    EXPECT_EQ(1, updated->count);
+    EXPECT_STREQ("my (app)", updated->filter.comm);
+    envuFree(updated);
+
+    filter.comm = nullptr;
+    filter.has_uid = 1;
+    filter.uid = getuid() + 1;
+    snapshot = envuSnapshotProcesses(0, &filter);
+    ASSERT_NE(nullptr, snapshot);
+    EXPECT_EQ(0, snapshot->count);
+    envuFree(snapshot);
+
+    filter.has_uid = 0;
+    filter.env_name_count = ENVU_MAX_PROCESS_ENV + 1;
+    EXPECT_EQ(nullptr, envuSnapshotProcesses(ENVU_PROC_ENVIRON, &filter));
+    EXPECT_EQ(nullptr, envuUpdateProcessSnapshot(nullptr));
+}
+#else
+TEST(ProcTest, envuOpenSampler) {
+    EXPECT_EQ(nullptr, envuOpenSampler(0));
+    envuProcessSample sample;
+    EXPECT_EQ(-1, envuSample(nullptr, &sample));
+    envuCloseSampler(nullptr);
+}
+
+TEST(ProcTest, envuSnapshotProcesses) {
+    EXPECT_EQ(nullptr, envuSnapshotProcesses(0, nullptr));
+}
+#endif
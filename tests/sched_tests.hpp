@@ -0,0 +1,57 @@
+#pragma once
+// Tests for envuGetSchedEnvironment
+
+#include <gtest/gtest.h>
+#include "env_utils.h"
+#include "cpu_tests.hpp"
+
+#ifdef __linux__
+TEST(SchedTest, envuGetSchedEnvironment) {
+    envuSchedEnvironment env;
+    ASSERT_EQ(0, envuGetSchedEnvironment(&env));
+    EXPECT_NE(ENVU_SCHED_UNKNOWN, env.policy);
+    EXPECT_LE(-20, env.nice);
+    EXPECT_GE(19, env.nice);
+    ASSERT_NE(nullptr, env.perf_cmdline);
+    EXPECT_EQ(-1, envuGetSchedEnvironment(NULL));
+}
+
+TEST_F(SysRootTest, envuGetSchedEnvironment) {
+    SetSysRoot("sched");
+    envuSchedEnvironment env;
+    ASSERT_EQ(0, envuGetSchedEnvironment(&env));
+    // sysfs is preferred to the command line
+    EXPECT_EQ(3, envuCpuSetCount(&env.isolated));
+    EXPECT_TRUE(envuCpuSetHas(&env.isolated, 4));
+    EXPECT_EQ(4, envuCpuSetCount(&env.nohz_full));
+    EXPECT_TRUE(envuCpuSetHas(&env.rcu_nocbs, 5));
+    EXPECT_EQ(1, env.autogroup);
+    EXPECT_STREQ("isolcpus=domain,managed_irq,2-3 nohz_full=2-5 rcu_nocbs=2-5 mitigations=off",
+                 env.perf_cmdline);
+}
+
+TEST_F(SysRootTest, envuGetKernelCmdlineValue) {
+    SetSysRoot("sched");
+    EXPECT_STREQ("/vmlinuz", envuGetKernelCmdlineValue("BOOT_IMAGE"));
+    EXPECT_STREQ("", envuGetKernelCmdlineValue("ro"));
+    EXPECT_STREQ("Windows 2015", envuGetKernelCmdlineValue("acpi_osi"));
+    // The last one is used.
+    EXPECT_STREQ("1", envuGetKernelCmdlineValue("quiet"));
+    EXPECT_EQ(nullptr, envuGetKernelCmdlineValue("nosmt"));
+    EXPECT_EQ(nullptr, envuGetKernelCmdlineValue(NULL));
+}
+
+TEST_F(SysRootTest, envuGetSchedEnvironmentWithoutFiles) {
+    SetSysRoot("numa_none");
+    envuSchedEnvironment env;
+    ASSERT_EQ(0, envuGetSchedEnvironment(&env));
+    EXPECT_EQ(0, envuCpuSetCount(&env.isolated));
+    EXPECT_EQ(-1, env.autogroup);
+    EXPECT_STREQ("", env.perf_cmdline);
+    EXPECT_EQ(nullptr, envuGetKernelCmdlineValue("ro"));
+}
+#else
+TEST(SchedTest, envuGetKernelCmdlineValue) {
+    EXPECT_EQ(nullptr, envuGetKernelCmdlineValue("ro"));
+}
+#endif
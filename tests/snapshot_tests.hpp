@@ -0,0 +1,53 @@
+#pragma once
+// Tests for envu*Snapshot functions
+
+#include <gtest/gtest.h>
+#include <string>
+#include "env_utils.h"
+#include "true_env_info.h"
+
+#ifndef _WIN32
+TEST(SnapshotTest, envuAttachSnapshot) {
+    ASSERT_EQ(0, envuPublishSnapshot());
+    char *env = envuGetEnv("ENVU_SNAPSHOT");
+    EXPECT_NE(nullptr, env);
+    envuFree(env);
+
+    // The publisher can attach to its own snapshot.
+    ASSERT_EQ(0, envuAttachSnapshot());
+    char *username = envuGetUsername();
+    EXPECT_STREQ(TRUE_USERNAME, username);
+    envuFree(username);
+    char *os = envuGetOS();
+    EXPECT_STREQ(TRUE_OS, os);
+    envuFree(os);
+    char *prod_name = envuGetOSProductName();
+    EXPECT_STREQ(TRUE_OS_PRODUCT_NAME, prod_name);
+    envuFree(prod_name);
+    envuDetachSnapshot();
+
+    envuUnpublishSnapshot();
+    env = envuGetEnv("ENVU_SNAPSHOT");
+    EXPECT_EQ(nullptr, env);
+}
+
+TEST_F(SymlinkTest, envuAttachSnapshotChild) {
+    ASSERT_EQ(0, envuPublishSnapshot());
+    std::string out = Exec("./test_cli/test_cli snapshot");
+    std::string expected = std::string("0 ") + TRUE_USERNAME;
+    EXPECT_STREQ(expected.c_str(), out.c_str());
+    envuUnpublishSnapshot();
+}
+
+TEST(SnapshotTest, envuAttachSnapshotInvalid) {
+    const char *cases[] = {
+        "", "fd:", "fd:-1", "fd:999999", "fd:0", "shm:/no-one-use-this-shm", "unknown",
+    };
+    for (const char *c : cases) {
+        envuSetEnv("ENVU_SNAPSHOT", c);
+        EXPECT_EQ(-1, envuAttachSnapshot()) << "  ENVU_SNAPSHOT: " << c << std::endl;
+    }
+    envuSetEnv("ENVU_SNAPSHOT", NULL);
+    EXPECT_EQ(-1, envuAttachSnapshot());
+}
+#endif
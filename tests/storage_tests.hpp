@@ -0,0 +1,282 @@
+#pragma once
+// Tests for envuGetStorageInfo, envuGetFsCapabilities, envuGetMountForPath,
+// and envuGetFastScratchDir
+
+#include <string.h>
+#include <gtest/gtest.h>
+#include "env_utils.h"
+#include "cpu_tests.hpp"
+
+#ifdef __linux__
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+TEST(StorageTest, envuGetStorageInfo) {
+    struct stat st;
+    ASSERT_EQ(0, stat(".", &st));
+    const envuStorageInfo *info = envuGetStorageInfo(".");
+    if (info == nullptr) {
+        // e.g. overlayfs and tmpfs have no block device.
+        GTEST_SKIP() << "The current directory is not on a block device.";
+    }
+    EXPECT_EQ(major(st.st_dev), info->top.major);
+    EXPECT_EQ(minor(st.st_dev), info->top.minor);
+    EXPECT_NE('\0', info->top.name[0]);
+    EXPECT_LE(1, info->device_count);
+    EXPECT_LT(0u, info->devices[0].logical_block_size);
+    EXPECT_EQ(info, envuGetStorageInfo("."));
+    EXPECT_EQ(nullptr, envuGetStorageInfo("/not/exist"));
+}
+
+TEST_F(SysRootTest, envuGetStorageInfoPartition) {
+    SetSysRoot("storage");
+    const envuStorageInfo *info = envuGetStorageInfoForDevice(8, 1);
+    ASSERT_NE(nullptr, info);
+    EXPECT_STREQ("partition", info->type);
+    EXPECT_STREQ("sda1", info->top.name);
+    EXPECT_EQ(8u, info->top.major);
+    EXPECT_EQ(1u, info->top.minor);
+    EXPECT_EQ(1, info->top.rotational);
+    EXPECT_STREQ("bfq", info->top.scheduler);
+    ASSERT_EQ(1, info->device_count);
+    const envuBlockDevice *sda = &info->devices[0];
+    EXPECT_STREQ("sda", sda->name);
+    EXPECT_EQ(0u, sda->minor);
+    EXPECT_EQ(1, sda->rotational);
+    EXPECT_EQ(0, sda->is_nvme);
+    EXPECT_EQ(512u, sda->logical_block_size);
+    EXPECT_EQ(4096u, sda->physical_block_size);
+    EXPECT_EQ(64, sda->nr_requests);
+    EXPECT_STREQ("bfq", sda->scheduler);
+    EXPECT_EQ(1280u, sda->max_sectors_kb);
+    EXPECT_EQ(4096, sda->read_ahead_kb);
+    EXPECT_EQ(1, info->rotational);
+    EXPECT_EQ(0, info->is_nvme);
+    EXPECT_EQ(info, envuGetStorageInfoForDevice(8, 1));
+}
+
+TEST_F(SysRootTest, envuGetStorageInfoNvme) {
+    SetSysRoot("storage");
+    const envuStorageInfo *info = envuGetStorageInfoForDevice(259, 0);
+    ASSERT_NE(nullptr, info);
+    EXPECT_STREQ("disk", info->type);
+    ASSERT_EQ(1, info->device_count);
+    EXPECT_STREQ("nvme0n1", info->devices[0].name);
+    EXPECT_STREQ("none", info->devices[0].scheduler);
+    EXPECT_EQ(1023, info->devices[0].nr_requests);
+    EXPECT_EQ(0, info->rotational);
+    EXPECT_EQ(1, info->is_nvme);
+}
+
+TEST_F(SysRootTest, envuGetStorageInfoDeviceMapper) {
+    SetSysRoot("storage");
+    const envuStorageInfo *info = envuGetStorageInfoForDevice(253, 0);
+    ASSERT_NE(nullptr, info);
+    EXPECT_STREQ("dm", info->type);
+    EXPECT_STREQ("dm-0", info->top.name);
+    EXPECT_EQ(4096u, info->top.logical_block_size);
+    EXPECT_EQ(0, info->top.rotational);
+    ASSERT_EQ(2, info->device_count);
+    const char *name0 = info->devices[0].name;
+    const char *name1 = info->devices[1].name;
+    EXPECT_TRUE((strcmp(name0, "sda") == 0 && strcmp(name1, "nvme0n1") == 0) ||
+                (strcmp(name0, "nvme0n1") == 0 && strcmp(name1, "sda") == 0));
+    // A rotational disk slows down the whole stack.
+    EXPECT_EQ(1, info->rotational);
+    EXPECT_EQ(0, info->is_nvme);
+    EXPECT_EQ(nullptr, envuGetStorageInfoForDevice(1, 99));
+}
+static int countEntries(const char *path) {
+    DIR *dir = opendir(path);
+    if (dir == nullptr)
+        return -1;
+    int count = 0;
+    while (readdir(dir) != nullptr)
+        count++;
+    closedir(dir);
+    return count;
+}
+
+TEST(StorageTest, envuGetFsCapabilities) {
+    int entry_count = countEntries(".");
+    envuFsCapabilities caps;
+    ASSERT_EQ(0, envuGetFsCapabilities(".", &caps));
+    ASSERT_NE(nullptr, caps.type_name);
+    EXPECT_LT(0u, caps.block_size);
+    EXPECT_LT(0u, caps.total_bytes);
+    EXPECT_LE(caps.available_bytes, caps.free_bytes);
+    EXPECT_EQ(0u, caps.mount_flags & ENVU_MOUNT_RDONLY);
+    EXPECT_EQ(1, caps.probed);
+    EXPECT_NE(-1, caps.o_direct);
+    EXPECT_NE(-1, caps.sparse_files);
+    // Probe files should not be left.
+    EXPECT_EQ(entry_count, countEntries("."));
+
+    envuFsCapabilities file_caps;
+    ASSERT_EQ(0, envuGetFsCapabilities("meson.build", &file_caps));
+    EXPECT_EQ(caps.fs_id, file_caps.fs_id);
+    EXPECT_EQ(caps.o_direct, file_caps.o_direct);
+    EXPECT_EQ(caps.fallocate_modes, file_caps.fallocate_modes);
+    EXPECT_EQ(-1, envuGetFsCapabilities("/not/exist", &caps));
+}
+
+TEST(StorageTest, envuGetFsCapabilitiesTmpfs) {
+    envuFsCapabilities caps;
+    if (envuGetFsCapabilities("/dev/shm", &caps) != 0 || caps.type != ENVU_FS_TMPFS)
+        GTEST_SKIP() << "/dev/shm is not tmpfs.";
+    EXPECT_STREQ("tmpfs", caps.type_name);
+    EXPECT_EQ(0x01021994u, caps.fs_magic);
+    if (caps.probed) {
+        EXPECT_EQ(1, caps.sparse_files);
+        EXPECT_EQ(0, caps.reflink);
+        EXPECT_NE(0u, caps.fallocate_modes & ENVU_FALLOC_PUNCH_HOLE);
+    }
+}
+
+TEST(StorageTest, envuGetFsCapabilitiesReadOnly) {
+    envuFsCapabilities caps;
+    ASSERT_EQ(0, envuGetFsCapabilities("/proc", &caps));
+    EXPECT_EQ(ENVU_FS_UNKNOWN, caps.type);
+    EXPECT_STREQ("unknown", caps.type_name);
+    EXPECT_EQ(0x9FA0u, caps.fs_magic);
+    EXPECT_EQ(0, caps.probed);
+    EXPECT_EQ(-1, caps.o_direct);
+    EXPECT_EQ(-1, caps.reflink);
+    EXPECT_EQ(0u, caps.fallocate_modes);
+}
+TEST(StorageTest, envuGetMountForPath) {
+    envuMount *mount = envuGetMountForPath("/proc/self");
+    ASSERT_NE(nullptr, mount);
+    EXPECT_STREQ("/proc", mount->mount_point);
+    EXPECT_STREQ("proc", mount->fstype);
+    envuFree(mount);
+
+    struct stat st;
+    ASSERT_EQ(0, stat(".", &st));
+    mount = envuGetMountForPath(".");
+    ASSERT_NE(nullptr, mount);
+    EXPECT_EQ(major(st.st_dev), mount->major);
+    EXPECT_EQ(minor(st.st_dev), mount->minor);
+    envuFree(mount);
+}
+
+TEST_F(SysRootTest, envuGetMountForPath) {
+    SetSysRoot("mounts");
+    envuMount *mount = envuGetMountForPath("/home/user/../user/file.txt");
+    ASSERT_NE(nullptr, mount);
+    EXPECT_EQ(23, mount->mount_id);
+    EXPECT_EQ(21, mount->parent_id);
+    EXPECT_EQ(8u, mount->major);
+    EXPECT_EQ(2u, mount->minor);
+    EXPECT_STREQ("/", mount->root);
+    EXPECT_STREQ("/home", mount->mount_point);
+    EXPECT_STREQ("xfs", mount->fstype);
+    EXPECT_STREQ("/dev/sda2", mount->source);
+    EXPECT_STREQ("rw,relatime", mount->options);
+    EXPECT_STREQ("rw,attr2,inode64", mount->super_options);
+    EXPECT_EQ((unsigned)ENVU_PROPAGATION_SHARED, mount->propagation);
+    EXPECT_EQ(2, mount->peer_group);
+    envuFree(mount);
+
+    mount = envuGetMountForPath("/homework");
+    ASSERT_NE(nullptr, mount);
+    EXPECT_EQ(21, mount->mount_id);
+    envuFree(mount);
+
+    mount = envuGetMountForPath("/mnt/nfs/a/b");
+    ASSERT_NE(nullptr, mount);
+    EXPECT_STREQ("nfs4", mount->fstype);
+    EXPECT_STREQ("server:/export", mount->source);
+    EXPECT_EQ((unsigned)ENVU_PROPAGATION_SLAVE, mount->propagation);
+    EXPECT_EQ(3, mount->master);
+    envuFree(mount);
+
+    mount = envuGetMountForPath("/mnt/my disk/file");
+    ASSERT_NE(nullptr, mount);
+    EXPECT_EQ(25, mount->mount_id);
+    EXPECT_STREQ("/mnt/my disk", mount->mount_point);
+    EXPECT_EQ(0u, mount->propagation);
+    envuFree(mount);
+
+    mount = envuGetMountForPath("/var/lib/docker/overlay2/abc/merged/etc");
+    ASSERT_NE(nullptr, mount);
+    EXPECT_STREQ("overlay", mount->fstype);
+    EXPECT_EQ((unsigned)ENVU_PROPAGATION_UNBINDABLE, mount->propagation);
+    envuFree(mount);
+}
+
+TEST_F(SysRootTest, envuGetMountForPathOvermount) {
+    SetSysRoot("mounts");
+    // 29 is mounted on 27, so it hides 27 and 28.
+    envuMount *mount = envuGetMountForPath("/data/cache/file");
+    ASSERT_NE(nullptr, mount);
+    EXPECT_EQ(29, mount->mount_id);
+    EXPECT_STREQ("rw,size=2048k", mount->super_options);
+    EXPECT_EQ((unsigned)(ENVU_PROPAGATION_SHARED | ENVU_PROPAGATION_SLAVE), mount->propagation);
+    EXPECT_EQ(5, mount->peer_group);
+    EXPECT_EQ(4, mount->master);
+    envuFree(mount);
+
+    mount = envuGetMountForPath("/data/logs/app.log");
+    ASSERT_NE(nullptr, mount);
+    EXPECT_EQ(30, mount->mount_id);
+    EXPECT_STREQ("/sub", mount->root);
+    envuFree(mount);
+}
+TEST(StorageTest, envuGetFastScratchDir) {
+    char *dir = envuGetFastScratchDir(0, 0);
+    ASSERT_NE(nullptr, dir);
+    EXPECT_EQ('/', dir[0]);
+    EXPECT_TRUE(envuPathExists(dir));
+    char *cached = envuGetFastScratchDir(0, 0);
+    EXPECT_STREQ(dir, cached);
+    char *refreshed = envuGetFastScratchDir(0, ENVU_SCRATCH_REFRESH);
+    EXPECT_STREQ(dir, refreshed);
+    envuFree(cached);
+    envuFree(refreshed);
+    EXPECT_EQ(nullptr, envuGetFastScratchDir(UINT64_MAX, 0));
+    // The threshold is checked against the cached directory.
+    cached = envuGetFastScratchDir(1, 0);
+    EXPECT_STREQ(dir, cached);
+    envuFree(dir);
+    envuFree(cached);
+}
+
+TEST(StorageTest, envuGetFastScratchDirMemory) {
+    envuFsCapabilities caps;
+    if (envuGetFsCapabilities("/dev/shm", &caps) != 0 || caps.type != ENVU_FS_TMPFS ||
+        !caps.probed)
+        GTEST_SKIP() << "/dev/shm is not a writable tmpfs.";
+    char *dir = envuGetFastScratchDir(0, ENVU_SCRATCH_MEMORY);
+    ASSERT_NE(nullptr, dir);
+    ASSERT_EQ(0, envuGetFsCapabilities(dir, &caps));
+    EXPECT_EQ(ENVU_FS_TMPFS, caps.type);
+    envuFree(dir);
+
+    envuFsCapabilities tmp_caps;
+    if (envuGetFsCapabilities("/tmp", &tmp_caps) != 0 || tmp_caps.type == ENVU_FS_TMPFS ||
+        !tmp_caps.probed)
+        return;
+    // /tmp is on a disk, so a disk should be selected.
+    dir = envuGetFastScratchDir(0, ENVU_SCRATCH_LOCAL_DISK);
+    ASSERT_NE(nullptr, dir);
+    ASSERT_EQ(0, envuGetFsCapabilities(dir, &caps));
+    EXPECT_NE(ENVU_FS_TMPFS, caps.type);
+    envuFree(dir);
+}
+#else
+TEST(StorageTest, envuGetStorageInfo) {
+    EXPECT_EQ(nullptr, envuGetStorageInfo("."));
+    EXPECT_EQ(nullptr, envuGetStorageInfoForDevice(8, 0));
+}
+
+TEST(StorageTest, envuGetFsCapabilities) {
+    envuFsCapabilities caps;
+    EXPECT_EQ(-1, envuGetFsCapabilities(".", &caps));
+}
+
+TEST(StorageTest, envuGetMountForPath) {
+    EXPECT_EQ(nullptr, envuGetMountForPath("."));
+}
+#endif
@@ -4,6 +4,7 @@
 enum {
     CMD_UNK,
     CMD_EXE_PATH,
+    CMD_SNAPSHOT,
 };
 
 int main(int argc, char **argv) {
@@ -13,6 +14,8 @@ int main(int argc, char **argv) {
 
     if (argv[1][0] == 'e')
         cmd = CMD_EXE_PATH;
+    else if (argv[1][0] == 's')
+        cmd = CMD_SNAPSHOT;
     else
         cmd = CMD_UNK;
 
@@ -21,6 +24,12 @@ int main(int argc, char **argv) {
         return 1;
     } else if (cmd == CMD_EXE_PATH) {
         printf("%s\n", envuGetExecutablePath());
+    } else if (cmd == CMD_SNAPSHOT) {
+        // Print the result of envuAttachSnapshot and a value from the snapshot.
+        int ret = envuAttachSnapshot();
+        char *user = envuGetUsername();
+        printf("%d %s\n", ret, user);
+        envuFree(user);
     }
     return 0;
 }
@@ -0,0 +1,83 @@
+#pragma once
+// Tests for envuGetTimezone and envuPinTimezone
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <utility>
+#include "env_utils.h"
+
+class TimezoneTest : public ::testing::Test {
+ protected:
+    virtual void SetUp() {
+        tz = envuGetEnv("TZ");
+    }
+
+    virtual void TearDown() {
+        // restore the TZ variable
+        envuSetEnv("TZ", tz);
+        envuFree(tz);
+    }
+
+    char *tz;
+};
+
+TEST_F(TimezoneTest, envuGetTimezoneWithTZ) {
+    std::vector<std::pair<const char*, const char*>> cases = {
+        { "Asia/Tokyo", "Asia/Tokyo" },
+        { "EST5EDT", "EST5EDT" },
+#ifndef _WIN32
+        { ":Asia/Tokyo", "Asia/Tokyo" },
+        { "", "UTC" },
+        { ":", "UTC" },
+#endif
+    };
+    for (auto c : cases) {
+        envuSetEnv("TZ", c.first);
+        char *name = envuGetTimezone();
+        EXPECT_STREQ(c.second, name) << "  TZ: " << c.first << std::endl;
+        envuFree(name);
+    }
+}
+
+#ifdef __linux__
+TEST_F(TimezoneTest, envuGetTimezoneWithoutTZ) {
+    if (!envuPathExists("/etc/localtime") && !envuPathExists("/etc/timezone"))
+        GTEST_SKIP() << "No timezone files found";
+
+    envuSetEnv("TZ", NULL);
+    char *name = envuGetTimezone();
+    ASSERT_NE(nullptr, name);
+    EXPECT_STRNE("", name);
+
+    // TZ=:/etc/localtime should be the same as unset TZ.
+    envuSetEnv("TZ", ":/etc/localtime");
+    char *name2 = envuGetTimezone();
+    EXPECT_STREQ(name, name2);
+    envuFree(name);
+    envuFree(name2);
+}
+
+TEST_F(TimezoneTest, envuPinTimezone) {
+    envuSetEnv("TZ", NULL);
+    int ret = envuPinTimezone();
+    if (!envuPathExists("/etc/localtime") && !envuPathExists("/etc/timezone")) {
+        EXPECT_EQ(-1, ret);
+        return;
+    }
+    EXPECT_EQ(0, ret);
+    char *env = envuGetEnv("TZ");
+    ASSERT_NE(nullptr, env);
+    if (envuPathExists("/etc/localtime")) {
+        EXPECT_STREQ(":/etc/localtime", env);
+    }
+    envuFree(env);
+
+    // It should keep the TZ variable.
+    envuSetEnv("TZ", "Asia/Tokyo");
+    EXPECT_EQ(0, envuPinTimezone());
+    env = envuGetEnv("TZ");
+    EXPECT_STREQ("Asia/Tokyo", env);
+    envuFree(env);
+}
+#endif
@@ -0,0 +1,96 @@
+#pragma once
+// Tests for envuAuditTunables
+
+#include <gtest/gtest.h>
+#include "env_utils.h"
+#include "cpu_tests.hpp"
+
+TEST(TunableTest, envuGetDefaultTunableRules) {
+    int count = 0;
+    const envuTunableRule *rules = envuGetDefaultTunableRules(&count);
+    ASSERT_NE(nullptr, rules);
+    ASSERT_LT(0, count);
+    EXPECT_STREQ("vm.swappiness", rules[0].name);
+}
+
+#ifdef __linux__
+TEST(TunableTest, envuAuditTunables) {
+    envuTunableReport report;
+    int mismatch = envuAuditTunables(&report);
+    ASSERT_LE(0, mismatch);
+    EXPECT_EQ(mismatch, report.mismatch_count);
+    int count;
+    envuGetDefaultTunableRules(&count);
+    EXPECT_EQ(count, report.count);
+    envuFree(report.findings);
+    EXPECT_EQ(-1, envuAuditTunables(NULL));
+}
+
+TEST_F(SysRootTest, envuAuditTunables) {
+    SetSysRoot("sysctl");
+    envuTunableReport report;
+    ASSERT_EQ(4, envuAuditTunables(&report));
+    ASSERT_NE(nullptr, report.findings);
+    const envuTunableFinding *f = &report.findings[0];
+    EXPECT_STREQ("vm.swappiness", f->name);
+    EXPECT_EQ(ENVU_TUNABLE_MISMATCH, f->status);
+    EXPECT_EQ(60, f->actual);
+    EXPECT_EQ(ENVU_TUNABLE_MAX, f->check);
+    EXPECT_EQ(10, f->recommended);
+    EXPECT_NE(nullptr, f->reason);
+    EXPECT_EQ(ENVU_TUNABLE_OK, report.findings[1].status);
+    for (int i = 0; i < report.count; i++) {
+        if (strcmp(report.findings[i].name, "net.ipv4.tcp_max_syn_backlog") == 0) {
+            EXPECT_EQ(ENVU_TUNABLE_UNAVAILABLE, report.findings[i].status);
+        }
+    }
+    envuFree(report.findings);
+}
+
+TEST_F(SysRootTest, envuAuditTunablesWithRules) {
+    SetSysRoot("sysctl");
+    std::string name = "net.ipv4.ip_local_port_range";
+    const envuTunableRule rules[] = {
+        { name.c_str(), ENVU_TUNABLE_MIN, 10000, NULL },
+        { "fs.file-max", ENVU_TUNABLE_EQ, 9223372036854775807LL, "test" },
+        { "../../etc/passwd", ENVU_TUNABLE_EQ, 0, NULL },
+    };
+    envuTunableReport report;
+    ASSERT_EQ(0, envuAuditTunablesWithRules(rules, 3, &report));
+    name = "";
+    ASSERT_EQ(3, report.count);
+    // Strings are copied, and the first number is used.
+    EXPECT_STREQ("net.ipv4.ip_local_port_range", report.findings[0].name);
+    EXPECT_EQ(32768, report.findings[0].actual);
+    EXPECT_EQ(ENVU_TUNABLE_OK, report.findings[0].status);
+    EXPECT_EQ(ENVU_TUNABLE_OK, report.findings[1].status);
+    EXPECT_STREQ("test", report.findings[1].reason);
+    EXPECT_EQ(ENVU_TUNABLE_UNAVAILABLE, report.findings[2].status);
+    envuFree(report.findings);
+
+    ASSERT_EQ(0, envuAuditTunablesWithRules(rules, 0, &report));
+    EXPECT_EQ(0, report.count);
+    envuFree(report.findings);
+}
+
+TEST_F(SysRootTest, envuGetResourceLimitsCaps) {
+    SetSysRoot("sysctl");
+    envuResourceLimits limits;
+    ASSERT_EQ(0, envuGetResourceLimits(&limits));
+    EXPECT_EQ(1048576, limits.nr_open);
+    EXPECT_EQ(9223372036854775807LL, limits.file_max);
+    EXPECT_EQ(63382, limits.threads_max);
+    EXPECT_EQ(4194304, limits.pid_max);
+    SetSysRoot("sched");
+    ASSERT_EQ(0, envuGetResourceLimits(&limits));
+    EXPECT_EQ(-1, limits.nr_open);
+    EXPECT_EQ(-1, limits.pid_max);
+    EXPECT_TRUE(limits.limits[ENVU_RLIMIT_NOFILE].supported);
+}
+#else
+TEST(TunableTest, envuAuditTunables) {
+    envuTunableReport report;
+    EXPECT_EQ(-1, envuAuditTunables(&report));
+    EXPECT_EQ(0, report.count);
+}
+#endif
@@ -118,6 +118,52 @@ TEST(UtilTest, envuGetOSProductName) {
     envuFree(os_prod_name);
 }
 
+TEST(UtilTest, envuGetClockInfo) {
+    const envuClockInfo *info = envuGetClockInfo();
+    ASSERT_NE(nullptr, info);
+    EXPECT_EQ(info, envuGetClockInfo());
+    EXPECT_LT(0.0, info->monotonic_ns);
+#ifdef __linux__
+    EXPECT_STRNE("", info->current_clocksource);
+    EXPECT_NE(nullptr, strstr(info->available_clocksources, info->current_clocksource));
+    EXPECT_LT(0u, info->coarse_resolution_ns);
+#endif
+    if (info->now_source == ENVU_NOW_TSC) {
+        EXPECT_STREQ("tsc", info->current_clocksource);
+    }
+}
+
+#ifndef _WIN32
+static uint64_t getMonotonicNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+TEST(UtilTest, envuNowNs) {
+    uint64_t prev = envuNowNs();
+    for (int i = 0; i < 1000; i++) {
+        uint64_t now = envuNowNs();
+        ASSERT_LE(prev, now);
+        prev = now;
+    }
+#ifndef _WIN32
+    // It should pass the calibration of the TSC and stay close to CLOCK_MONOTONIC.
+    uint64_t start = getMonotonicNs();
+    while (getMonotonicNs() - start < 200000000ULL) {
+        uint64_t now = envuNowNs();
+        ASSERT_LE(prev, now);
+        prev = now;
+    }
+    uint64_t before = getMonotonicNs();
+    uint64_t now = envuNowNs();
+    uint64_t after = getMonotonicNs();
+    EXPECT_LE(before, now + 1000000);
+    EXPECT_LE(now, after + 1000000);
+#endif
+}
+
 // TODO: test with long paths
 // TODO: test with unicode strings
 TEST(UtilTest, envuGetExecutablePath) {
@@ -211,6 +257,26 @@ TEST(UtilTest, envuGetHome) {
     envuFree(home);
 }
 
+TEST(UtilTest, envuGetTempDir) {
+    char *tmp_dir = envuGetTempDir();
+    ASSERT_NE(nullptr, tmp_dir);
+    EXPECT_NE('\0', tmp_dir[0]);
+#ifndef _WIN32
+    char *env = envuGetEnv("TMPDIR");
+    envuSetEnv("TMPDIR", "/custom/tmp//");
+    char *custom = envuGetTempDir();
+    EXPECT_STREQ("/custom/tmp", custom);
+    envuSetEnv("TMPDIR", nullptr);
+    char *fallback = envuGetTempDir();
+    EXPECT_STREQ("/tmp", fallback);
+    envuSetEnv("TMPDIR", env);
+    envuFree(env);
+    envuFree(custom);
+    envuFree(fallback);
+#endif
+    envuFree(tmp_dir);
+}
+
 #ifdef _WIN32
 TEST(UtilTest, envuGetHomeWithoutUserprofile) {
     char* userprofile = envuGetEnv("USERPROFILE");
@@ -231,6 +297,50 @@ TEST(UtilTest, envuGetUsername) {
     envuFree(username);
 }
 
+TEST(UtilTest, envuGetResourceLimits) {
+    envuResourceLimits limits;
+    ASSERT_EQ(0, envuGetResourceLimits(&limits));
+    const envuResourceLimit *nofile = &limits.limits[ENVU_RLIMIT_NOFILE];
+    EXPECT_STREQ("nofile", nofile->name);
+    EXPECT_STREQ("stack", limits.limits[ENVU_RLIMIT_STACK].name);
+    ASSERT_TRUE(nofile->supported);
+    EXPECT_LT(0u, nofile->soft);
+    EXPECT_LE(nofile->soft, nofile->hard);
+#ifdef __linux__
+    EXPECT_TRUE(limits.limits[ENVU_RLIMIT_MEMLOCK].supported);
+    EXPECT_LE((long long)nofile->hard, limits.nr_open);
+    EXPECT_LT(0, limits.pid_max);
+#endif
+    EXPECT_EQ(-1, envuGetResourceLimits(NULL));
+}
+
+TEST(UtilTest, envuRaiseLimit) {
+    envuResourceLimits limits;
+    ASSERT_EQ(0, envuGetResourceLimits(&limits));
+    const envuResourceLimit *nofile = &limits.limits[ENVU_RLIMIT_NOFILE];
+    uint64_t achieved = 0;
+    // It never lowers the limit.
+    EXPECT_EQ(0, envuRaiseLimit(ENVU_RLIMIT_NOFILE, 1, &achieved));
+    EXPECT_EQ(nofile->soft, achieved);
+    EXPECT_EQ(0, envuRaiseLimit(ENVU_RLIMIT_NOFILE, ENVU_RLIM_INFINITY, &achieved));
+#ifdef __APPLE__
+    // macOS caps the soft limit at OPEN_MAX when the hard limit is unlimited.
+    if (nofile->hard == ENVU_RLIM_INFINITY)
+        EXPECT_LE(nofile->soft, achieved);
+    else
+        EXPECT_EQ(nofile->hard, achieved);
+#else
+    EXPECT_EQ(nofile->hard, achieved);
+#endif
+    if (nofile->hard != ENVU_RLIM_INFINITY) {
+        EXPECT_EQ(-1, envuRaiseLimit(ENVU_RLIMIT_NOFILE, nofile->hard + 1, &achieved));
+        EXPECT_EQ(nofile->hard, achieved);
+    }
+    ASSERT_EQ(0, envuGetResourceLimits(&limits));
+    EXPECT_EQ(achieved, limits.limits[ENVU_RLIMIT_NOFILE].soft);
+    EXPECT_EQ(-1, envuRaiseLimit(ENVU_RLIMIT_MAX, 1, &achieved));
+}
+
 TEST(UtilTest, envuGetEnvNull) {
     char* env = envuGetEnv(NULL);
     ASSERT_EQ(NULL, env);
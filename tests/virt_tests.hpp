@@ -0,0 +1,94 @@
+#pragma once
+// Tests for envuGetVirtualization
+
+#include <gtest/gtest.h>
+#include "env_utils.h"
+#include "cpu_tests.hpp"
+
+#ifdef __linux__
+TEST(VirtTest, envuGetVirtualization) {
+    const envuVirtualization *virt = envuGetVirtualization();
+    ASSERT_NE(nullptr, virt);
+    EXPECT_EQ(virt, envuGetVirtualization());
+    ASSERT_NE(nullptr, virt->hypervisor_name);
+    ASSERT_NE(nullptr, virt->container_name);
+    ASSERT_NE(nullptr, virt->cloud_name);
+    if (virt->hypervisor == ENVU_HV_NONE) {
+        EXPECT_STREQ("none", virt->hypervisor_name);
+    }
+}
+
+TEST_F(SysRootTest, envuGetVirtualizationCloud) {
+    SetSysRoot("virt_kvm");
+    const envuVirtualization *virt = envuGetVirtualization();
+    ASSERT_NE(nullptr, virt);
+    EXPECT_EQ(ENVU_HV_KVM, virt->hypervisor);
+    EXPECT_EQ(ENVU_CONFIDENCE_MEDIUM, virt->hypervisor_confidence);
+    EXPECT_STREQ("kvm", virt->hypervisor_name);
+    EXPECT_EQ(ENVU_CLOUD_AWS, virt->cloud);
+    EXPECT_STREQ("aws", virt->cloud_name);
+    EXPECT_STREQ("Amazon EC2", virt->dmi_vendor);
+    EXPECT_STREQ("m6i.large", virt->dmi_product);
+    EXPECT_STREQ("", virt->cpuid_vendor);
+    EXPECT_EQ(ENVU_CONTAINER_KUBERNETES, virt->container);
+    EXPECT_EQ(ENVU_CONFIDENCE_MEDIUM, virt->container_confidence);
+}
+
+TEST_F(SysRootTest, envuGetVirtualizationXen) {
+    SetSysRoot("virt_xen");
+    const envuVirtualization *virt = envuGetVirtualization();
+    ASSERT_NE(nullptr, virt);
+    EXPECT_EQ(ENVU_HV_XEN, virt->hypervisor);
+    EXPECT_EQ(ENVU_CONFIDENCE_HIGH, virt->hypervisor_confidence);
+    EXPECT_EQ(ENVU_CLOUD_NONE, virt->cloud);
+    EXPECT_EQ(ENVU_CONTAINER_LXC, virt->container);
+    EXPECT_EQ(ENVU_CONFIDENCE_HIGH, virt->container_confidence);
+}
+
+TEST_F(SysRootTest, envuGetVirtualizationWsl) {
+    SetSysRoot("virt_wsl");
+    const envuVirtualization *virt = envuGetVirtualization();
+    ASSERT_NE(nullptr, virt);
+    EXPECT_EQ(ENVU_HV_WSL, virt->hypervisor);
+    EXPECT_EQ(ENVU_CONFIDENCE_HIGH, virt->hypervisor_confidence);
+    EXPECT_EQ(ENVU_CONTAINER_DOCKER, virt->container);
+    EXPECT_STREQ("docker", virt->container_name);
+}
+
+TEST_F(SysRootTest, envuGetVirtualizationFirecracker) {
+    SetSysRoot("virt_firecracker");
+    const envuVirtualization *virt = envuGetVirtualization();
+    ASSERT_NE(nullptr, virt);
+    EXPECT_EQ(ENVU_HV_FIRECRACKER, virt->hypervisor);
+    EXPECT_EQ(ENVU_CONFIDENCE_LOW, virt->hypervisor_confidence);
+    EXPECT_STREQ("firecracker", virt->hypervisor_name);
+    EXPECT_STREQ("", virt->dmi_vendor);
+    EXPECT_EQ(ENVU_CLOUD_NONE, virt->cloud);
+}
+
+TEST_F(SysRootTest, envuGetVirtualizationGvisor) {
+    // runsc creates /.dockerenv when Docker uses it as a runtime.
+    SetSysRoot("virt_gvisor");
+    const envuVirtualization *virt = envuGetVirtualization();
+    ASSERT_NE(nullptr, virt);
+    EXPECT_EQ(ENVU_CONTAINER_GVISOR, virt->container);
+    EXPECT_EQ(ENVU_CONFIDENCE_MEDIUM, virt->container_confidence);
+    EXPECT_STREQ("gvisor", virt->container_name);
+}
+
+TEST_F(SysRootTest, envuGetVirtualizationBareMetal) {
+    SetSysRoot("virt_none");
+    const envuVirtualization *virt = envuGetVirtualization();
+    ASSERT_NE(nullptr, virt);
+    EXPECT_EQ(ENVU_HV_NONE, virt->hypervisor);
+    EXPECT_EQ(ENVU_CONFIDENCE_MEDIUM, virt->hypervisor_confidence);
+    EXPECT_STREQ("Dell Inc.", virt->dmi_vendor);
+    EXPECT_EQ(ENVU_CONTAINER_NONE, virt->container);
+    EXPECT_EQ(ENVU_CLOUD_NONE, virt->cloud);
+    EXPECT_STREQ("none", virt->cloud_name);
+}
+#else
+TEST(VirtTest, envuGetVirtualization) {
+    EXPECT_EQ(nullptr, envuGetVirtualization());
+}
+#endif